@@ -0,0 +1,476 @@
+/*
+    Benchmark suite : per-stage latency percentiles , throughput and peak RSS for a fixed set of
+    scenarios , written as JSON so two builds can be diffed.
+*/
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+#include <opencv2/opencv.hpp>
+
+#include "Configuration.h"
+#include "YOLOv8OnnxRunner.h"
+#include "PreprocessKernel.h"
+#include "OutputDecoder.h"
+#include "RunnerPool.h"
+#include "LatencyRecorder.h"
+#include "ProcessMemory.h"
+#include "HostProfile.h"
+#include "Trace.h"
+
+typedef struct _BENCH_CONFIG
+{
+    int32_t warmup = 5; // Untimed runs before every scenario
+    int32_t iterations = 50; // Timed runs per scenario (per thread for thread scenarios)
+    std::vector<int> batchSizes = { 2 , 4 , 8 };
+    std::vector<int> threadCounts = { 1 , 2 , 4 };
+    std::vector<float> confLevels = { 0.25f , 0.50f , 0.75f };
+    bool verbose = false; // Keep the runner's info log
+    std::string label = "";
+    std::string OutputPath = "benchmark.json";
+} BENCH_CONFIG;
+
+// mask stays at 0 for detect and pose models
+enum { STAGE_PREPROCESS , STAGE_INFERENCE , STAGE_DECODE , STAGE_NMS , STAGE_MASK , STAGE_TOTAL , STAGE_COUNT };
+static const char* STAGE_NAMES[STAGE_COUNT] = { "preprocess" , "inference" , "decode" , "nms" , "mask" , "total" };
+
+typedef struct _SCENARIO_RESULT
+{
+    std::string name;
+    int batchSize = 1;
+    int threads = 1;
+    float confThreshold = 0.0f;
+    double seconds = 0.0; // Wall time of the timed runs
+    uint64_t images = 0;
+    uint64_t detections = 0;
+    uint64_t peakRSS = 0;
+    LatencyRecorder stages[STAGE_COUNT]; // One sample per run : an image , or a whole batch
+} SCENARIO_RESULT;
+
+void Print_Usage(int argc, char ** argv, const Configuration & cfg, const BENCH_CONFIG & bench)
+{
+    fprintf(stderr, "Usage: %s [options]\n", argv[0]);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -h, --help            show this help message and exit\n");
+    fprintf(stderr, "  -m FNAME, --model-path FNAME\n");
+    fprintf(stderr, "                        model path (default: %s)\n", cfg.ModelPath.c_str());
+    fprintf(stderr, "  -img FNAME, --image-dir FNAME\n");
+    fprintf(stderr, "                        benchmark image dir (default: assets)\n");
+    fprintf(stderr, "  -o FNAME, --output FNAME\n");
+    fprintf(stderr, "                        JSON report (default: %s)\n", bench.OutputPath.c_str());
+    fprintf(stderr, "  --label STR\n");
+    fprintf(stderr, "                        build label stored in the report\n");
+    fprintf(stderr, "  --warmup N\n");
+    fprintf(stderr, "                        untimed runs before each scenario (default: %d)\n", bench.warmup);
+    fprintf(stderr, "  --iterations N\n");
+    fprintf(stderr, "                        timed runs per scenario (default: %d)\n", bench.iterations);
+    fprintf(stderr, "  --batch-sizes N,N,...\n");
+    fprintf(stderr, "                        batch scenarios , empty to skip (default: 2,4,8)\n");
+    fprintf(stderr, "  --threads N,N,...\n");
+    fprintf(stderr, "                        thread scenarios on a runner pool , empty to skip (default: 1,2,4)\n");
+    fprintf(stderr, "  --sessions K\n");
+    fprintf(stderr, "                        sessions in the runner pool of the thread scenarios (default: %d)\n", cfg.numSessions);
+    fprintf(stderr, "  --conf-levels T,T,...\n");
+    fprintf(stderr, "                        confidence threshold scenarios , empty to skip (default: 0.25,0.50,0.75)\n");
+    fprintf(stderr, "  --io-binding\n");
+    fprintf(stderr, "                        reuse preallocated input/output tensors through Ort::IoBinding (default: %d)\n", cfg.ioBinding);
+    fprintf(stderr, "  --rect\n");
+    fprintf(stderr, "                        dynamic-shape models : pad to the next multiple of 32 instead of the full square (default: %d)\n", cfg.rectInput);
+    fprintf(stderr, "  --raw-input\n");
+    fprintf(stderr, "                        in-graph preprocessing , the model takes the letterboxed uint8 frame (default: %d)\n", cfg.rawInput);
+    fprintf(stderr, "  --cuda\n");
+    fprintf(stderr, "                        using GPUs for inference (default: %d)\n", cfg.cudaEnable);
+    fprintf(stderr, "  --profile FNAME\n");
+    fprintf(stderr, "                        host profile written by YOLOv8Runner --auto-tune , applied before the other flags (default: %s)\n", cfg.ProfilePath.c_str());
+    fprintf(stderr, "  --verbose\n");
+    fprintf(stderr, "                        keep the runner log on stdout\n");
+    fprintf(stderr, "\n");
+}
+
+template <typename T>
+std::vector<T> Parse_List(const std::string& text)
+{
+    std::vector<T> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream , item , ','))
+    {
+        if (!item.empty())
+        {
+            values.push_back((T)std::stod(item));
+        }
+    }
+    return values;
+}
+
+bool Params_Parse(int argc , char ** argv , Configuration & cfg , BENCH_CONFIG & bench , std::filesystem::path & image_dir)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-m" || arg == "--model-path") {
+            cfg.ModelPath = argv[++i];
+        } else if (arg == "-img" || arg == "--image-dir")
+        {
+            image_dir = argv[++i];
+        } else if (arg == "-o" || arg == "--output")
+        {
+            bench.OutputPath = argv[++i];
+        } else if (arg == "--label")
+        {
+            bench.label = argv[++i];
+        } else if (arg == "--warmup")
+        {
+            bench.warmup = std::max(0 , std::stoi(argv[++i]));
+        } else if (arg == "--iterations")
+        {
+            bench.iterations = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--batch-sizes")
+        {
+            bench.batchSizes = Parse_List<int>(argv[++i]);
+        } else if (arg == "--threads")
+        {
+            bench.threadCounts = Parse_List<int>(argv[++i]);
+        } else if (arg == "--sessions")
+        {
+            int sessions = std::max(1 , std::stoi(argv[++i]));
+            // The pool threading of the profile was measured for its own session count
+            cfg.poolIntraThreads = sessions == cfg.numSessions ? cfg.poolIntraThreads : 0;
+            cfg.numSessions = sessions;
+        } else if (arg == "--conf-levels")
+        {
+            bench.confLevels = Parse_List<float>(argv[++i]);
+        } else if (arg == "--io-binding")
+        {
+            cfg.ioBinding = true;
+        } else if (arg == "--rect")
+        {
+            cfg.rectInput = true;
+        } else if (arg == "--raw-input")
+        {
+            cfg.rawInput = true;
+        } else if (arg == "--cuda")
+        {
+            cfg.cudaEnable = true;
+        } else if (arg == "--profile")
+        {
+            // Loaded by LoadHostProfileArgs before the other flags
+            cfg.ProfilePath = argv[++i];
+        } else if (arg == "--verbose")
+        {
+            bench.verbose = true;
+        } else if (arg == "-h" || arg == "--help")
+        {
+            Print_Usage(argc , argv , cfg , bench);
+            return EXIT_FAILURE;
+        } else
+        {
+            fprintf(stderr , "[ERROR] : Unknown argument : %s\n" , arg.c_str());
+            Print_Usage(argc , argv , cfg , bench);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+void Record_Times(SCENARIO_RESULT& scenario , const STAGE_TIMES& times , double totalMs)
+{
+    scenario.stages[STAGE_PREPROCESS].Add(times.preprocessMs);
+    scenario.stages[STAGE_INFERENCE].Add(times.inferenceMs);
+    scenario.stages[STAGE_DECODE].Add(times.decodeMs);
+    scenario.stages[STAGE_NMS].Add(times.nmsMs);
+    scenario.stages[STAGE_MASK].Add(times.maskMs);
+    scenario.stages[STAGE_TOTAL].Add(totalMs);
+}
+
+void Print_Scenario(const SCENARIO_RESULT& scenario)
+{
+    fprintf(stdout, "[BENCH] %-12s batch %d , threads %d , conf %.2f : %.2f images/s , peak RSS %.1f MB\n",
+        scenario.name.c_str(), scenario.batchSize, scenario.threads, scenario.confThreshold,
+        scenario.seconds > 0 ? scenario.images / scenario.seconds : 0.0, scenario.peakRSS / (1024.0 * 1024.0));
+    for (int s = 0 ; s < STAGE_COUNT ; s++)
+    {
+        const LatencyRecorder& stage = scenario.stages[s];
+        fprintf(stdout, "[BENCH]   %-10s p50 %8.3fms , p90 %8.3fms , p99 %8.3fms , max %8.3fms\n", STAGE_NAMES[s],
+            stage.Percentile(50), stage.Percentile(90), stage.Percentile(99), stage.Max());
+    }
+}
+
+// Single image loop on one detector , images taken round robin
+SCENARIO_RESULT Run_Single(YOLOv8OnnxRunner& Detector , const std::vector<cv::Mat>& images , \
+    const BENCH_CONFIG& bench , const std::string& name , float confThreshold)
+{
+    SCENARIO_RESULT scenario;
+    scenario.name = name;
+    scenario.confThreshold = confThreshold;
+    Detector.setConfThreshold(confThreshold);
+
+    REQUEST_CONTEXT ctx;
+    for (int i = 0 ; i < bench.warmup ; i++)
+    {
+        Detector.InferenceSingleImage(images[i % images.size()] , ctx);
+    }
+
+    auto bench_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0 ; i < bench.iterations ; i++)
+    {
+        auto time_start = std::chrono::high_resolution_clock::now();
+        auto result = Detector.InferenceSingleImage(images[i % images.size()] , ctx);
+        std::chrono::duration<double , std::milli> cost = std::chrono::high_resolution_clock::now() - time_start;
+        Record_Times(scenario , ctx.times , cost.count());
+        scenario.detections += result.size();
+    }
+    scenario.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - bench_start).count();
+    scenario.images = bench.iterations;
+    scenario.peakRSS = PeakRSSBytes();
+    return scenario;
+}
+
+SCENARIO_RESULT Run_Batch(YOLOv8OnnxRunner& Detector , const std::vector<cv::Mat>& images , \
+    const BENCH_CONFIG& bench , int batchSize , float confThreshold)
+{
+    SCENARIO_RESULT scenario;
+    scenario.name = "batch";
+    scenario.batchSize = batchSize;
+    scenario.confThreshold = confThreshold;
+    Detector.setConfThreshold(confThreshold);
+
+    std::vector<cv::Mat> batch(batchSize);
+    size_t next = 0;
+    auto Next_Batch = [&]()
+    {
+        for (auto& image : batch)
+        {
+            image = images[next++ % images.size()];
+        }
+    };
+    for (int i = 0 ; i < bench.warmup ; i++)
+    {
+        Next_Batch();
+        Detector.InferenceBatch(batch);
+    }
+
+    auto bench_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0 ; i < bench.iterations ; i++)
+    {
+        Next_Batch();
+        STAGE_TIMES times;
+        auto time_start = std::chrono::high_resolution_clock::now();
+        auto results = Detector.InferenceBatch(batch , &times);
+        std::chrono::duration<double , std::milli> cost = std::chrono::high_resolution_clock::now() - time_start;
+        Record_Times(scenario , times , cost.count());
+        for (auto& result : results)
+        {
+            scenario.detections += result.size();
+        }
+    }
+    scenario.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - bench_start).count();
+    scenario.images = (uint64_t)bench.iterations * batchSize;
+    scenario.peakRSS = PeakRSSBytes();
+    return scenario;
+}
+
+// Every thread runs bench.iterations images through the pool , samples of all threads are merged
+SCENARIO_RESULT Run_Threads(RunnerPool& pool , const std::vector<cv::Mat>& images , \
+    const BENCH_CONFIG& bench , int threads , float confThreshold)
+{
+    SCENARIO_RESULT scenario;
+    scenario.name = "threads";
+    scenario.threads = threads;
+    scenario.confThreshold = confThreshold;
+
+    std::vector<SCENARIO_RESULT> perThread(threads);
+    std::vector<uint64_t> detections(threads , 0);
+    auto Worker = [&](int t , bool timed)
+    {
+        int runs = timed ? bench.iterations : bench.warmup;
+        for (int i = 0 ; i < runs ; i++)
+        {
+            STAGE_TIMES times;
+            auto time_start = std::chrono::high_resolution_clock::now();
+            auto result = pool.InferenceSingleImage(images[(size_t)(t + i) % images.size()] , &times);
+            std::chrono::duration<double , std::milli> cost = std::chrono::high_resolution_clock::now() - time_start;
+            if (timed)
+            {
+                Record_Times(perThread[t] , times , cost.count());
+                detections[t] += result.size();
+            }
+        }
+    };
+
+    for (int pass = 0 ; pass < 2 ; pass++)
+    {
+        std::vector<std::thread> workers;
+        auto bench_start = std::chrono::high_resolution_clock::now();
+        for (int t = 0 ; t < threads ; t++)
+        {
+            workers.emplace_back(Worker , t , pass == 1);
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        scenario.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - bench_start).count();
+    }
+
+    for (int t = 0 ; t < threads ; t++)
+    {
+        for (int s = 0 ; s < STAGE_COUNT ; s++)
+        {
+            scenario.stages[s].Append(perThread[t].stages[s]);
+        }
+        scenario.detections += detections[t];
+    }
+    scenario.images = (uint64_t)bench.iterations * threads;
+    scenario.peakRSS = PeakRSSBytes();
+    return scenario;
+}
+
+std::string Json_Escape(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool Write_Json(const std::string& path , const Configuration& cfg , const BENCH_CONFIG& bench , \
+    size_t imageCount , const std::vector<SCENARIO_RESULT>& scenarios)
+{
+    FILE* file = fopen(path.c_str() , "w");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "[ERROR] : Failed to open %s\n", path.c_str());
+        return false;
+    }
+    fprintf(file, "{\n");
+    fprintf(file, "  \"label\": \"%s\",\n", Json_Escape(bench.label).c_str());
+    fprintf(file, "  \"model\": \"%s\",\n", Json_Escape(cfg.ModelPath).c_str());
+    fprintf(file, "  \"images\": %zu,\n", imageCount);
+    fprintf(file, "  \"warmup\": %d,\n", bench.warmup);
+    fprintf(file, "  \"iterations\": %d,\n", bench.iterations);
+    fprintf(file, "  \"intra_op_threads\": %d,\n", cfg.intraThreads);
+    fprintf(file, "  \"inter_op_threads\": %d,\n", cfg.num_thread);
+    fprintf(file, "  \"execution_mode\": \"%s\",\n", cfg.parallelExecution ? "parallel" : "sequential");
+    fprintf(file, "  \"allow_spinning\": %s,\n", cfg.allowSpinning ? "true" : "false");
+    fprintf(file, "  \"thread_affinity\": \"%s\",\n", ThreadAffinityName(cfg.threadAffinity));
+    fprintf(file, "  \"cuda\": %s,\n", cfg.cudaEnable ? "true" : "false");
+    fprintf(file, "  \"io_binding\": %s,\n", cfg.ioBinding ? "true" : "false");
+    fprintf(file, "  \"raw_input\": %s,\n", cfg.rawInput ? "true" : "false");
+    fprintf(file, "  \"rect\": %s,\n", cfg.rectInput ? "true" : "false");
+    fprintf(file, "  \"preprocess_kernel\": \"%s\",\n", PreprocessKernelName());
+    fprintf(file, "  \"decoder_kernel\": \"%s\",\n", DecoderKernelName());
+    fprintf(file, "  \"peak_rss_bytes\": %llu,\n", (unsigned long long)PeakRSSBytes());
+    fprintf(file, "  \"scenarios\": [\n");
+    for (size_t i = 0 ; i < scenarios.size() ; i++)
+    {
+        const SCENARIO_RESULT& scenario = scenarios[i];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", scenario.name.c_str());
+        fprintf(file, "      \"batch_size\": %d,\n", scenario.batchSize);
+        fprintf(file, "      \"threads\": %d,\n", scenario.threads);
+        fprintf(file, "      \"conf_threshold\": %.3f,\n", scenario.confThreshold);
+        fprintf(file, "      \"samples\": %zu,\n", scenario.stages[STAGE_TOTAL].Count());
+        fprintf(file, "      \"images\": %llu,\n", (unsigned long long)scenario.images);
+        fprintf(file, "      \"seconds\": %.6f,\n", scenario.seconds);
+        fprintf(file, "      \"throughput_images_per_s\": %.3f,\n", scenario.seconds > 0 ? scenario.images / scenario.seconds : 0.0);
+        fprintf(file, "      \"detections_per_image\": %.3f,\n", scenario.images > 0 ? (double)scenario.detections / scenario.images : 0.0);
+        fprintf(file, "      \"peak_rss_bytes\": %llu,\n", (unsigned long long)scenario.peakRSS);
+        fprintf(file, "      \"stages_ms\": {\n");
+        for (int s = 0 ; s < STAGE_COUNT ; s++)
+        {
+            const LatencyRecorder& stage = scenario.stages[s];
+            fprintf(file, "        \"%s\": { \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f }%s\n",
+                STAGE_NAMES[s], stage.Percentile(50), stage.Percentile(90), stage.Percentile(99), stage.Max(), stage.Mean(),
+                s + 1 < STAGE_COUNT ? "," : "");
+        }
+        fprintf(file, "      }\n");
+        fprintf(file, "    }%s\n", i + 1 < scenarios.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+    fclose(file);
+    return true;
+}
+
+int main(int argc , char *argv[])
+{
+    std::filesystem::path image_dir = "assets";
+    Configuration cfg;
+    BENCH_CONFIG bench;
+    // Before the flags , so anything given on the command line overrides the tuned settings
+    LoadHostProfileArgs(argc , argv , cfg);
+
+    if (Params_Parse(argc , argv , cfg , bench , image_dir))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<cv::Mat> images;
+    for (auto& i : std::filesystem::directory_iterator(image_dir))
+    {
+        if (i.path().extension() == ".jpg" || i.path().extension() == ".png" || i.path().extension() == ".jpeg")
+        {
+            images.emplace_back(cv::imread(i.path().string()));
+        }
+    }
+    if (images.empty())
+    {
+        fprintf(stderr, "[ERROR] : No image found in %s\n", image_dir.string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Keep stdout for the report , the runner only logs warnings and errors unless --verbose
+    Logger::SetLevel(bench.verbose ? LOG_LEVEL_INFO : LOG_LEVEL_WARN);
+
+    std::vector<SCENARIO_RESULT> scenarios;
+    {
+        YOLOv8OnnxRunner Detector(cfg);
+
+        scenarios.emplace_back(Run_Single(Detector , images , bench , "single" , cfg.confThreshold));
+        Print_Scenario(scenarios.back());
+
+        for (float level : bench.confLevels)
+        {
+            scenarios.emplace_back(Run_Single(Detector , images , bench , "conf" , level));
+            Print_Scenario(scenarios.back());
+        }
+
+        for (int batchSize : bench.batchSizes)
+        {
+            if (batchSize < 1)
+            {
+                continue;
+            }
+            scenarios.emplace_back(Run_Batch(Detector , images , bench , batchSize , cfg.confThreshold));
+            Print_Scenario(scenarios.back());
+        }
+    }
+
+    if (!bench.threadCounts.empty())
+    {
+        RunnerPool pool(cfg , cfg.numSessions);
+        for (int threads : bench.threadCounts)
+        {
+            if (threads < 1)
+            {
+                continue;
+            }
+            scenarios.emplace_back(Run_Threads(pool , images , bench , threads , cfg.confThreshold));
+            Print_Scenario(scenarios.back());
+        }
+    }
+
+    if (!Write_Json(bench.OutputPath , cfg , bench , images.size() , scenarios))
+    {
+        return EXIT_FAILURE;
+    }
+    fprintf(stdout, "[BENCH] report written to %s , peak RSS %.1f MB\n", bench.OutputPath.c_str(), PeakRSSBytes() / (1024.0 * 1024.0));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#include <new>
+#include <cstdlib>
+
+#include "AllocationCounter.h"
+
+// Constant initialized , safe to touch from operator new before anything else on the thread ran
+static thread_local uint64_t threadAllocations = 0;
+static thread_local uint64_t threadBytes = 0;
+
+static void* CountedAlloc(std::size_t size)
+{
+    threadAllocations++;
+    threadBytes += size;
+    // malloc(0) may return nullptr , operator new must not
+    return std::malloc(size > 0 ? size : 1);
+}
+
+ALLOCATION_COUNTS AllocationCounter::Thread()
+{
+    ALLOCATION_COUNTS counts;
+    counts.allocations = threadAllocations;
+    counts.bytes = threadBytes;
+    return counts;
+}
+
+void* operator new(std::size_t size)
+{
+    void* p = CountedAlloc(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size , const std::nothrow_t&) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void* operator new[](std::size_t size , const std::nothrow_t&) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p , std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p , std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p , const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p , const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
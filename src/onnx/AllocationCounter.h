@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+    Heap allocation counter for the --check-allocations mode. AllocationCounter.cpp replaces the
+    global operator new / delete and counts every allocation per thread , so a check measures
+    its own thread only and pays no atomic. It is linked into main alone , the library and the
+    other executables keep the default allocator.
+
+    Allocations of OpenCV (cv::fastMalloc) and of onnxruntime's own allocators do not go through
+    operator new and are not counted ; compare buffer pointers across frames for those.
+*/
+typedef struct _ALLOCATION_COUNTS
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+} ALLOCATION_COUNTS;
+
+class AllocationCounter
+{
+public:
+    // Totals of the calling thread since it started
+    static ALLOCATION_COUNTS Thread();
+};
+
+inline ALLOCATION_COUNTS operator+(const ALLOCATION_COUNTS& a , const ALLOCATION_COUNTS& b)
+{
+    ALLOCATION_COUNTS sum;
+    sum.allocations = a.allocations + b.allocations;
+    sum.bytes = a.bytes + b.bytes;
+    return sum;
+}
+
+inline ALLOCATION_COUNTS operator-(const ALLOCATION_COUNTS& a , const ALLOCATION_COUNTS& b)
+{
+    ALLOCATION_COUNTS diff;
+    diff.allocations = a.allocations - b.allocations;
+    diff.bytes = a.bytes - b.bytes;
+    return diff;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <mutex>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <condition_variable>
+
+typedef struct _QUEUE_STATS
+{
+    size_t capacity = 0;
+    uint64_t pushed = 0;
+    double meanOccupancy = 0.0; // Items already waiting when a new one is pushed , averaged
+    size_t maxOccupancy = 0;
+    double pushWaitMs = 0.0; // Producers blocked on a full queue (backpressure)
+    double popWaitMs = 0.0; // Consumers blocked on an empty queue (starvation)
+} QUEUE_STATS;
+
+/*
+    Fixed-capacity blocking FIFO on a preallocated ring. One mutex guards both ends ; the
+    critical section is a move and two index updates , so contention stays negligible next to
+    the millisecond-scale stages it connects. Push blocks while full , which is what gives the
+    pipeline its backpressure. After Close , Push fails and Pop drains what is left.
+*/
+template <typename T>
+class BoundedQueue
+{
+private:
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::vector<T> ring;
+    size_t head = 0;
+    size_t count = 0;
+    bool closed = false;
+
+    uint64_t pushed = 0;
+    uint64_t occupancySum = 0;
+    size_t maxOccupancy = 0;
+    std::chrono::steady_clock::duration pushWait{ 0 };
+    std::chrono::steady_clock::duration popWait{ 0 };
+
+public:
+    explicit BoundedQueue(size_t capacity) : ring(capacity > 0 ? capacity : 1) {}
+
+    bool Push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (count == ring.size() && !closed)
+        {
+            auto wait_start = std::chrono::steady_clock::now();
+            notFull.wait(lock , [this] { return count < ring.size() || closed; });
+            pushWait += std::chrono::steady_clock::now() - wait_start;
+        }
+        if (closed)
+        {
+            return false;
+        }
+
+        occupancySum += count;
+        maxOccupancy = std::max(maxOccupancy , count);
+        pushed++;
+
+        ring[(head + count) % ring.size()] = std::move(item);
+        count++;
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Push without waiting , false when the queue is full or closed (load shedding instead of backpressure)
+    bool TryPush(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (count == ring.size() || closed)
+        {
+            return false;
+        }
+
+        occupancySum += count;
+        maxOccupancy = std::max(maxOccupancy , count);
+        pushed++;
+
+        ring[(head + count) % ring.size()] = std::move(item);
+        count++;
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool Pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (count == 0 && !closed)
+        {
+            auto wait_start = std::chrono::steady_clock::now();
+            notEmpty.wait(lock , [this] { return count > 0 || closed; });
+            popWait += std::chrono::steady_clock::now() - wait_start;
+        }
+        if (count == 0)
+        {
+            return false;
+        }
+
+        item = std::move(ring[head]);
+        head = (head + 1) % ring.size();
+        count--;
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Pop that gives up at deadline , false on timeout or when closed and drained
+    bool PopUntil(T& item , std::chrono::steady_clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (count == 0 && !closed)
+        {
+            notEmpty.wait_until(lock , deadline , [this] { return count > 0 || closed; });
+        }
+        if (count == 0)
+        {
+            return false;
+        }
+
+        item = std::move(ring[head]);
+        head = (head + 1) % ring.size();
+        count--;
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    QUEUE_STATS Stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_STATS stats;
+        stats.capacity = ring.size();
+        stats.pushed = pushed;
+        stats.meanOccupancy = pushed > 0 ? (double)occupancySum / pushed : 0.0;
+        stats.maxOccupancy = maxOccupancy;
+        stats.pushWaitMs = std::chrono::duration<double , std::milli>(pushWait).count();
+        stats.popWaitMs = std::chrono::duration<double , std::milli>(popWait).count();
+        return stats;
+    }
+};
@@ -0,0 +1,334 @@
+#include <cmath>
+#include <algorithm>
+
+#include "ByteTracker.h"
+
+// Noise of the motion model relative to the box height , as in ByteTrack
+static const float STD_WEIGHT_POSITION = 1.0f / 20;
+static const float STD_WEIGHT_VELOCITY = 1.0f / 160;
+
+static void AxisPredict(KALMAN_AXIS& axis , float stdPosition , float stdVelocity)
+{
+    axis.x += axis.v;
+    axis.p00 += 2.0f * axis.p01 + axis.p11 + stdPosition * stdPosition;
+    axis.p01 += axis.p11;
+    axis.p11 += stdVelocity * stdVelocity;
+}
+
+static void AxisUpdate(KALMAN_AXIS& axis , float z , float stdMeasurement)
+{
+    float s = axis.p00 + stdMeasurement * stdMeasurement;
+    float k0 = axis.p00 / s;
+    float k1 = axis.p01 / s;
+    float innovation = z - axis.x;
+    axis.x += k0 * innovation;
+    axis.v += k1 * innovation;
+    axis.p11 -= k1 * axis.p01;
+    axis.p00 -= k0 * axis.p00;
+    axis.p01 -= k0 * axis.p01;
+}
+
+// IoU of the track's predicted box (cx , cy , aspect , height) and a detection
+static float TrackIoU(const TRACK& track , const cv::Rect& box)
+{
+    float h = track.axes[3].x;
+    float w = track.axes[2].x * h;
+    float x0 = track.axes[0].x - 0.5f * w , y0 = track.axes[1].x - 0.5f * h;
+    float ix = std::min(x0 + w , (float)(box.x + box.width)) - std::max(x0 , (float)box.x);
+    float iy = std::min(y0 + h , (float)(box.y + box.height)) - std::max(y0 , (float)box.y);
+    if (ix <= 0.0f || iy <= 0.0f || w <= 0.0f || h <= 0.0f)
+    {
+        return 0.0f;
+    }
+    float inter = ix * iy;
+    return inter / (w * h + (float)box.area() - inter);
+}
+
+cv::Rect TrackBox(const TRACK& track)
+{
+    float h = track.axes[3].x;
+    float w = track.axes[2].x * h;
+    return cv::Rect((int)std::round(track.axes[0].x - 0.5f * w) , (int)std::round(track.axes[1].x - 0.5f * h) , \
+        (int)std::round(w) , (int)std::round(h));
+}
+
+ByteTracker::ByteTracker(const TRACK_CONFIG& config) : config(config)
+{
+}
+
+void ByteTracker::Reset()
+{
+    tracks.clear();
+    firstUpdate = true;
+}
+
+void ByteTracker::Initiate(TRACK& track , const DETECT_RESULT& det) const
+{
+    float h = (float)std::max(1 , det.box.height);
+    float measurement[4] = { det.box.x + 0.5f * det.box.width , det.box.y + 0.5f * h , det.box.width / h , h };
+    float stdPosition[4] = { 2 * STD_WEIGHT_POSITION * h , 2 * STD_WEIGHT_POSITION * h , 1e-2f , 2 * STD_WEIGHT_POSITION * h };
+    float stdVelocity[4] = { 10 * STD_WEIGHT_VELOCITY * h , 10 * STD_WEIGHT_VELOCITY * h , 1e-5f , 10 * STD_WEIGHT_VELOCITY * h };
+    for (int k = 0 ; k < 4 ; k++)
+    {
+        KALMAN_AXIS& axis = track.axes[k];
+        axis.x = measurement[k];
+        axis.v = 0.0f;
+        axis.p00 = stdPosition[k] * stdPosition[k];
+        axis.p01 = 0.0f;
+        axis.p11 = stdVelocity[k] * stdVelocity[k];
+    }
+    track.classId = det.classId;
+    track.score = det.confidence;
+    track.lostFrames = 0;
+    track.hits = 1;
+}
+
+void ByteTracker::Correct(TRACK& track , const DETECT_RESULT& det) const
+{
+    float h = (float)std::max(1 , det.box.height);
+    float measurement[4] = { det.box.x + 0.5f * det.box.width , det.box.y + 0.5f * h , det.box.width / h , h };
+    float stdPosition = STD_WEIGHT_POSITION * track.axes[3].x;
+    float stdMeasurement[4] = { stdPosition , stdPosition , 1e-1f , stdPosition };
+    for (int k = 0 ; k < 4 ; k++)
+    {
+        AxisUpdate(track.axes[k] , measurement[k] , stdMeasurement[k]);
+    }
+    track.score = det.confidence;
+    track.lostFrames = 0;
+    track.hits++;
+}
+
+void ByteTracker::Predict(int frames)
+{
+    for (int step = 0 ; step < frames ; step++)
+    {
+        for (auto& track : tracks)
+        {
+            // A lost track keeps drifting with its last velocity , but not growing or shrinking
+            if (track.state != TRACK_TRACKED)
+            {
+                track.axes[3].v = 0.0f;
+            }
+            float stdPosition = STD_WEIGHT_POSITION * track.axes[3].x;
+            float stdVelocity = STD_WEIGHT_VELOCITY * track.axes[3].x;
+            AxisPredict(track.axes[0] , stdPosition , stdVelocity);
+            AxisPredict(track.axes[1] , stdPosition , stdVelocity);
+            AxisPredict(track.axes[2] , 1e-2f , 1e-5f);
+            AxisPredict(track.axes[3] , stdPosition , stdVelocity);
+            if (track.state == TRACK_LOST)
+            {
+                track.lostFrames++;
+            }
+        }
+    }
+    tracks.erase(std::remove_if(tracks.begin() , tracks.end() , [&](const TRACK& track)
+    {
+        return track.axes[3].x <= 0.0f || (track.state == TRACK_LOST && track.lostFrames > config.maxLostFrames);
+    }) , tracks.end());
+}
+
+void ByteTracker::Associate(const std::vector<size_t>& trackIdx , const std::vector<const DETECT_RESULT*>& dets , \
+    float threshold , std::vector<std::pair<size_t , size_t>>& matches) const
+{
+    typedef struct _CANDIDATE
+    {
+        float iou;
+        size_t track;
+        size_t det;
+    } CANDIDATE;
+    std::vector<CANDIDATE> candidates;
+    for (size_t t = 0 ; t < trackIdx.size() ; t++)
+    {
+        const TRACK& track = tracks[trackIdx[t]];
+        for (size_t d = 0 ; d < dets.size() ; d++)
+        {
+            if (!config.classAgnostic && dets[d]->classId != track.classId)
+            {
+                continue;
+            }
+            float iou = TrackIoU(track , dets[d]->box);
+            if (iou >= threshold)
+            {
+                candidates.push_back({ iou , t , d });
+            }
+        }
+    }
+    std::sort(candidates.begin() , candidates.end() , [](const CANDIDATE& a , const CANDIDATE& b)
+    {
+        return a.iou > b.iou;
+    });
+    std::vector<char> trackUsed(trackIdx.size() , 0) , detUsed(dets.size() , 0);
+    matches.clear();
+    for (const auto& candidate : candidates)
+    {
+        if (!trackUsed[candidate.track] && !detUsed[candidate.det])
+        {
+            trackUsed[candidate.track] = detUsed[candidate.det] = 1;
+            matches.emplace_back(candidate.track , candidate.det);
+        }
+    }
+}
+
+TRACK_UPDATE_STATS ByteTracker::Update(const std::vector<DETECT_RESULT>& detections)
+{
+    TRACK_UPDATE_STATS stats;
+    std::vector<const DETECT_RESULT*> high , low;
+    for (const auto& det : detections)
+    {
+        if (det.confidence >= config.highThreshold)
+        {
+            high.push_back(&det);
+        } else if (det.confidence >= config.lowThreshold)
+        {
+            low.push_back(&det);
+        }
+    }
+
+    std::vector<size_t> pool , unconfirmed;
+    for (size_t i = 0 ; i < tracks.size() ; i++)
+    {
+        (tracks[i].state == TRACK_NEW ? unconfirmed : pool).push_back(i);
+    }
+
+    std::vector<char> trackMatched(tracks.size() , 0);
+    float iouSum = 0.0f , scoreSum = 0.0f;
+    auto apply = [&](const std::vector<size_t>& trackIdx , std::vector<const DETECT_RESULT*>& dets , \
+        const std::vector<std::pair<size_t , size_t>>& matches)
+    {
+        for (const auto& match : matches)
+        {
+            TRACK& track = tracks[trackIdx[match.first]];
+            iouSum += TrackIoU(track , dets[match.second]->box);
+            scoreSum += dets[match.second]->confidence;
+            Correct(track , *dets[match.second]);
+            track.state = TRACK_TRACKED;
+            trackMatched[trackIdx[match.first]] = 1;
+            stats.tracked++;
+        }
+        // Drop the matched detections , keep the order of the rest
+        std::vector<char> used(dets.size() , 0);
+        for (const auto& match : matches)
+        {
+            used[match.second] = 1;
+        }
+        size_t kept = 0;
+        for (size_t d = 0 ; d < dets.size() ; d++)
+        {
+            if (!used[d])
+            {
+                dets[kept++] = dets[d];
+            }
+        }
+        dets.resize(kept);
+    };
+
+    // 1. High score detections against tracked and lost tracks
+    std::vector<std::pair<size_t , size_t>> matches;
+    Associate(pool , high , config.matchIoU , matches);
+    apply(pool , high , matches);
+
+    // 2. Low score detections against the tracked tracks left ; lost tracks are not revived by them
+    std::vector<size_t> remaining;
+    for (size_t i : pool)
+    {
+        if (!trackMatched[i] && tracks[i].state == TRACK_TRACKED)
+        {
+            remaining.push_back(i);
+        }
+    }
+    Associate(remaining , low , config.lowMatchIoU , matches);
+    apply(remaining , low , matches);
+    for (size_t i : remaining)
+    {
+        if (!trackMatched[i])
+        {
+            tracks[i].state = TRACK_LOST;
+            tracks[i].lostFrames = 0;
+            stats.lost++;
+        }
+    }
+    stats.predictionIoU = stats.tracked > 0 ? iouSum / stats.tracked : 1.0f;
+    stats.meanScore = stats.tracked > 0 ? scoreSum / stats.tracked : 0.0f;
+
+    // 3. Tracks started at the last keyframe need a second high score detection to be confirmed
+    Associate(unconfirmed , high , config.newMatchIoU , matches);
+    for (const auto& match : matches)
+    {
+        TRACK& track = tracks[unconfirmed[match.first]];
+        Correct(track , *high[match.second]);
+        track.state = TRACK_TRACKED;
+        track.id = nextId++;
+        trackMatched[unconfirmed[match.first]] = 1;
+        stats.born++;
+    }
+    std::vector<char> used(high.size() , 0);
+    for (const auto& match : matches)
+    {
+        used[match.second] = 1;
+    }
+    std::vector<char> keep(tracks.size() , 1);
+    for (size_t i : unconfirmed)
+    {
+        keep[i] = trackMatched[i];
+    }
+    size_t kept = 0;
+    for (size_t i = 0 ; i < tracks.size() ; i++)
+    {
+        if (keep[i])
+        {
+            tracks[kept++] = tracks[i];
+        }
+    }
+    tracks.resize(kept);
+
+    // 4. New tracks from the high score detections nobody claimed , confirmed at once on the first frame
+    for (size_t d = 0 ; d < high.size() ; d++)
+    {
+        if (used[d] || high[d]->confidence < config.newTrackThreshold)
+        {
+            continue;
+        }
+        TRACK track;
+        Initiate(track , *high[d]);
+        if (firstUpdate)
+        {
+            track.state = TRACK_TRACKED;
+            track.id = nextId++;
+            stats.born++;
+        } else
+        {
+            stats.started++;
+        }
+        tracks.emplace_back(track);
+    }
+    firstUpdate = false;
+
+    for (const auto& track : tracks)
+    {
+        if (track.state == TRACK_TRACKED && track.axes[3].x > 0.0f)
+        {
+            float speed = std::sqrt(track.axes[0].v * track.axes[0].v + track.axes[1].v * track.axes[1].v) / track.axes[3].x;
+            stats.maxSpeed = std::max(stats.maxSpeed , speed);
+        }
+    }
+    return stats;
+}
+
+std::vector<DETECT_RESULT> ByteTracker::Results() const
+{
+    std::vector<DETECT_RESULT> results;
+    for (const auto& track : tracks)
+    {
+        if (track.state != TRACK_TRACKED)
+        {
+            continue;
+        }
+        DETECT_RESULT result;
+        result.classId = track.classId;
+        result.confidence = track.score;
+        result.box = TrackBox(track);
+        result.trackId = track.id;
+        results.emplace_back(result);
+    }
+    return results;
+}
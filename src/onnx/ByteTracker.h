@@ -0,0 +1,88 @@
+#pragma once
+
+#include "YOLOv8OnnxRunner.h"
+
+typedef struct _TRACK_CONFIG
+{
+    float highThreshold = 0.5f; // Detections from here on take part in the first association and start tracks
+    float lowThreshold = 0.1f; // Detections between low and high only extend tracks that are already tracked
+    float newTrackThreshold = 0.6f; // Unmatched high detection that starts a new track
+    float matchIoU = 0.2f; // First association , high detections against tracked and lost tracks
+    float lowMatchIoU = 0.5f; // Second association , low detections against the tracks left
+    float newMatchIoU = 0.3f; // A track started at the last keyframe is confirmed by a detection at the next one
+    int maxLostFrames = 30; // Frames a lost track is kept for re-identification
+    bool classAgnostic = false;
+} TRACK_CONFIG;
+
+/* One box coordinate and its velocity. The constant velocity model of ByteTrack / DeepSORT
+   over (cx , cy , aspect , height) has block diagonal matrices , so each coordinate is an
+   independent 2-state filter and the 8x8 covariance reduces to 4 x (p00 , p01 , p11). */
+typedef struct _KALMAN_AXIS
+{
+    float x = 0.0f;
+    float v = 0.0f;
+    float p00 = 0.0f;
+    float p01 = 0.0f;
+    float p11 = 0.0f;
+} KALMAN_AXIS;
+
+enum TRACK_STATE { TRACK_NEW , TRACK_TRACKED , TRACK_LOST };
+
+typedef struct _TRACK
+{
+    int id = -1; // Given when the track is confirmed
+    int classId = 0;
+    float score = 0.0f; // Of the last matched detection
+    TRACK_STATE state = TRACK_NEW;
+    KALMAN_AXIS axes[4]; // cx , cy , aspect (w / h) , height
+    int lostFrames = 0;
+    int hits = 0;
+} TRACK;
+
+// What the last keyframe association found , for the keyframe scheduler
+typedef struct _TRACK_UPDATE_STATS
+{
+    size_t tracked = 0; // Confirmed tracks matched by a detection
+    size_t born = 0; // New tracks confirmed
+    size_t started = 0; // Tracks started , waiting for the next keyframe to be confirmed
+    size_t lost = 0; // Tracked tracks left without a detection
+    float predictionIoU = 1.0f; // Mean IoU of the predicted box and its matched detection
+    float meanScore = 0.0f; // Mean detection score of the matched tracks
+    float maxSpeed = 0.0f; // Fastest confirmed track , box heights per frame
+} TRACK_UPDATE_STATS;
+
+/*
+    ByteTrack-style multi-object tracker over DETECT_RESULT boxes. Every frame , Predict moves
+    the tracks with their Kalman filters ; on frames with detections , Update associates them
+    in two rounds : high score detections against all tracked and lost tracks , then low score
+    detections (occluded , blurred) against the tracked ones still unmatched , so a track is
+    not dropped just because its object scored low for a few frames. Association is greedy by
+    IoU , which on the few dozen tracks of a frame matches the Hungarian result in practice.
+*/
+class ByteTracker
+{
+private:
+    TRACK_CONFIG config;
+    std::vector<TRACK> tracks;
+    int nextId = 1;
+    bool firstUpdate = true;
+
+    void Initiate(TRACK& track , const DETECT_RESULT& det) const;
+    void Correct(TRACK& track , const DETECT_RESULT& det) const;
+    // Greedy one to one matching , IoU >= threshold and same class unless class agnostic
+    void Associate(const std::vector<size_t>& trackIdx , const std::vector<const DETECT_RESULT*>& dets , \
+        float threshold , std::vector<std::pair<size_t , size_t>>& matches) const;
+
+public:
+    explicit ByteTracker(const TRACK_CONFIG& config);
+
+    // Advance every track by frames steps of the motion model
+    void Predict(int frames = 1);
+    TRACK_UPDATE_STATS Update(const std::vector<DETECT_RESULT>& detections);
+    void Reset();
+
+    // Boxes of the confirmed , currently tracked tracks , trackId set
+    std::vector<DETECT_RESULT> Results() const;
+};
+
+cv::Rect TrackBox(const TRACK& track);
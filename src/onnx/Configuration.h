@@ -3,16 +3,132 @@
 #include <thread>
 #include <iostream>
 
+// Where a session's intra-op threads may run , see IntraOpAffinities
+enum THREAD_AFFINITY { AFFINITY_NONE , AFFINITY_CORES , AFFINITY_NUMA };
+
 struct Configuration
 {   
+    // Inter-op pool threads , only used by the parallel execution mode
     int32_t num_thread = std::min(4 , (int32_t)std::thread::hardware_concurrency());
+    // Session threading , --auto-tune measures these on the host and writes the best into ProfilePath ,
+    // which is loaded at startup. 0 intra-op threads keeps the ORT default (one per physical core)
+    int32_t intraThreads = 0;
+    bool parallelExecution = false;
+    bool allowSpinning = true;
+    THREAD_AFFINITY threadAffinity = AFFINITY_NONE;
+    // Sessions of a RunnerPool of numSessions , when the profile found several sessions faster than one :
+    // each gets poolIntraThreads instead of intraThreads , pinned by poolAffinity. 0 : same as a lone runner
+    int32_t poolIntraThreads = 0;
+    THREAD_AFFINITY poolAffinity = AFFINITY_NONE;
+    int32_t sessionSlot = 0; // Which session of the process this runner is , picks its processors ; set by RunnerPool
+    bool autoTune = false;
+    double tuneSeconds = 3.0; // Measured time per tried configuration
 
     float confThreshold = 0.50f;
     float iouThreshold = 0.45f;
 
+    // NMS : candidates kept by score before suppression , detections kept per image
+    int32_t nmsTopK = 30000;
+    int32_t maxDet = 300;
+    bool agnosticNMS = false;
+    bool softNMS = false;
+    float softNMSSigma = 0.5f;
+
+    // Images per session->Run when running a directory , 1 keeps the single image path
+    int32_t batchSize = 1;
+
+    // Pipelined directory mode : workers per stage (decode , preprocess , inference , postprocess)
+    bool pipeline = false;
+    int32_t decodeWorkers = 2;
+    int32_t preprocessWorkers = 1;
+    int32_t inferenceWorkers = 1;
+    int32_t postprocessWorkers = 1;
+    int32_t queueCapacity = 8;
+    bool orderedOutput = true;
+
+    // Sessions held by a RunnerPool , shared by all caller threads
+    int32_t numSessions = 1;
+    bool benchThreads = false;
+
+    // Video mode : frames older than the budget are dropped , the decoder keeps the newest videoRingSize frames
+    double latencyBudgetMs = 0.0;
+    int32_t videoRingSize = 4;
+    bool paceVideo = true;
+
+    // Result cache (video and single image loop) : reuse the last detections while no block of the frame
+    // thumbnail changes by more than frameCacheThreshold gray levels , for at most frameCacheMaxStale frames / ms
+    bool frameCache = false;
+    float frameCacheThreshold = 2.0f;
+    int32_t frameCacheMaxStale = 30;
+    double frameCacheMaxAgeMs = 1000.0;
+    bool checkFrameCache = false;
+
+    // Tracking (video) : the detector runs on keyframes , at most trackInterval frames apart , and a
+    // ByteTrack-style tracker carries the boxes in between ; confThreshold is the tracker's high threshold
+    bool tracking = false;
+    int32_t trackInterval = 5;
+    bool trackAdaptive = true;
+    float trackLowThreshold = 0.1f;
+    int32_t trackMaxLost = 30;
+    bool benchTrack = false;
+
+    // Startup : load the optimized graph cached by an earlier run , dummy runs before reporting ready
+    bool modelCache = false;
+    int32_t warmupRuns = 0;
+    bool benchStartup = false;
+
+    // Memory : create sessions from a mapping of the model file (one page-cache copy for every process) ,
+    // and share the mapped weights , prepacked weights and one CPU arena between the sessions of a process
+    bool mmapModel = false;
+    bool shareWeights = false;
+    bool benchMemory = false;
+
+    // Tiled mode : input-size tiles overlapping by tileOverlap , tileWorkers at a time , merged across the seams
+    bool tiled = false;
+    float tileOverlap = 0.2f;
+    bool tileFullPass = true;
+    int32_t tileWorkers = 1;
+    float tileMergeThreshold = 0.5f;
+    bool benchTiles = false;
+
     bool doVisualize = false;
     bool cudaEnable = false;
+    // Bind persistent input/output buffers with Ort::IoBinding instead of new tensors per frame
+    bool ioBinding = false;
+    // Rect mode (dynamic-shape exports) : pad each frame only to the next multiple of 32 instead of the full square
+    bool rectInput = false;
+    // Rect mode : sessions with height / width pinned , one per tensor shape , for providers that need fixed shapes
+    int32_t shapeSessions = 0;
+    // In-graph preprocessing : the model is rewritten to take the letterboxed uint8 NHWC frame , no float blob on the host
+    bool rawInput = false;
+    bool benchBatch = false;
+    bool checkPreprocess = false;
+    // Count heap allocations per stage of warm single image runs (IoBinding path) , fail unless there are none
+    bool checkAllocations = false;
+    bool benchDecode = false;
+    bool benchNMS = false;
+    // Background result writer into SavePath : binary records + index , optionally JSON Lines and annotated images
+    bool saveResults = false;
+    bool saveJsonl = false;
+    bool saveImages = false;
+    int32_t saveEncoders = 1; // Threads encoding annotated images
     
     std::string ModelPath = "models/yolov8-detect.onnx";
     std::string SavePath = "output";
+    // Host profile written by --auto-tune
+    std::string ProfilePath = "host_profile.txt";
+    // Result directory written by -save to summarize instead of running the model
+    std::string ReadResultsPath = "";
+    std::string VideoPath = "";
+    // Where optimized models are cached , empty puts them next to the model
+    std::string CacheDir = "";
+    // INT8 workflow : dump preprocessed calibration tensors , compare ModelPath against a second (quantized) model
+    std::string CalibrationDir = "";
+    std::string CompareModelPath = "";
+    // YOLO-format ground truth (<image stem>.txt : class cx cy w h , normalized) for --bench-tiles recall
+    std::string LabelDir = "";
+    // Runtime log level (trace , debug , info , warn , error , off) , levels below YOLO_LOG_LEVEL are compiled out
+    std::string LogLevel = "info";
+    // Chrome trace-event JSON of the run , empty disables tracing
+    std::string TracePath = "";
 };
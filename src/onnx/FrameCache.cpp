@@ -0,0 +1,164 @@
+#include "FrameCache.h"
+#include "Trace.h"
+
+void FrameSignature(const cv::Mat& frame , cv::Size size , cv::Mat& signature)
+{
+    // Area average first , the color conversion then only touches the thumbnail
+    if (frame.channels() == 1)
+    {
+        cv::resize(frame , signature , size , 0 , 0 , cv::INTER_AREA);
+        return;
+    }
+    cv::Mat thumbnail;
+    cv::resize(frame , thumbnail , size , 0 , 0 , cv::INTER_AREA);
+    cv::cvtColor(thumbnail , signature , frame.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+}
+
+float SignatureChange(const cv::Mat& a , const cv::Mat& b , cv::Size regions)
+{
+    if (a.size() != b.size() || a.empty())
+    {
+        return 255.0f;
+    }
+    int blocksX = std::max(1 , std::min(regions.width , a.cols));
+    int blocksY = std::max(1 , std::min(regions.height , a.rows));
+    float largest = 0.0f;
+    for (int by = 0 ; by < blocksY ; by++)
+    {
+        int y0 = by * a.rows / blocksY , y1 = (by + 1) * a.rows / blocksY;
+        for (int bx = 0 ; bx < blocksX ; bx++)
+        {
+            int x0 = bx * a.cols / blocksX , x1 = (bx + 1) * a.cols / blocksX;
+            int sum = 0;
+            for (int y = y0 ; y < y1 ; y++)
+            {
+                const uint8_t* rowA = a.ptr<uint8_t>(y);
+                const uint8_t* rowB = b.ptr<uint8_t>(y);
+                for (int x = x0 ; x < x1 ; x++)
+                {
+                    sum += std::abs((int)rowA[x] - (int)rowB[x]);
+                }
+            }
+            largest = std::max(largest , (float)sum / ((y1 - y0) * (x1 - x0)));
+        }
+    }
+    return largest;
+}
+
+FrameChangeGate::FrameChangeGate(const FRAME_CACHE_CONFIG& config) : config(config)
+{
+}
+
+void FrameChangeGate::Reset()
+{
+    reference.release();
+    staleFrames = 0;
+    lastChange = 0.0f;
+}
+
+FRAME_CACHE_DECISION FrameChangeGate::Check(const cv::Mat& frame , std::chrono::steady_clock::time_point now)
+{
+    FrameSignature(frame , config.signatureSize , signature);
+
+    FRAME_CACHE_DECISION decision;
+    if (reference.empty())
+    {
+        decision = FRAME_CACHE_EMPTY;
+        lastChange = 0.0f;
+    } else if (frame.size() != referenceSize)
+    {
+        decision = FRAME_CACHE_CHANGED;
+        lastChange = 255.0f;
+    } else
+    {
+        lastChange = SignatureChange(signature , reference , config.regions);
+        double age = std::chrono::duration<double , std::milli>(now - referenceTime).count();
+        if (lastChange > config.threshold)
+        {
+            decision = FRAME_CACHE_CHANGED;
+        } else if ((config.maxStaleFrames > 0 && staleFrames >= config.maxStaleFrames) || \
+            (config.maxStaleMs > 0.0 && age > config.maxStaleMs))
+        {
+            decision = FRAME_CACHE_STALE;
+        } else
+        {
+            staleFrames++;
+            return FRAME_CACHE_HIT;
+        }
+    }
+
+    // Swap , the old reference buffer takes the next signature
+    std::swap(reference , signature);
+    referenceSize = frame.size();
+    referenceTime = now;
+    staleFrames = 0;
+    return decision;
+}
+
+CachedRunner::CachedRunner(YOLOv8OnnxRunner& detector , const FRAME_CACHE_CONFIG& config) : detector(detector) , gate(config)
+{
+}
+
+void CachedRunner::Reset()
+{
+    gate.Reset();
+    cached.clear();
+}
+
+std::vector<DETECT_RESULT> CachedRunner::InferenceSingleImage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx , \
+    FRAME_CACHE_DECISION* decision)
+{
+    if (srcImage.empty())
+    {
+        return std::vector<DETECT_RESULT>();
+    }
+
+    auto time_start = std::chrono::steady_clock::now();
+    FRAME_CACHE_DECISION result;
+    {
+        TRACE_SCOPE("frame signature");
+        result = gate.Check(srcImage , time_start);
+    }
+    double signatureMs = std::chrono::duration<double , std::milli>(std::chrono::steady_clock::now() - time_start).count();
+    stats.lookups++;
+    stats.signatureMs += signatureMs;
+    if (decision != nullptr)
+    {
+        *decision = result;
+    }
+
+    if (result == FRAME_CACHE_HIT)
+    {
+        stats.hits++;
+        stats.savedMs += std::max(0.0 , meanInferenceMs - signatureMs);
+        LOG_TRACE("Frame cache hit , change " << gate.LastChange());
+        return cached;
+    }
+    if (result == FRAME_CACHE_STALE)
+    {
+        stats.stale++;
+    } else
+    {
+        stats.changed++;
+    }
+    LOG_TRACE("Frame cache miss , change " << gate.LastChange() << (result == FRAME_CACHE_STALE ? " , stale" : ""));
+
+    time_start = std::chrono::steady_clock::now();
+    cached = detector.InferenceSingleImage(srcImage , ctx);
+    double inferenceMs = std::chrono::duration<double , std::milli>(std::chrono::steady_clock::now() - time_start).count();
+    stats.inferenceMs += inferenceMs;
+    meanInferenceMs = meanInferenceMs > 0.0 ? 0.9 * meanInferenceMs + 0.1 * inferenceMs : inferenceMs;
+    return cached;
+}
+
+void CachedRunner::PrintReport() const
+{
+    uint64_t misses = stats.lookups - stats.hits;
+    fprintf(stdout, "[CACHE] frames : %llu , hits : %llu (%.1f%%) , misses : %llu changed , %llu stale\n",
+        (unsigned long long)stats.lookups, (unsigned long long)stats.hits,
+        stats.lookups > 0 ? 100.0 * stats.hits / stats.lookups : 0.0,
+        (unsigned long long)stats.changed, (unsigned long long)stats.stale);
+    fprintf(stdout, "[CACHE] inference per miss %.2fms , signature per frame %.3fms , latency saved %.1fms (%.2fms per frame)\n",
+        misses > 0 ? stats.inferenceMs / misses : 0.0, stats.lookups > 0 ? stats.signatureMs / stats.lookups : 0.0,
+        stats.savedMs, stats.lookups > 0 ? stats.savedMs / stats.lookups : 0.0);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+
+#include "YOLOv8OnnxRunner.h"
+
+typedef struct _FRAME_CACHE_CONFIG
+{
+    cv::Size signatureSize = cv::Size(64 , 36); // Grayscale thumbnail (area average) compared between frames
+    cv::Size regions = cv::Size(4 , 3); // Blocks of the thumbnail , the most changed one decides
+    float threshold = 2.0f; // Mean absolute gray level difference of a block (0..255) under which a frame is unchanged
+    int maxStaleFrames = 30; // Consecutive cached results before inference runs anyway , 0 disables
+    double maxStaleMs = 1000.0; // Age of the cached result before inference runs anyway , 0 disables
+} FRAME_CACHE_CONFIG;
+
+enum FRAME_CACHE_DECISION { FRAME_CACHE_HIT , FRAME_CACHE_EMPTY , FRAME_CACHE_CHANGED , FRAME_CACHE_STALE };
+
+typedef struct _FRAME_CACHE_STATS
+{
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    uint64_t changed = 0; // Misses because the signature moved past the threshold (or the frame size changed)
+    uint64_t stale = 0; // Misses forced by maxStaleFrames / maxStaleMs
+    double signatureMs = 0.0; // Thumbnail and comparison , paid on every lookup
+    double inferenceMs = 0.0; // Inference on misses
+    double savedMs = 0.0; // Hits x the running mean inference time of a miss , minus the signature of those hits
+} FRAME_CACHE_STATS;
+
+/*
+    Decides whether a frame may reuse the result of the last frame inference ran on. Frames are
+    compared against that reference frame , not the previous one , so a slow drift (lighting ,
+    a creeping object) still adds up to a miss. The change is measured per block : a person
+    entering one corner of a wide view barely moves the mean of the whole frame but moves one
+    block a lot. Objects smaller than a thumbnail pixel are below its resolution ; the staleness
+    limits bound how long such a change can go unseen.
+*/
+class FrameChangeGate
+{
+private:
+    FRAME_CACHE_CONFIG config;
+    cv::Mat reference; // Signature of the frame behind the cached result
+    cv::Size referenceSize;
+    cv::Mat signature;
+    std::chrono::steady_clock::time_point referenceTime;
+    int staleFrames = 0;
+    float lastChange = 0.0f;
+
+public:
+    explicit FrameChangeGate(const FRAME_CACHE_CONFIG& config);
+
+    // On anything but a hit , frame becomes the new reference : run inference on it and store the result
+    FRAME_CACHE_DECISION Check(const cv::Mat& frame , std::chrono::steady_clock::time_point now);
+    void Reset();
+
+    // Change of the most changed block at the last Check , 0..255
+    float LastChange() const { return lastChange; }
+};
+
+// Thumbnail signature , CV_8UC1 of size
+void FrameSignature(const cv::Mat& frame , cv::Size size , cv::Mat& signature);
+
+// Largest mean absolute difference over the regions.width x regions.height blocks of two signatures
+float SignatureChange(const cv::Mat& a , const cv::Mat& b , cv::Size regions);
+
+/*
+    Result cache in front of YOLOv8OnnxRunner::InferenceSingleImage for static scenes : frames
+    the gate finds unchanged get the detections of the reference frame back without touching
+    the session. One CachedRunner per stream , results of one camera must not serve another.
+*/
+class CachedRunner
+{
+private:
+    YOLOv8OnnxRunner& detector;
+    FrameChangeGate gate;
+    std::vector<DETECT_RESULT> cached;
+    double meanInferenceMs = 0.0; // Exponential mean over misses , the estimate of what a hit saves
+    FRAME_CACHE_STATS stats;
+
+public:
+    CachedRunner(YOLOv8OnnxRunner& detector , const FRAME_CACHE_CONFIG& config);
+
+    // Not thread safe. decision , when given , tells whether the result came from the cache
+    std::vector<DETECT_RESULT> InferenceSingleImage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx , \
+        FRAME_CACHE_DECISION* decision = nullptr);
+    // Drop the cached result , e.g. on a scene cut or a new stream
+    void Reset();
+
+    FRAME_CACHE_STATS GetStats() const { return stats; }
+    void PrintReport() const;
+};
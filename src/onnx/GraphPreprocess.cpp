@@ -0,0 +1,506 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "GraphPreprocess.h"
+
+// onnx.proto field numbers touched by the rewrite
+#define MODEL_GRAPH 7
+#define GRAPH_NODE 1
+#define GRAPH_INITIALIZER 5
+#define GRAPH_INPUT 11
+#define NODE_INPUT 1
+#define NODE_OUTPUT 2
+#define NODE_NAME 3
+#define NODE_OP_TYPE 4
+#define NODE_ATTRIBUTE 5
+#define ATTRIBUTE_NAME 1
+#define ATTRIBUTE_I 3
+#define ATTRIBUTE_INTS 8
+#define ATTRIBUTE_TYPE 20
+#define TENSOR_DIMS 1
+#define TENSOR_DATA_TYPE 2
+#define TENSOR_NAME 8
+#define TENSOR_RAW_DATA 9
+#define TENSOR_DATA_LOCATION 14
+#define VALUE_INFO_NAME 1
+#define VALUE_INFO_TYPE 2
+#define TYPE_TENSOR_TYPE 1
+#define TENSOR_TYPE_ELEM_TYPE 1
+#define TENSOR_TYPE_SHAPE 2
+#define SHAPE_DIM 1
+#define DIM_VALUE 1
+
+#define ATTRIBUTE_TYPE_INT 2
+#define ATTRIBUTE_TYPE_INTS 7
+#define ELEM_TYPE_FLOAT 1
+#define ELEM_TYPE_UINT8 2
+#define DATA_LOCATION_EXTERNAL 1
+
+#define WIRE_VARINT 0
+#define WIRE_FIXED64 1
+#define WIRE_BYTES 2
+#define WIRE_FIXED32 5
+
+typedef struct _WIRE_FIELD
+{
+    uint32_t number;
+    uint32_t wireType;
+    uint64_t value = 0; // Varint fields only
+    size_t begin; // Key included , [begin , end) is the whole field
+    size_t end;
+    size_t dataBegin; // Length-delimited fields : payload is [dataBegin , end)
+} WIRE_FIELD;
+
+static bool ReadVarint(std::string_view bytes , size_t end , size_t& pos , uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0 ; shift < 64 && pos < end ; shift += 7)
+    {
+        uint8_t byte = (uint8_t)bytes[pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Top-level fields of the message stored in bytes[begin , end)
+static bool ParseFields(std::string_view bytes , size_t begin , size_t end , std::vector<WIRE_FIELD>& fields)
+{
+    size_t pos = begin;
+    while (pos < end)
+    {
+        WIRE_FIELD field;
+        field.begin = pos;
+        field.dataBegin = pos;
+        uint64_t key;
+        if (!ReadVarint(bytes , end , pos , key))
+        {
+            return false;
+        }
+        field.number = (uint32_t)(key >> 3);
+        field.wireType = (uint32_t)(key & 7);
+        switch (field.wireType)
+        {
+        case WIRE_VARINT:
+            if (!ReadVarint(bytes , end , pos , field.value))
+            {
+                return false;
+            }
+            break;
+        case WIRE_FIXED64:
+            pos += 8;
+            break;
+        case WIRE_FIXED32:
+            pos += 4;
+            break;
+        case WIRE_BYTES:
+        {
+            uint64_t length;
+            if (!ReadVarint(bytes , end , pos , length) || length > end - pos)
+            {
+                return false;
+            }
+            field.dataBegin = pos;
+            pos += (size_t)length;
+            break;
+        }
+        default:
+            // Groups do not occur in onnx.proto
+            return false;
+        }
+        if (pos > end)
+        {
+            return false;
+        }
+        field.end = pos;
+        fields.push_back(field);
+    }
+    return true;
+}
+
+static bool ParseSubFields(std::string_view bytes , const WIRE_FIELD& field , std::vector<WIRE_FIELD>& fields)
+{
+    return field.wireType == WIRE_BYTES && ParseFields(bytes , field.dataBegin , field.end , fields);
+}
+
+static std::string PayloadString(std::string_view bytes , const WIRE_FIELD& field)
+{
+    return std::string(bytes.substr(field.dataBegin , field.end - field.dataBegin));
+}
+
+static void WriteVarint(std::string& out , uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+static void WriteVarintField(std::string& out , uint32_t number , uint64_t value)
+{
+    WriteVarint(out , ((uint64_t)number << 3) | WIRE_VARINT);
+    WriteVarint(out , value);
+}
+
+static void WriteBytesField(std::string& out , uint32_t number , const std::string& payload)
+{
+    WriteVarint(out , ((uint64_t)number << 3) | WIRE_BYTES);
+    WriteVarint(out , payload.size());
+    out += payload;
+}
+
+static std::string IntAttribute(const char* name , int64_t value)
+{
+    std::string attribute;
+    WriteBytesField(attribute , ATTRIBUTE_NAME , name);
+    WriteVarintField(attribute , ATTRIBUTE_I , (uint64_t)value);
+    WriteVarintField(attribute , ATTRIBUTE_TYPE , ATTRIBUTE_TYPE_INT);
+    return attribute;
+}
+
+static std::string IntsAttribute(const char* name , const std::vector<int64_t>& values)
+{
+    std::string attribute;
+    WriteBytesField(attribute , ATTRIBUTE_NAME , name);
+    for (int64_t value : values)
+    {
+        WriteVarintField(attribute , ATTRIBUTE_INTS , (uint64_t)value);
+    }
+    WriteVarintField(attribute , ATTRIBUTE_TYPE , ATTRIBUTE_TYPE_INTS);
+    return attribute;
+}
+
+static std::string Node(const std::string& name , const char* opType , const std::vector<std::string>& inputs , \
+    const std::string& output , const std::string& attribute)
+{
+    std::string node;
+    for (const auto& input : inputs)
+    {
+        WriteBytesField(node , NODE_INPUT , input);
+    }
+    WriteBytesField(node , NODE_OUTPUT , output);
+    WriteBytesField(node , NODE_NAME , name);
+    WriteBytesField(node , NODE_OP_TYPE , opType);
+    if (!attribute.empty())
+    {
+        WriteBytesField(node , NODE_ATTRIBUTE , attribute);
+    }
+    return node;
+}
+
+// 0-d float initializer
+static std::string ScalarInitializer(const std::string& name , float value)
+{
+    std::string tensor;
+    WriteVarintField(tensor , TENSOR_DATA_TYPE , ELEM_TYPE_FLOAT);
+    WriteBytesField(tensor , TENSOR_NAME , name);
+    std::string raw(sizeof(float) , '\0');
+    memcpy(&raw[0] , &value , sizeof(float)); // raw_data is little endian , as is every target of this runner
+    WriteBytesField(tensor , TENSOR_RAW_DATA , raw);
+    return tensor;
+}
+
+static std::string FieldName(std::string_view bytes , const WIRE_FIELD& message , uint32_t nameNumber)
+{
+    std::vector<WIRE_FIELD> fields;
+    if (!ParseSubFields(bytes , message , fields))
+    {
+        return std::string();
+    }
+    for (const auto& field : fields)
+    {
+        if (field.number == nameNumber && field.wireType == WIRE_BYTES)
+        {
+            return PayloadString(bytes , field);
+        }
+    }
+    return std::string();
+}
+
+/* Checks the input is float [N , 3 , H , W] and returns its Dimension messages as is ,
+   so symbolic axes (batch , height , width) keep their names in the new input */
+static bool InputDimensions(std::string_view bytes , const WIRE_FIELD& input , std::vector<std::string>& dims , \
+    std::string& error)
+{
+    std::vector<WIRE_FIELD> valueInfo , typeProto , tensorType , shape;
+    if (!ParseSubFields(bytes , input , valueInfo))
+    {
+        error = "malformed graph input";
+        return false;
+    }
+    for (const auto& field : valueInfo)
+    {
+        if (field.number == VALUE_INFO_TYPE)
+        {
+            ParseSubFields(bytes , field , typeProto);
+        }
+    }
+    for (const auto& field : typeProto)
+    {
+        if (field.number == TYPE_TENSOR_TYPE)
+        {
+            ParseSubFields(bytes , field , tensorType);
+        }
+    }
+    uint64_t elemType = 0;
+    for (const auto& field : tensorType)
+    {
+        if (field.number == TENSOR_TYPE_ELEM_TYPE && field.wireType == WIRE_VARINT)
+        {
+            elemType = field.value;
+        } else if (field.number == TENSOR_TYPE_SHAPE)
+        {
+            ParseSubFields(bytes , field , shape);
+        }
+    }
+    if (elemType != ELEM_TYPE_FLOAT)
+    {
+        error = "input is not a float tensor";
+        return false;
+    }
+
+    dims.clear();
+    uint64_t channels = 0;
+    for (const auto& field : shape)
+    {
+        if (field.number != SHAPE_DIM)
+        {
+            continue;
+        }
+        if (dims.size() == 1)
+        {
+            std::vector<WIRE_FIELD> dim;
+            ParseSubFields(bytes , field , dim);
+            for (const auto& value : dim)
+            {
+                if (value.number == DIM_VALUE && value.wireType == WIRE_VARINT)
+                {
+                    channels = value.value;
+                }
+            }
+        }
+        dims.push_back(PayloadString(bytes , field));
+    }
+    if (dims.size() != 4 || (channels != 0 && channels != 3))
+    {
+        error = "input is not [N , 3 , H , W]";
+        return false;
+    }
+    return true;
+}
+
+bool AddInGraphPreprocess(const std::string& modelBytes , std::string& augmented , std::string& error)
+{
+    std::vector<WIRE_FIELD> modelFields;
+    if (!ParseFields(modelBytes , 0 , modelBytes.size() , modelFields))
+    {
+        error = "not a serialized ModelProto";
+        return false;
+    }
+    const WIRE_FIELD* graphField = nullptr;
+    for (const auto& field : modelFields)
+    {
+        if (field.number == MODEL_GRAPH)
+        {
+            if (graphField != nullptr)
+            {
+                error = "model holds more than one graph field";
+                return false;
+            }
+            graphField = &field;
+        }
+    }
+    std::vector<WIRE_FIELD> graphFields;
+    if (graphField == nullptr || !ParseSubFields(modelBytes , *graphField , graphFields))
+    {
+        error = "model has no readable graph";
+        return false;
+    }
+
+    // Old IR versions list initializers among the inputs too , the image input is the first other one
+    std::set<std::string> initializers;
+    for (const auto& field : graphFields)
+    {
+        if (field.number == GRAPH_INITIALIZER)
+        {
+            initializers.insert(FieldName(modelBytes , field , TENSOR_NAME));
+        }
+    }
+    const WIRE_FIELD* inputField = nullptr;
+    std::string inputName;
+    for (const auto& field : graphFields)
+    {
+        if (field.number == GRAPH_INPUT)
+        {
+            inputName = FieldName(modelBytes , field , VALUE_INFO_NAME);
+            if (initializers.count(inputName) == 0)
+            {
+                inputField = &field;
+                break;
+            }
+        }
+    }
+    if (inputField == nullptr)
+    {
+        error = "graph has no input";
+        return false;
+    }
+    std::vector<std::string> dims;
+    if (!InputDimensions(modelBytes , *inputField , dims , error))
+    {
+        return false;
+    }
+
+    // [N , 3 , H , W] float -> [N , H , W , 3] uint8
+    std::string rawName = inputName + RAW_INPUT_SUFFIX;
+    std::string channelDim;
+    WriteVarintField(channelDim , DIM_VALUE , 3);
+    std::string shape;
+    for (const std::string& dim : { dims[0] , dims[2] , dims[3] , channelDim })
+    {
+        WriteBytesField(shape , SHAPE_DIM , dim);
+    }
+    std::string tensorType;
+    WriteVarintField(tensorType , TENSOR_TYPE_ELEM_TYPE , ELEM_TYPE_UINT8);
+    WriteBytesField(tensorType , TENSOR_TYPE_SHAPE , shape);
+    std::string typeProto;
+    WriteBytesField(typeProto , TYPE_TENSOR_TYPE , tensorType);
+    std::string rawInput;
+    WriteBytesField(rawInput , VALUE_INFO_NAME , rawName);
+    WriteBytesField(rawInput , VALUE_INFO_TYPE , typeProto);
+
+    // Transpose the bytes before the Cast , a quarter of the memory traffic of transposing floats ;
+    // Div by 255 , not Mul by 1/255 , so the values match the host Normalize bit for bit
+    std::string transposed = inputName + "/preprocess/nchw_u8";
+    std::string casted = inputName + "/preprocess/nchw_f32";
+    std::string scale = inputName + "/preprocess/scale";
+    std::string graph;
+    WriteBytesField(graph , GRAPH_NODE , Node(inputName + "/preprocess/Transpose" , "Transpose" , { rawName } , \
+        transposed , IntsAttribute("perm" , { 0 , 3 , 1 , 2 })));
+    WriteBytesField(graph , GRAPH_NODE , Node(inputName + "/preprocess/Cast" , "Cast" , { transposed } , \
+        casted , IntAttribute("to" , ELEM_TYPE_FLOAT)));
+    WriteBytesField(graph , GRAPH_NODE , Node(inputName + "/preprocess/Div" , "Div" , { casted , scale } , \
+        inputName , std::string()));
+    WriteBytesField(graph , GRAPH_INITIALIZER , ScalarInitializer(scale , 255.0f));
+    for (const auto& field : graphFields)
+    {
+        if (&field == inputField)
+        {
+            // Same position , so the image stays input 0
+            WriteBytesField(graph , GRAPH_INPUT , rawInput);
+        } else
+        {
+            graph.append(modelBytes , field.begin , field.end - field.begin);
+        }
+    }
+
+    augmented.clear();
+    augmented.reserve(modelBytes.size() + 1024);
+    for (const auto& field : modelFields)
+    {
+        if (&field == graphField)
+        {
+            WriteBytesField(augmented , MODEL_GRAPH , graph);
+        } else
+        {
+            augmented.append(modelBytes , field.begin , field.end - field.begin);
+        }
+    }
+    return true;
+}
+
+bool ListRawInitializers(std::string_view modelBytes , std::vector<RAW_INITIALIZER>& initializers)
+{
+    initializers.clear();
+    std::vector<WIRE_FIELD> modelFields , graphFields;
+    if (!ParseFields(modelBytes , 0 , modelBytes.size() , modelFields))
+    {
+        return false;
+    }
+    for (const auto& field : modelFields)
+    {
+        if (field.number == MODEL_GRAPH && !ParseSubFields(modelBytes , field , graphFields))
+        {
+            return false;
+        }
+    }
+
+    for (const auto& field : graphFields)
+    {
+        std::vector<WIRE_FIELD> tensorFields;
+        if (field.number != GRAPH_INITIALIZER || !ParseSubFields(modelBytes , field , tensorFields))
+        {
+            continue;
+        }
+        RAW_INITIALIZER initializer;
+        bool hasRawData = false , external = false;
+        for (const auto& tensorField : tensorFields)
+        {
+            switch (tensorField.number)
+            {
+            case TENSOR_DIMS:
+                if (tensorField.wireType == WIRE_VARINT)
+                {
+                    initializer.dims.push_back((int64_t)tensorField.value);
+                } else if (tensorField.wireType == WIRE_BYTES)
+                {
+                    // Packed repeated int64
+                    size_t pos = tensorField.dataBegin;
+                    uint64_t value;
+                    while (pos < tensorField.end && ReadVarint(modelBytes , tensorField.end , pos , value))
+                    {
+                        initializer.dims.push_back((int64_t)value);
+                    }
+                }
+                break;
+            case TENSOR_DATA_TYPE:
+                initializer.dataType = (int32_t)tensorField.value;
+                break;
+            case TENSOR_NAME:
+                initializer.name = PayloadString(modelBytes , tensorField);
+                break;
+            case TENSOR_RAW_DATA:
+                hasRawData = tensorField.wireType == WIRE_BYTES;
+                initializer.offset = tensorField.dataBegin;
+                initializer.bytes = tensorField.end - tensorField.dataBegin;
+                break;
+            case TENSOR_DATA_LOCATION:
+                external = tensorField.value == DATA_LOCATION_EXTERNAL;
+                break;
+            }
+        }
+        if (hasRawData && !external && !initializer.name.empty())
+        {
+            initializers.push_back(initializer);
+        }
+    }
+    return true;
+}
+
+bool ReadModelFile(const std::string& path , std::string& bytes)
+{
+    FILE* file = fopen(path.c_str() , "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    fseek(file , 0 , SEEK_END);
+    long size = ftell(file);
+    fseek(file , 0 , SEEK_SET);
+    bool ok = size >= 0;
+    if (ok)
+    {
+        bytes.resize((size_t)size);
+        ok = fread(&bytes[0] , 1 , bytes.size() , file) == bytes.size();
+    }
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+/*
+    In-graph preprocessing. The serialized model is rewritten at load time so its first input
+    takes the letterboxed 8-bit BGR frame as is , [N , H , W , 3] uint8 , and the graph itself
+    does Transpose -> Cast -> Div(255) into the original float NCHW input. The runner then hands
+    the cv::Mat buffer to ORT without a float blob on the host.
+
+    The rewrite works on the protobuf wire format directly (no onnx / protobuf dependency) :
+    the original input is replaced in place , the three nodes and the 255 constant are put in
+    front of the graph , everything else is copied byte for byte. The original input name
+    becomes the Div output , so no existing node has to be touched.
+*/
+
+// Name given to the new uint8 NHWC graph input
+#define RAW_INPUT_SUFFIX "_nhwc_u8"
+
+/* modelBytes : serialized ModelProto with a float [N , 3 , H , W] first input.
+   Returns false and fills error when the model cannot be rewritten (e.g. not a float 4-D input). */
+bool AddInGraphPreprocess(const std::string& modelBytes , std::string& augmented , std::string& error);
+
+// Whole file content , false when it cannot be read
+bool ReadModelFile(const std::string& path , std::string& bytes);
+
+// Initializer whose data sits in raw_data , located by offset into the serialized model
+typedef struct _RAW_INITIALIZER
+{
+    std::string name;
+    int32_t dataType = 0; // TensorProto.DataType , 1 is float
+    std::vector<int64_t> dims;
+    size_t offset = 0; // raw_data payload in the model bytes
+    size_t bytes = 0;
+} RAW_INITIALIZER;
+
+/* Graph initializers stored as raw_data , found with the same wire reader. Lets a caller that
+   keeps the model bytes alive (mapped) hand the weights to ORT in place. Typed fields
+   (float_data ...) and external data are not listed. False when the model is malformed. */
+bool ListRawInitializers(std::string_view modelBytes , std::vector<RAW_INITIALIZER>& initializers);
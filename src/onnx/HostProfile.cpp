@@ -0,0 +1,325 @@
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <map>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+
+#include "HostProfile.h"
+#include "Trace.h"
+
+static const char* AFFINITY_NAMES[] = { "none" , "cores" , "numa" };
+
+#ifndef _WIN32
+// Linux cpulist : "0-3,8-11"
+static std::vector<int> ParseCpuList(const std::string& text)
+{
+    std::vector<int> processors;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream , item , ','))
+    {
+        int first = 0 , last = 0;
+        int fields = sscanf(item.c_str() , "%d-%d" , &first , &last);
+        if (fields < 1)
+        {
+            continue;
+        }
+        for (int p = first ; p <= (fields == 2 ? last : first) ; p++)
+        {
+            processors.push_back(p);
+        }
+    }
+    return processors;
+}
+#endif
+
+static HOST_TOPOLOGY QueryHostTopology()
+{
+    HOST_TOPOLOGY topology;
+    topology.logicalProcessors = std::max(1 , (int)std::thread::hardware_concurrency());
+#ifdef _WIN32
+    // More than 64 processors span several groups , ORT numbers them group by group like this
+    DWORD active = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    if (active > 0)
+    {
+        topology.logicalProcessors = (int)active;
+    }
+    ULONG highest = 0;
+    if (GetNumaHighestNodeNumber(&highest))
+    {
+        for (ULONG node = 0 ; node <= highest ; node++)
+        {
+            GROUP_AFFINITY affinity;
+            if (!GetNumaNodeProcessorMaskEx((USHORT)node , &affinity) || affinity.Mask == 0)
+            {
+                continue;
+            }
+            std::vector<int> processors;
+            for (int bit = 0 ; bit < 64 ; bit++)
+            {
+                if (affinity.Mask & ((KAFFINITY)1 << bit))
+                {
+                    processors.push_back(affinity.Group * 64 + bit);
+                }
+            }
+            topology.nodes.push_back(processors);
+        }
+    }
+#else
+    std::map<int , std::vector<int>> nodes;
+    std::error_code error;
+    for (auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node" , error))
+    {
+        std::string name = entry.path().filename().string();
+        int node = -1;
+        if (name.rfind("node" , 0) != 0 || sscanf(name.c_str() + 4 , "%d" , &node) != 1)
+        {
+            continue;
+        }
+        std::ifstream cpuList((entry.path() / "cpulist").string());
+        std::string text;
+        std::vector<int> processors;
+        if (std::getline(cpuList , text) && !(processors = ParseCpuList(text)).empty())
+        {
+            nodes[node] = processors;
+        }
+    }
+    for (auto& node : nodes)
+    {
+        topology.nodes.push_back(node.second);
+    }
+#endif
+    if (topology.nodes.empty())
+    {
+        topology.nodes.emplace_back();
+        for (int p = 0 ; p < topology.logicalProcessors ; p++)
+        {
+            topology.nodes.back().push_back(p);
+        }
+    }
+    return topology;
+}
+
+const HOST_TOPOLOGY& GetHostTopology()
+{
+    static const HOST_TOPOLOGY topology = QueryHostTopology();
+    return topology;
+}
+
+std::string GetHostName()
+{
+#ifdef _WIN32
+    char name[MAX_COMPUTERNAME_LENGTH + 1] = { 0 };
+    DWORD size = sizeof(name);
+    if (GetComputerNameA(name , &size))
+    {
+        return std::string(name , size);
+    }
+#else
+    char name[256] = { 0 };
+    if (gethostname(name , sizeof(name) - 1) == 0)
+    {
+        return name;
+    }
+#endif
+    return "unknown";
+}
+
+const char* ThreadAffinityName(THREAD_AFFINITY affinity)
+{
+    return AFFINITY_NAMES[affinity];
+}
+
+bool ParseThreadAffinity(const std::string& name , THREAD_AFFINITY& affinity)
+{
+    for (int i = 0 ; i < 3 ; i++)
+    {
+        if (name == AFFINITY_NAMES[i])
+        {
+            affinity = (THREAD_AFFINITY)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 1-based ids , runs of consecutive processors as ranges : "1-4,9"
+static std::string FormatProcessors(const std::vector<int>& processors)
+{
+    std::string text;
+    for (size_t i = 0 ; i < processors.size() ; )
+    {
+        size_t j = i;
+        while (j + 1 < processors.size() && processors[j + 1] == processors[j] + 1)
+        {
+            j++;
+        }
+        text += (text.empty() ? "" : ",") + std::to_string(processors[i] + 1);
+        if (j > i)
+        {
+            text += "-" + std::to_string(processors[j] + 1);
+        }
+        i = j + 1;
+    }
+    return text;
+}
+
+std::string IntraOpAffinities(const HOST_TOPOLOGY& topology , THREAD_AFFINITY affinity , int intraThreads , int slot)
+{
+    if (affinity == AFFINITY_NONE || intraThreads <= 1 || topology.nodes.empty())
+    {
+        return "";
+    }
+
+    std::string affinities;
+    if (affinity == AFFINITY_CORES)
+    {
+        // Node by node , so blocks stay inside a node whenever the node size allows it
+        std::vector<int> processors;
+        for (auto& node : topology.nodes)
+        {
+            processors.insert(processors.end() , node.begin() , node.end());
+        }
+        // Slot 0 is the calling thread's processor in the block , the pool threads take the rest
+        size_t start = (size_t)slot * intraThreads;
+        for (int t = 1 ; t < intraThreads ; t++)
+        {
+            int processor = processors[(start + t) % processors.size()];
+            affinities += (affinities.empty() ? "" : ";") + std::to_string(processor + 1);
+        }
+    } else
+    {
+        const std::vector<int>& node = topology.nodes[(size_t)slot % topology.nodes.size()];
+        std::string processors = FormatProcessors(node);
+        for (int t = 1 ; t < intraThreads ; t++)
+        {
+            affinities += (affinities.empty() ? "" : ";") + processors;
+        }
+    }
+    return affinities;
+}
+
+Configuration PoolSessionConfig(const Configuration& cfg , int numSessions , int slot)
+{
+    Configuration sessionCfg = cfg;
+    sessionCfg.sessionSlot = slot;
+    if (numSessions > 1 && cfg.poolIntraThreads > 0)
+    {
+        sessionCfg.intraThreads = cfg.poolIntraThreads;
+        sessionCfg.num_thread = std::min(cfg.num_thread , cfg.poolIntraThreads);
+        sessionCfg.threadAffinity = cfg.poolAffinity;
+    }
+    return sessionCfg;
+}
+
+bool LoadHostProfile(const std::string& path , Configuration& cfg)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::map<std::string , std::string> values;
+    std::string line;
+    while (std::getline(file , line))
+    {
+        size_t equal = line.find('=');
+        if (line.empty() || line[0] == '#' || equal == std::string::npos)
+        {
+            continue;
+        }
+        auto trim = [](std::string text)
+        {
+            text.erase(0 , text.find_first_not_of(" \t\r"));
+            text.erase(text.find_last_not_of(" \t\r") + 1);
+            return text;
+        };
+        values[trim(line.substr(0 , equal))] = trim(line.substr(equal + 1));
+    }
+
+    // Thread counts and processor ids only make sense on the machine they were measured on
+    const HOST_TOPOLOGY& topology = GetHostTopology();
+    if (values["host"] != GetHostName() || values["logical_processors"] != std::to_string(topology.logicalProcessors))
+    {
+        LOG_WARN("Host profile " << path << " was tuned on " << values["host"] << " (" << values["logical_processors"] \
+            << " processors) , not applied ; run --auto-tune on this machine");
+        return false;
+    }
+
+    Configuration profile = cfg;
+    try
+    {
+        profile.intraThreads = std::max(0 , std::stoi(values.at("intra_threads")));
+        profile.num_thread = std::max(1 , std::stoi(values.at("inter_threads")));
+        profile.parallelExecution = values.at("execution_mode") == "parallel";
+        profile.allowSpinning = values.at("allow_spinning") != "0";
+        profile.numSessions = std::max(1 , std::stoi(values.at("sessions")));
+        profile.poolIntraThreads = std::max(0 , std::stoi(values.at("pool_intra_threads")));
+        if (!ParseThreadAffinity(values.at("affinity") , profile.threadAffinity) || \
+            !ParseThreadAffinity(values.at("pool_affinity") , profile.poolAffinity))
+        {
+            throw std::invalid_argument("affinity");
+        }
+    }
+    catch(const std::exception& e)
+    {
+        LOG_WARN("Host profile " << path << " is incomplete or malformed (" << e.what() << ") , not applied");
+        return false;
+    }
+    cfg = profile;
+    LOG_INFO("Host profile " << path << " : intra-op " << cfg.intraThreads << " , inter-op " << cfg.num_thread \
+        << " , " << (cfg.parallelExecution ? "parallel" : "sequential") << " , spinning " << (cfg.allowSpinning ? "on" : "off") \
+        << " , affinity " << ThreadAffinityName(cfg.threadAffinity) << " ; runner pool : sessions " << cfg.numSessions \
+        << " , intra-op " << cfg.poolIntraThreads << " , affinity " << ThreadAffinityName(cfg.poolAffinity));
+    return true;
+}
+
+bool LoadHostProfileArgs(int argc , char** argv , Configuration& cfg)
+{
+    for (int i = 1 ; i + 1 < argc ; i++)
+    {
+        if (std::string(argv[i]) == "--profile")
+        {
+            cfg.ProfilePath = argv[++i];
+        }
+    }
+    return LoadHostProfile(cfg.ProfilePath , cfg);
+}
+
+bool SaveHostProfile(const std::string& path , const Configuration& cfg , const std::string& comment)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    std::stringstream commentLines(comment);
+    std::string line;
+    while (std::getline(commentLines , line))
+    {
+        file << "# " << line << "\n";
+    }
+    file << "host = " << GetHostName() << "\n";
+    file << "logical_processors = " << GetHostTopology().logicalProcessors << "\n";
+    file << "intra_threads = " << cfg.intraThreads << "\n";
+    file << "inter_threads = " << cfg.num_thread << "\n";
+    file << "execution_mode = " << (cfg.parallelExecution ? "parallel" : "sequential") << "\n";
+    file << "allow_spinning = " << (cfg.allowSpinning ? 1 : 0) << "\n";
+    file << "affinity = " << ThreadAffinityName(cfg.threadAffinity) << "\n";
+    file << "sessions = " << cfg.numSessions << "\n";
+    file << "pool_intra_threads = " << cfg.poolIntraThreads << "\n";
+    file << "pool_affinity = " << ThreadAffinityName(cfg.poolAffinity) << "\n";
+    return (bool)file;
+}
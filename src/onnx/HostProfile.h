@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Configuration.h"
+
+typedef struct _HOST_TOPOLOGY
+{
+    int logicalProcessors = 1;
+    std::vector<std::vector<int>> nodes; // 0-based logical processor ids of each NUMA node , one node when unknown
+} HOST_TOPOLOGY;
+
+// Processors and NUMA nodes of this machine , queried once
+const HOST_TOPOLOGY& GetHostTopology();
+
+// Machine name recorded in the profile
+std::string GetHostName();
+
+const char* ThreadAffinityName(THREAD_AFFINITY affinity);
+
+// "none" , "cores" or "numa" , false for anything else
+bool ParseThreadAffinity(const std::string& name , THREAD_AFFINITY& affinity);
+
+/*
+    ORT session.intra_op_thread_affinities for the slot-th session of a process : one entry per
+    intra-op pool thread (intraThreads - 1 , ORT never pins the calling thread) , 1-based processor ids.
+      cores : every session owns a block of intraThreads consecutive processors , one thread per processor
+      numa  : sessions are dealt round robin over the nodes , their threads may run anywhere on their node
+    Empty when nothing is pinned : affinity none , a single intra-op thread , or unset intraThreads.
+*/
+std::string IntraOpAffinities(const HOST_TOPOLOGY& topology , THREAD_AFFINITY affinity , int intraThreads , int slot);
+
+/* Configuration of the slot-th session of a RunnerPool of numSessions : the pool threading of the
+   profile (poolIntraThreads , poolAffinity) when there are several sessions and it is set */
+Configuration PoolSessionConfig(const Configuration& cfg , int numSessions , int slot);
+
+/* Threading settings of a profile written by --auto-tune , those of a lone runner and those of a
+   RunnerPool (numSessions , poolIntraThreads , poolAffinity). False (cfg untouched) when the file is
+   missing or unreadable , or was tuned on another machine : name or processor count differ. */
+bool LoadHostProfile(const std::string& path , Configuration& cfg);
+
+/* Startup : the profile named by the last --profile FNAME of argv , else cfg.ProfilePath. Called before
+   the flags are parsed , so any threading flag overrides the profile wherever --profile appears. */
+bool LoadHostProfileArgs(int argc , char** argv , Configuration& cfg);
+
+// Writes the threading settings of cfg for this machine , comment is stored as # lines
+bool SaveHostProfile(const std::string& path , const Configuration& cfg , const std::string& comment);
@@ -0,0 +1,284 @@
+#include <cstring>
+#include <filesystem>
+
+#include "InferenceServer.h"
+#include "Trace.h"
+
+InferenceServer::InferenceServer(const Configuration& cfg , const SERVER_CONFIG& config)
+    : config(config) , pool(cfg , config.sessions) , queue(std::max(1 , config.maxQueue))
+{
+    this->config.maxBatch = std::max(1 , config.maxBatch);
+    this->config.sessions = (int)pool.Size();
+}
+
+void InferenceServer::Respond(SERVER_CONNECTION& connection , WIRE_RESPONSE response , const std::vector<DETECT_RESULT>& result)
+{
+    response.count = (uint32_t)result.size();
+    // Header and detections in one send
+    std::vector<char> message(sizeof(WIRE_RESPONSE) + result.size() * sizeof(WIRE_DETECTION));
+    memcpy(message.data() , &response , sizeof(WIRE_RESPONSE));
+    WIRE_DETECTION* detections = (WIRE_DETECTION*)(message.data() + sizeof(WIRE_RESPONSE));
+    for (size_t i = 0 ; i < result.size() ; i++)
+    {
+        detections[i].classId = result[i].classId;
+        detections[i].confidence = result[i].confidence;
+        detections[i].x = result[i].box.x;
+        detections[i].y = result[i].box.y;
+        detections[i].width = result[i].box.width;
+        detections[i].height = result[i].box.height;
+    }
+
+    std::lock_guard<std::mutex> lock(connection.writeMutex);
+    if (connection.open)
+    {
+        SendAll(connection.socket , message.data() , message.size());
+    }
+}
+
+void InferenceServer::ReadLoop(std::shared_ptr<SERVER_CONNECTION> connection)
+{
+    Tracer::SetThreadName("connection");
+    WIRE_REQUEST header;
+    std::vector<uint8_t> payload;
+    while (RecvAll(connection->socket , &header , sizeof(header)))
+    {
+        WIRE_RESPONSE response;
+        response.requestId = header.requestId;
+        if (header.magic != SERVER_MAGIC || header.payloadBytes > MAX_REQUEST_PAYLOAD)
+        {
+            // Out of sync with the stream , nothing after this can be trusted
+            LOG_WARN("Bad request header , closing the connection");
+            response.status = STATUS_BAD_REQUEST;
+            Respond(*connection , response , std::vector<DETECT_RESULT>());
+            break;
+        }
+
+        SERVER_REQUEST request;
+        request.connection = connection;
+        request.requestId = header.requestId;
+        request.received = std::chrono::steady_clock::now();
+        bool rawFrame = header.kind == FRAME_RAW_BGR && header.width > 0 && header.height > 0 && \
+            (uint64_t)header.width * header.height * 3 == header.payloadBytes;
+        if (rawFrame)
+        {
+            // Straight into the image , no staging copy
+            request.image.create((int)header.height , (int)header.width , CV_8UC3);
+            if (!RecvAll(connection->socket , request.image.data , header.payloadBytes))
+            {
+                break;
+            }
+        } else
+        {
+            payload.resize(header.payloadBytes);
+            if (header.payloadBytes > 0 && !RecvAll(connection->socket , payload.data() , payload.size()))
+            {
+                break;
+            }
+            if (header.kind == FRAME_ENCODED && !payload.empty())
+            {
+                TRACE_SCOPE("decode");
+                request.image = cv::imdecode(payload , cv::IMREAD_COLOR);
+                response.status = request.image.empty() ? STATUS_DECODE_FAILED : STATUS_OK;
+            } else
+            {
+                response.status = STATUS_BAD_REQUEST;
+            }
+        }
+
+        bool queued = response.status == STATUS_OK && queue.TryPush(std::move(request));
+        if (!queued && response.status == STATUS_OK)
+        {
+            response.status = STATUS_OVERLOADED;
+        }
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            stats.requests++;
+            stats.rejected += response.status == STATUS_OVERLOADED ? 1 : 0;
+            stats.failed += response.status == STATUS_BAD_REQUEST || response.status == STATUS_DECODE_FAILED ? 1 : 0;
+        }
+        if (!queued)
+        {
+            Respond(*connection , response , std::vector<DETECT_RESULT>());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(connection->writeMutex);
+    connection->open = false;
+    CloseLocal(connection->socket);
+}
+
+void InferenceServer::ScheduleLoop(size_t worker)
+{
+    Tracer::SetThreadName("scheduler-" + std::to_string(worker));
+    // One per runner , the single request path keeps its IoBinding buffers bound
+    std::vector<std::unique_ptr<REQUEST_CONTEXT>> contexts(pool.Size());
+    std::vector<SERVER_REQUEST> batch;
+    std::vector<cv::Mat> images;
+    SERVER_REQUEST request;
+    while (queue.Pop(request))
+    {
+        batch.clear();
+        batch.emplace_back(std::move(request));
+        auto deadline = batch.front().received + std::chrono::duration_cast<std::chrono::steady_clock::duration>( \
+            std::chrono::duration<double , std::milli>(config.maxDelayMs));
+        while ((int)batch.size() < config.maxBatch && queue.PopUntil(request , deadline))
+        {
+            batch.emplace_back(std::move(request));
+        }
+
+        auto batch_start = std::chrono::steady_clock::now();
+        images.clear();
+        for (const auto& item : batch)
+        {
+            images.emplace_back(item.image);
+        }
+        std::vector<std::vector<DETECT_RESULT>> results;
+        int32_t status = STATUS_OK;
+        try
+        {
+            TRACE_SCOPE("batch");
+            RunnerPool::Lease lease = pool.Acquire();
+            if (batch.size() == 1)
+            {
+                if (!contexts[lease.Index()])
+                {
+                    contexts[lease.Index()].reset(new REQUEST_CONTEXT());
+                }
+                results.emplace_back(lease.Runner().InferenceSingleImage(images[0] , *contexts[lease.Index()]));
+            } else
+            {
+                results = lease.Runner().InferenceBatch(images);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR(e.what());
+            status = STATUS_FAILED;
+        }
+        double batchMs = std::chrono::duration<double , std::milli>(std::chrono::steady_clock::now() - batch_start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            stats.batches++;
+            stats.failed += status == STATUS_OK ? 0 : batch.size();
+            if (stats.batchSizes.size() <= batch.size())
+            {
+                stats.batchSizes.resize(batch.size() + 1 , 0);
+            }
+            stats.batchSizes[batch.size()]++;
+            stats.batchMs.Add(batchMs);
+            for (const auto& item : batch)
+            {
+                stats.queueMs.Add(std::chrono::duration<double , std::milli>(batch_start - item.received).count());
+            }
+        }
+
+        static const std::vector<DETECT_RESULT> empty;
+        for (size_t i = 0 ; i < batch.size() ; i++)
+        {
+            WIRE_RESPONSE response;
+            response.status = status;
+            response.requestId = batch[i].requestId;
+            response.batchSize = (uint32_t)batch.size();
+            response.queueMs = (float)std::chrono::duration<double , std::milli>(batch_start - batch[i].received).count();
+            response.inferenceMs = (float)batchMs;
+            Respond(*batch[i].connection , response , i < results.size() ? results[i] : empty);
+        }
+        batch.clear();
+    }
+}
+
+bool InferenceServer::Run()
+{
+    if (!SocketStartup())
+    {
+        LOG_ERROR("Socket startup failed");
+        return false;
+    }
+    LOCAL_SOCKET listener = ListenLocal(config.socketPath , 64);
+    if (listener == INVALID_LOCAL_SOCKET)
+    {
+        LOG_ERROR("Failed to listen on " << config.socketPath);
+        return false;
+    }
+    LOG_INFO("Listening on " << config.socketPath << " , sessions " << config.sessions << " , max batch " \
+        << config.maxBatch << " , max delay " << config.maxDelayMs << "ms , queue " << config.maxQueue);
+
+    std::vector<std::thread> schedulers;
+    for (int w = 0 ; w < config.sessions ; w++)
+    {
+        schedulers.emplace_back(&InferenceServer::ScheduleLoop , this , (size_t)w);
+    }
+
+    std::vector<std::pair<std::shared_ptr<SERVER_CONNECTION> , std::thread>> readers;
+    while (!stopping)
+    {
+        // Short timeout , Stop is noticed within it
+        LOCAL_SOCKET client = AcceptLocal(listener , 200);
+        if (client != INVALID_LOCAL_SOCKET)
+        {
+            auto connection = std::make_shared<SERVER_CONNECTION>();
+            connection->socket = client;
+            readers.emplace_back(connection , std::thread(&InferenceServer::ReadLoop , this , connection));
+            std::lock_guard<std::mutex> lock(statsMutex);
+            stats.connections++;
+        }
+        // Reap readers of closed connections
+        for (auto it = readers.begin() ; it != readers.end() ; )
+        {
+            if (!it->first->open)
+            {
+                it->second.join();
+                it = readers.erase(it);
+            } else
+            {
+                it++;
+            }
+        }
+    }
+
+    LOG_INFO("Stopping , answering the queued requests");
+    CloseLocal(listener);
+    queue.Close();
+    for (auto& scheduler : schedulers)
+    {
+        scheduler.join();
+    }
+    for (auto& reader : readers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(reader.first->writeMutex);
+            if (reader.first->open)
+            {
+                ShutdownLocal(reader.first->socket);
+            }
+        }
+        reader.second.join();
+    }
+    std::error_code error;
+    std::filesystem::remove(config.socketPath , error);
+    return true;
+}
+
+void InferenceServer::PrintReport()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    uint64_t batched = 0;
+    std::string sizes;
+    for (size_t n = 1 ; n < stats.batchSizes.size() ; n++)
+    {
+        batched += n * stats.batchSizes[n];
+        if (stats.batchSizes[n] > 0)
+        {
+            sizes += " " + std::to_string(n) + ":" + std::to_string(stats.batchSizes[n]);
+        }
+    }
+    fprintf(stdout, "[SERVER] connections : %llu , requests : %llu , rejected : %llu , failed : %llu\n",
+        (unsigned long long)stats.connections, (unsigned long long)stats.requests,
+        (unsigned long long)stats.rejected, (unsigned long long)stats.failed);
+    fprintf(stdout, "[SERVER] batches : %llu , mean batch %.2f , sizes%s\n",
+        (unsigned long long)stats.batches, stats.batches > 0 ? (double)batched / stats.batches : 0.0, sizes.c_str());
+    fprintf(stdout, "[SERVER] queue wait ms : p50 %.2f , p90 %.2f , p99 %.2f ; batch inference ms : p50 %.2f , p90 %.2f , p99 %.2f\n",
+        stats.queueMs.Percentile(50), stats.queueMs.Percentile(90), stats.queueMs.Percentile(99),
+        stats.batchMs.Percentile(50), stats.batchMs.Percentile(90), stats.batchMs.Percentile(99));
+}
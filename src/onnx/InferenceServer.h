@@ -0,0 +1,84 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "BoundedQueue.h"
+#include "LatencyRecorder.h"
+#include "RunnerPool.h"
+#include "ServerProtocol.h"
+
+typedef struct _SERVER_CONFIG
+{
+    std::string socketPath = DEFAULT_SOCKET_PATH;
+    int maxBatch = 8; // Requests per InferenceBatch call
+    double maxDelayMs = 2.0; // Longest the oldest request of a batch waits for it to fill , 0 runs whatever is queued
+    int maxQueue = 256; // Requests waiting beyond this are answered STATUS_OVERLOADED right away
+    int sessions = 1; // Batches in flight at once , one session and one scheduler thread each
+} SERVER_CONFIG;
+
+typedef struct _SERVER_STATS
+{
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t rejected = 0; // Queue full
+    uint64_t failed = 0; // Bad request , decode or inference error
+    uint64_t batches = 0;
+    std::vector<uint64_t> batchSizes; // batchSizes[n] : batches of n requests
+    LatencyRecorder queueMs; // Received -> batch start , per request
+    LatencyRecorder batchMs; // Inference of a whole batch
+} SERVER_STATS;
+
+typedef struct _SERVER_CONNECTION
+{
+    LOCAL_SOCKET socket = INVALID_LOCAL_SOCKET;
+    std::mutex writeMutex; // Responses of different batches may be written at the same time
+    std::atomic<bool> open{ true };
+} SERVER_CONNECTION;
+
+typedef struct _SERVER_REQUEST
+{
+    std::shared_ptr<SERVER_CONNECTION> connection;
+    uint64_t requestId = 0;
+    cv::Mat image;
+    std::chrono::steady_clock::time_point received;
+} SERVER_REQUEST;
+
+/*
+    Local inference server : one process owns the sessions and serves frames sent over a Unix
+    domain socket by any number of client processes. A reader thread per connection decodes
+    frames and queues them ; each scheduler thread takes the oldest request , then keeps taking
+    requests until it has maxBatch of them or the oldest one has waited maxDelayMs , and runs
+    them as one batch on its session. Responses go back on each request's own connection.
+
+    Batching pays off on dynamic-batch models , where a batch is one session->Run ; fixed-batch
+    models are fed in chunks of their batch size by InferenceBatch.
+*/
+class InferenceServer
+{
+private:
+    SERVER_CONFIG config;
+    RunnerPool pool;
+    BoundedQueue<SERVER_REQUEST> queue;
+    std::atomic<bool> stopping{ false };
+
+    std::mutex statsMutex;
+    SERVER_STATS stats;
+
+    void ReadLoop(std::shared_ptr<SERVER_CONNECTION> connection);
+    void ScheduleLoop(size_t worker);
+    void Respond(SERVER_CONNECTION& connection , WIRE_RESPONSE response , const std::vector<DETECT_RESULT>& result);
+
+public:
+    InferenceServer(const Configuration& cfg , const SERVER_CONFIG& config);
+
+    // Serve until Stop , false when the socket cannot be opened
+    bool Run();
+    // Safe to call from a signal handler
+    void Stop() { stopping = true; }
+
+    void PrintReport();
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+// Collects latency samples in milliseconds and reports nearest-rank percentiles
+class LatencyRecorder
+{
+private:
+    std::vector<double> samples;
+    mutable std::vector<double> sorted;
+    mutable bool dirty = false;
+
+    const std::vector<double>& Sorted() const
+    {
+        if (dirty)
+        {
+            sorted = samples;
+            std::sort(sorted.begin() , sorted.end());
+            dirty = false;
+        }
+        return sorted;
+    }
+
+public:
+    void Reserve(size_t n) { samples.reserve(n); }
+
+    void Add(double ms)
+    {
+        samples.push_back(ms);
+        dirty = true;
+    }
+
+    void Append(const LatencyRecorder& other)
+    {
+        samples.insert(samples.end() , other.samples.begin() , other.samples.end());
+        dirty = true;
+    }
+
+    void Clear()
+    {
+        samples.clear();
+        sorted.clear();
+        dirty = false;
+    }
+
+    size_t Count() const { return samples.size(); }
+
+    // p in [0 , 100]
+    double Percentile(double p) const
+    {
+        const std::vector<double>& values = Sorted();
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        size_t rank = (size_t)std::max(0.0 , p / 100.0 * values.size() - 1e-9);
+        return values[std::min(rank , values.size() - 1)];
+    }
+
+    double Max() const
+    {
+        const std::vector<double>& values = Sorted();
+        return values.empty() ? 0.0 : values.back();
+    }
+
+    double Mean() const
+    {
+        if (samples.empty())
+        {
+            return 0.0;
+        }
+        double sum = 0.0;
+        for (double v : samples)
+        {
+            sum += v;
+        }
+        return sum / samples.size();
+    }
+};
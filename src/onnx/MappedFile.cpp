@@ -0,0 +1,81 @@
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+    std::wstring widePath = std::wstring(path.begin() , path.end());
+    HANDLE fileHandle = CreateFileW(widePath.c_str() , GENERIC_READ , FILE_SHARE_READ , nullptr , OPEN_EXISTING , \
+        FILE_ATTRIBUTE_NORMAL , nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    this->file = fileHandle;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle , &fileSize) || fileSize.QuadPart <= 0)
+    {
+        return;
+    }
+    HANDLE mappingHandle = CreateFileMappingW(fileHandle , nullptr , PAGE_READONLY , 0 , 0 , nullptr);
+    if (mappingHandle == nullptr)
+    {
+        return;
+    }
+    this->mapping = mappingHandle;
+    this->data = (const char*)MapViewOfFile(mappingHandle , FILE_MAP_READ , 0 , 0 , 0);
+    this->size = this->data != nullptr ? (size_t)fileSize.QuadPart : 0;
+#else
+    int fd = open(path.c_str() , O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat info;
+    if (fstat(fd , &info) == 0 && info.st_size > 0)
+    {
+        void* view = mmap(nullptr , (size_t)info.st_size , PROT_READ , MAP_SHARED , fd , 0);
+        if (view != MAP_FAILED)
+        {
+            this->data = (const char*)view;
+            this->size = (size_t)info.st_size;
+        }
+    }
+    // The mapping keeps its own reference to the file
+    close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (this->data != nullptr)
+    {
+        UnmapViewOfFile(this->data);
+    }
+    if (this->mapping != nullptr)
+    {
+        CloseHandle(this->mapping);
+    }
+    if (this->file != nullptr)
+    {
+        CloseHandle(this->file);
+    }
+#else
+    if (this->data != nullptr)
+    {
+        munmap((void*)this->data , this->size);
+    }
+#endif
+}
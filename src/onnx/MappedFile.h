@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory map of a whole file , unmapped on destruction
+class MappedFile
+{
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr; // HANDLE
+    void* mapping = nullptr; // HANDLE
+#endif
+
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsOpen() const { return data != nullptr; }
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+};
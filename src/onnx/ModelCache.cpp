@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <onnxruntime_cxx_api.h>
+
+#include "ModelCache.h"
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t HashBytes(uint64_t hash , const void* data , size_t size)
+{
+    // Eight bytes per multiply : a model is hashed on every start , byte-wise FNV is too slow for it
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t i = 0;
+    for ( ; i + 8 <= size ; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word , bytes + i , 8);
+        hash = (hash ^ word) * FNV_PRIME;
+        hash ^= hash >> 29;
+    }
+    for ( ; i < size ; i++)
+    {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t HashModelFile(const std::string& path)
+{
+    FILE* file = fopen(path.c_str() , "rb");
+    if (file == nullptr)
+    {
+        return 0;
+    }
+    std::vector<unsigned char> buffer(1 << 20);
+    uint64_t hash = FNV_OFFSET;
+    size_t read = 0;
+    while ((read = fread(buffer.data() , 1 , buffer.size() , file)) > 0)
+    {
+        hash = HashBytes(hash , buffer.data() , read);
+    }
+    fclose(file);
+    return hash;
+}
+
+std::string GraphOptionsKey(const Configuration& cfg)
+{
+    std::string key = "ort=";
+    key += OrtGetApiBase()->GetVersionString();
+    key += ";opt=extended";
+    key += cfg.cudaEnable ? ";ep=cuda" : ";ep=cpu";
+    key += cfg.rawInput ? ";input=nhwc_u8" : "";
+    return key;
+}
+
+std::filesystem::path OptimizedModelCachePath(const Configuration& cfg)
+{
+    uint64_t hash = HashModelFile(cfg.ModelPath);
+    if (hash == 0)
+    {
+        return std::filesystem::path();
+    }
+    std::string options = GraphOptionsKey(cfg);
+    hash = HashBytes(hash , options.data() , options.size());
+
+    char digits[17];
+    snprintf(digits , sizeof(digits) , "%016llx" , (unsigned long long)hash);
+
+    std::filesystem::path modelPath(cfg.ModelPath);
+    std::filesystem::path directory = cfg.CacheDir.empty() ? modelPath.parent_path() : std::filesystem::path(cfg.CacheDir);
+    return directory / (modelPath.stem().string() + "." + digits + ".opt.onnx");
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <filesystem>
+
+#include "Configuration.h"
+
+/*
+    Optimized model cache. The graph ORT_ENABLE_EXTENDED produces is serialized once and loaded on
+    later starts instead of optimizing the original model again. The CPU specific layout transforms
+    of ORT_ENABLE_ALL are left out of the file and redone by every host on load , so hosts with
+    different instruction sets can share one cache next to the model. The file name carries a key
+    over the model bytes , the ORT version and every option that changes the optimized graph ,
+    so a new model , runtime or option set never picks up a stale graph. The loaded cache file takes
+    the place of the model : --mmap-model / --share-weights map and share it like the original.
+*/
+
+// 64-bit FNV-1a style hash of the file content , 0 when it cannot be read
+uint64_t HashModelFile(const std::string& path);
+
+// Options that shape the optimized graph (not thread counts) , part of the cache key
+std::string GraphOptionsKey(const Configuration& cfg);
+
+// <cacheDir or model dir>/<model stem>.<16 hex digits>.opt.onnx , empty when the model cannot be read
+std::filesystem::path OptimizedModelCachePath(const Configuration& cfg);
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "NMSEngine.h"
+
+void NMSEngine::SortCandidates(const NMS_BOXES& boxes , const NMS_CONFIG& config)
+{
+    int n = (int)boxes.size();
+    order.resize(n);
+    std::iota(order.begin() , order.end() , 0);
+
+    auto byScore = [&boxes](int a , int b)
+    {
+        return boxes.scores[a] > boxes.scores[b] || (boxes.scores[a] == boxes.scores[b] && a < b);
+    };
+    if (config.topK > 0 && n > config.topK)
+    {
+        std::partial_sort(order.begin() , order.begin() + config.topK , order.end() , byScore);
+        order.resize(config.topK);
+    } else
+    {
+        std::sort(order.begin() , order.end() , byScore);
+    }
+
+    /* Per-class offset : shifting every class into its own disjoint coordinate range. Boxes are not
+       clamped to the image , corners can be negative , so the range starts at the smallest corner. */
+    float minCoord = 0.0f , offsetStep = 0.0f;
+    if (!config.classAgnostic && !order.empty())
+    {
+        float maxCoord = boxes.x1[order[0]];
+        minCoord = maxCoord;
+        for (int idx : order)
+        {
+            minCoord = std::min(minCoord , std::min(std::min(boxes.x1[idx] , boxes.y1[idx]) , std::min(boxes.x2[idx] , boxes.y2[idx])));
+            maxCoord = std::max(maxCoord , std::max(std::max(boxes.x1[idx] , boxes.y1[idx]) , std::max(boxes.x2[idx] , boxes.y2[idx])));
+        }
+        offsetStep = maxCoord - minCoord + 1.0f;
+    }
+
+    size_t m = order.size();
+    sx1.resize(m); sy1.resize(m); sx2.resize(m); sy2.resize(m);
+    sarea.resize(m); sscores.resize(m);
+    suppressed.assign(m , 0);
+    for (size_t i = 0 ; i < m ; i++)
+    {
+        int idx = order[i];
+        float offset = offsetStep * boxes.classIds[idx] - minCoord;
+        sx1[i] = boxes.x1[idx] + offset;
+        sy1[i] = boxes.y1[idx] + offset;
+        sx2[i] = boxes.x2[idx] + offset;
+        sy2[i] = boxes.y2[idx] + offset;
+        sarea[i] = std::max(0.0f , boxes.x2[idx] - boxes.x1[idx]) * std::max(0.0f , boxes.y2[idx] - boxes.y1[idx]);
+        sscores[i] = boxes.scores[idx];
+    }
+}
+
+void NMSEngine::HardSuppress(const NMS_CONFIG& config , std::vector<int>& keep)
+{
+    const int m = (int)order.size();
+    const float threshold = config.iouThreshold;
+    const float* x1 = sx1.data();
+    const float* y1 = sy1.data();
+    const float* x2 = sx2.data();
+    const float* y2 = sy2.data();
+    const float* area = sarea.data();
+    int32_t* removed = suppressed.data();
+
+    for (int i = 0 ; i < m ; i++)
+    {
+        if (removed[i])
+        {
+            continue;
+        }
+        keep.push_back(order[i]);
+        if (config.maxDet > 0 && (int)keep.size() >= config.maxDet)
+        {
+            break;
+        }
+
+        const float bx1 = x1[i] , by1 = y1[i] , bx2 = x2[i] , by2 = y2[i] , barea = area[i];
+        // Branch-free and division-free : iou > t  <=>  inter > t * union
+        for (int j = i + 1 ; j < m ; j++)
+        {
+            float w = std::max(0.0f , std::min(bx2 , x2[j]) - std::max(bx1 , x1[j]));
+            float h = std::max(0.0f , std::min(by2 , y2[j]) - std::max(by1 , y1[j]));
+            float inter = w * h;
+            removed[j] |= (int32_t)(inter > threshold * (barea + area[j] - inter));
+        }
+    }
+}
+
+void NMSEngine::SoftSuppress(const NMS_CONFIG& config , std::vector<int>& keep , std::vector<float>* keepScores)
+{
+    const int m = (int)order.size();
+    const float invSigma = 1.0f / std::max(config.softSigma , 1e-6f);
+    int remaining = m;
+
+    while (remaining > 0)
+    {
+        // Scores decay , so the next box is the best one still alive rather than the next in order
+        int best = -1;
+        for (int j = 0 ; j < m ; j++)
+        {
+            if (!suppressed[j] && (best < 0 || sscores[j] > sscores[best]))
+            {
+                best = j;
+            }
+        }
+        suppressed[best] = 1;
+        remaining--;
+        keep.push_back(order[best]);
+        if (keepScores != nullptr)
+        {
+            keepScores->push_back(sscores[best]);
+        }
+        if (config.maxDet > 0 && (int)keep.size() >= config.maxDet)
+        {
+            break;
+        }
+
+        const float bx1 = sx1[best] , by1 = sy1[best] , bx2 = sx2[best] , by2 = sy2[best] , barea = sarea[best];
+        for (int j = 0 ; j < m ; j++)
+        {
+            if (suppressed[j])
+            {
+                continue;
+            }
+            float w = std::max(0.0f , std::min(bx2 , sx2[j]) - std::max(bx1 , sx1[j]));
+            float h = std::max(0.0f , std::min(by2 , sy2[j]) - std::max(by1 , sy1[j]));
+            float inter = w * h;
+            float iou = inter / std::max(barea + sarea[j] - inter , 1e-9f);
+            sscores[j] *= std::exp(-iou * iou * invSigma);
+            if (sscores[j] < config.softScoreThreshold)
+            {
+                suppressed[j] = 1;
+                remaining--;
+            }
+        }
+    }
+}
+
+void NMSEngine::Run(const NMS_BOXES& boxes , const NMS_CONFIG& config , std::vector<int>& keep , \
+    std::vector<float>* keepScores)
+{
+    keep.clear();
+    if (keepScores != nullptr)
+    {
+        keepScores->clear();
+    }
+    if (boxes.size() == 0)
+    {
+        return;
+    }
+
+    SortCandidates(boxes , config);
+    if (config.softNMS)
+    {
+        SoftSuppress(config , keep , keepScores);
+        return;
+    }
+
+    HardSuppress(config , keep);
+    if (keepScores != nullptr)
+    {
+        for (int idx : keep)
+        {
+            keepScores->push_back(boxes.scores[idx]);
+        }
+    }
+}
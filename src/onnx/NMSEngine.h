@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+typedef struct _NMS_CONFIG
+{
+    float iouThreshold = 0.45f;
+    int topK = 30000; // Candidates kept by score before suppression , <= 0 keeps all
+    int maxDet = 300; // Detections returned per image , <= 0 for no cap
+    bool classAgnostic = false; // true : boxes of different classes suppress each other
+    bool softNMS = false; // Gaussian soft-NMS instead of hard suppression
+    float softSigma = 0.5f;
+    float softScoreThreshold = 0.001f; // Soft-NMS drops boxes whose decayed score falls below this
+} NMS_CONFIG;
+
+/*
+    Candidate boxes in structure-of-arrays layout , corners in float pixels.
+    The IoU sweep walks these arrays contiguously so the compiler can vectorize it.
+*/
+typedef struct _NMS_BOXES
+{
+    std::vector<float> x1 , y1 , x2 , y2;
+    std::vector<float> scores;
+    std::vector<int> classIds;
+
+    void clear()
+    {
+        x1.clear(); y1.clear(); x2.clear(); y2.clear();
+        scores.clear();
+        classIds.clear();
+    }
+
+    void reserve(size_t n)
+    {
+        x1.reserve(n); y1.reserve(n); x2.reserve(n); y2.reserve(n);
+        scores.reserve(n);
+        classIds.reserve(n);
+    }
+
+    void push_back(float left , float top , float right , float bottom , float score , int classId)
+    {
+        x1.push_back(left); y1.push_back(top); x2.push_back(right); y2.push_back(bottom);
+        scores.push_back(score);
+        classIds.push_back(classId);
+    }
+
+    size_t size() const { return scores.size(); }
+} NMS_BOXES;
+
+/*
+    Batched class-aware NMS.
+    1. Partial sort keeps the topK highest scores (ties broken by index , so the result is deterministic).
+    2. Each class is shifted by classId * (maxCoord - minCoord + 1) - minCoord so boxes of different
+       classes can never overlap , which lets every class be suppressed in one greedy pass.
+    3. Greedy hard NMS (or Gaussian soft-NMS) stops as soon as maxDet boxes are kept.
+    keep receives indices into boxes , highest score first.
+*/
+class NMSEngine
+{
+private:
+    // Scratch reused between calls , sorted and offset copies of the candidates
+    std::vector<int> order;
+    std::vector<float> sx1 , sy1 , sx2 , sy2 , sarea , sscores;
+    std::vector<int32_t> suppressed;
+
+    void SortCandidates(const NMS_BOXES& boxes , const NMS_CONFIG& config);
+    void HardSuppress(const NMS_CONFIG& config , std::vector<int>& keep);
+    void SoftSuppress(const NMS_CONFIG& config , std::vector<int>& keep , std::vector<float>* keepScores);
+
+public:
+    void Run(const NMS_BOXES& boxes , const NMS_CONFIG& config , std::vector<int>& keep , \
+        std::vector<float>* keepScores = nullptr);
+};
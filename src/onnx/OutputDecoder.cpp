@@ -0,0 +1,154 @@
+#include <cmath>
+
+#include "OutputDecoder.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DECODER_KERNEL_AVX2
+#elif defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define DECODER_KERNEL_SSE41
+#endif
+
+// Anchors per tile : 64 floats = 4 cache lines per class row , running max/argmax stay in L1
+static const int DECODE_TILE = 64;
+
+// Running max/argmax over the class rows for `count` consecutive anchors , first maximum wins like cv::minMaxLoc
+static void ArgmaxTile(const float* scores , int rowStride , int numClasses , int count , float* maxScore , int* maxClass)
+{
+    std::copy(scores , scores + count , maxScore);
+    std::fill(maxClass , maxClass + count , 0);
+
+    for (int c = 1 ; c < numClasses ; c++)
+    {
+        const float* row = scores + (size_t)c * rowStride;
+        int x = 0;
+#if defined(DECODER_KERNEL_AVX2)
+        const __m256 classId = _mm256_castsi256_ps(_mm256_set1_epi32(c));
+        for ( ; x + 8 <= count ; x += 8)
+        {
+            __m256 best = _mm256_loadu_ps(maxScore + x);
+            __m256 value = _mm256_loadu_ps(row + x);
+            __m256 greater = _mm256_cmp_ps(value , best , _CMP_GT_OQ);
+            __m256 index = _mm256_loadu_ps((const float*)(maxClass + x));
+            _mm256_storeu_ps(maxScore + x , _mm256_blendv_ps(best , value , greater));
+            _mm256_storeu_ps((float*)(maxClass + x) , _mm256_blendv_ps(index , classId , greater));
+        }
+#elif defined(DECODER_KERNEL_SSE41)
+        const __m128 classId = _mm_castsi128_ps(_mm_set1_epi32(c));
+        for ( ; x + 4 <= count ; x += 4)
+        {
+            __m128 best = _mm_loadu_ps(maxScore + x);
+            __m128 value = _mm_loadu_ps(row + x);
+            __m128 greater = _mm_cmpgt_ps(value , best);
+            __m128 index = _mm_loadu_ps((const float*)(maxClass + x));
+            _mm_storeu_ps(maxScore + x , _mm_blendv_ps(best , value , greater));
+            _mm_storeu_ps((float*)(maxClass + x) , _mm_blendv_ps(index , classId , greater));
+        }
+#endif
+        for ( ; x < count ; x++)
+        {
+            if (row[x] > maxScore[x])
+            {
+                maxScore[x] = row[x];
+                maxClass[x] = c;
+            }
+        }
+    }
+}
+
+void DecodeCandidates(const float* output , int numChannels , int numAnchors , int numClasses , \
+    float confThreshold , DECODE_CANDIDATES& candidates)
+{
+    CV_Assert(numClasses > 0 && 4 + numClasses <= numChannels);
+
+    const float* scores = output + (size_t)4 * numAnchors;
+    float maxScore[DECODE_TILE];
+    int maxClass[DECODE_TILE];
+
+    for (int begin = 0 ; begin < numAnchors ; begin += DECODE_TILE)
+    {
+        int count = std::min(DECODE_TILE , numAnchors - begin);
+        ArgmaxTile(scores + begin , numAnchors , numClasses , count , maxScore , maxClass);
+
+        for (int i = 0 ; i < count ; i++)
+        {
+            if (maxScore[i] < confThreshold)
+            {
+                continue;
+            }
+            // Box rows are strided by numAnchors , only touched for survivors
+            int anchor = begin + i;
+            candidates.anchors.emplace_back(anchor);
+            candidates.classIds.emplace_back(maxClass[i]);
+            candidates.scores.emplace_back(maxScore[i]);
+            candidates.boxes.emplace_back(output[anchor] , output[numAnchors + anchor] , \
+                output[2 * (size_t)numAnchors + anchor] , output[3 * (size_t)numAnchors + anchor]);
+        }
+    }
+}
+
+void DecodeCandidatesReference(const float* output , int numChannels , int numAnchors , int numClasses , \
+    float confThreshold , DECODE_CANDIDATES& candidates)
+{
+    cv::Mat rawData = cv::Mat(cv::Size(numAnchors , numChannels) , CV_32F , (void*)output).t();
+    float* data = (float*)rawData.data;
+
+    for (int i = 0 ; i < numAnchors ; ++i)
+    {
+        cv::Mat scores(1 , numClasses , CV_32F , data + 4);
+        cv::Point class_id;
+        double maxClassScore;
+        cv::minMaxLoc(scores , 0 , &maxClassScore , 0 , &class_id);
+        if ((float)maxClassScore >= confThreshold)
+        {
+            candidates.anchors.emplace_back(i);
+            candidates.classIds.emplace_back(class_id.x);
+            candidates.scores.emplace_back((float)maxClassScore);
+            candidates.boxes.emplace_back(data[0] , data[1] , data[2] , data[3]);
+        }
+        data += numChannels;
+    }
+}
+
+void DecodeMask(const float* protos , int maskChannels , int protoHeight , int protoWidth , \
+    const float* coefficients , size_t coefficientStride , const cv::Rect& region , cv::Mat& mask)
+{
+    mask.create(region.height , region.width , CV_32F);
+    mask.setTo(cv::Scalar(0));
+    size_t planeSize = (size_t)protoHeight * protoWidth;
+    // One prototype plane at a time : contiguous rows of the crop , the inner loop vectorizes
+    for (int k = 0 ; k < maskChannels ; k++)
+    {
+        float coefficient = coefficients[k * coefficientStride];
+        const float* plane = protos + k * planeSize + (size_t)region.y * protoWidth + region.x;
+        for (int y = 0 ; y < region.height ; y++)
+        {
+            const float* src = plane + (size_t)y * protoWidth;
+            float* dst = mask.ptr<float>(y);
+            for (int x = 0 ; x < region.width ; x++)
+            {
+                dst[x] += coefficient * src[x];
+            }
+        }
+    }
+    for (int y = 0 ; y < region.height ; y++)
+    {
+        float* dst = mask.ptr<float>(y);
+        for (int x = 0 ; x < region.width ; x++)
+        {
+            dst[x] = 1.0f / (1.0f + std::exp(-dst[x]));
+        }
+    }
+}
+
+const char* DecoderKernelName()
+{
+#if defined(DECODER_KERNEL_AVX2)
+    return "avx2";
+#elif defined(DECODER_KERNEL_SSE41)
+    return "sse4.1";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+/*
+    Candidates decoded from the YOLOv8 detection head before NMS.
+    Boxes stay in model input pixels as [cx , cy , w , h] , letterbox undo is left to the caller.
+*/
+typedef struct _DECODE_CANDIDATES
+{
+    std::vector<int> anchors;
+    std::vector<int> classIds;
+    std::vector<float> scores;
+    std::vector<cv::Vec4f> boxes;
+
+    void clear()
+    {
+        anchors.clear();
+        classIds.clear();
+        scores.clear();
+        boxes.clear();
+    }
+
+    size_t size() const { return scores.size(); }
+} DECODE_CANDIDATES;
+
+/*
+    Decode one image of the channel-major head output [numChannels , numAnchors] in place.
+    Rows 0..3 hold the box , rows 4..4+numClasses the class scores ; any rows after that
+    (mask coefficients , keypoints) are ignored here. The class max/argmax runs vectorized
+    over tiles of anchors , box rows are only read for anchors whose best score passes
+    confThreshold. Candidates are appended in anchor order.
+*/
+void DecodeCandidates(const float* output , int numChannels , int numAnchors , int numClasses , \
+    float confThreshold , DECODE_CANDIDATES& candidates);
+
+// Previous decoder : transpose the whole output and cv::minMaxLoc every anchor. Kept as reference.
+void DecodeCandidatesReference(const float* output , int numChannels , int numAnchors , int numClasses , \
+    float confThreshold , DECODE_CANDIDATES& candidates);
+
+/*
+    Segment head : the mask of one detection , sigmoid(coefficients . prototypes) over region of the
+    [maskChannels , protoHeight , protoWidth] prototype grid only. coefficients[k * coefficientStride]
+    is the k-th coefficient , so the channel-major head output can be read in place. mask receives
+    region.height x region.width CV_32F probabilities through cv::Mat::create : its buffer is reused
+    only for a region of exactly the same size , any other size allocates. Each detection keeps its
+    own mask , so this is one allocation per detection with a mask.
+*/
+void DecodeMask(const float* protos , int maskChannels , int protoHeight , int protoWidth , \
+    const float* coefficients , size_t coefficientStride , const cv::Rect& region , cv::Mat& mask);
+
+// Name of the argmax kernel compiled into this binary : "avx2" , "sse4.1" or "scalar"
+const char* DecoderKernelName();
@@ -0,0 +1,199 @@
+#include <map>
+#include <thread>
+#include <chrono>
+
+#include "PipelineRunner.h"
+#include "Trace.h"
+
+static const char* PIPELINE_STAGE_NAMES[4] = { "decode" , "preprocess" , "inference" , "postprocess" };
+
+PipelineRunner::PipelineRunner(YOLOv8OnnxRunner& detector , const PIPELINE_CONFIG& config)
+    : detector(detector) , config(config)
+{
+    this->config.decodeWorkers = std::max(1 , config.decodeWorkers);
+    this->config.preprocessWorkers = std::max(1 , config.preprocessWorkers);
+    this->config.inferenceWorkers = std::max(1 , config.inferenceWorkers);
+    this->config.postprocessWorkers = std::max(1 , config.postprocessWorkers);
+    this->config.queueCapacity = std::max(1 , config.queueCapacity);
+}
+
+void PipelineRunner::Run(const std::vector<std::filesystem::path>& imagePaths , const ResultCallback& onResult)
+{
+    size_t capacity = (size_t)config.queueCapacity;
+    BoundedQueue<ItemPtr> decodeQueue(capacity) , preprocessQueue(capacity) , \
+        inferenceQueue(capacity) , postprocessQueue(capacity);
+
+    // Enough items to fill every queue and keep every worker busy , never more
+    size_t poolSize = 4 * capacity + config.decodeWorkers + config.preprocessWorkers + \
+        config.inferenceWorkers + config.postprocessWorkers + 1;
+    BoundedQueue<ItemPtr> freeItems(poolSize);
+    for (size_t i = 0 ; i < poolSize ; i++)
+    {
+        freeItems.Push(ItemPtr(new PIPELINE_ITEM()));
+    }
+
+    std::atomic<size_t> nextIndex(0);
+    std::atomic<int64_t> busyNs[4] = { {0} , {0} , {0} , {0} };
+    std::vector<std::thread> workers;
+
+    // Start `count` workers applying `work` from `in` to `out` ; the last one to finish closes `out`
+    auto launchStage = [&workers](int count , int stage , BoundedQueue<ItemPtr>* in , BoundedQueue<ItemPtr>& out , \
+        std::atomic<int64_t>* busy , std::function<bool(ItemPtr&)> work)
+    {
+        auto alive = std::make_shared<std::atomic<int>>(count);
+        for (int w = 0 ; w < count ; w++)
+        {
+            workers.emplace_back([=, &out]()
+            {
+                Tracer::SetThreadName(std::string(PIPELINE_STAGE_NAMES[stage]) + "-" + std::to_string(w));
+                ItemPtr item;
+                while (in == nullptr || in->Pop(item))
+                {
+                    auto time_start = std::chrono::steady_clock::now();
+                    bool produced = false;
+                    try
+                    {
+                        produced = work(item);
+                    }
+                    catch(const std::exception& e)
+                    {
+                        LOG_ERROR("pipeline stage " << PIPELINE_STAGE_NAMES[stage] << " : " << e.what());
+                        produced = item != nullptr;
+                    }
+                    busy[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>( \
+                        std::chrono::steady_clock::now() - time_start).count();
+                    if (!produced)
+                    {
+                        break;
+                    }
+                    out.Push(std::move(item));
+                }
+                if (--(*alive) == 0)
+                {
+                    out.Close();
+                }
+            });
+        }
+    };
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+
+    // Decode : pulls a free item first , so a full pipeline blocks JPEG decode too
+    launchStage(config.decodeWorkers , 0 , nullptr , decodeQueue , busyNs , [&](ItemPtr& item)
+    {
+        if (!freeItems.Pop(item))
+        {
+            return false;
+        }
+        size_t index = nextIndex++;
+        if (index >= imagePaths.size())
+        {
+            freeItems.Push(std::move(item));
+            return false;
+        }
+        item->index = index;
+        item->path = imagePaths[index];
+        item->result.clear();
+        TRACE_SCOPE("imread");
+        item->image = cv::imread(item->path.string());
+        return true;
+    });
+
+    launchStage(config.preprocessWorkers , 1 , &decodeQueue , preprocessQueue , busyNs , [&](ItemPtr& item)
+    {
+        if (!item->image.empty())
+        {
+            detector.PreprocessStage(item->image , item->ctx);
+        }
+        return true;
+    });
+
+    launchStage(config.inferenceWorkers , 2 , &preprocessQueue , inferenceQueue , busyNs , [&](ItemPtr& item)
+    {
+        item->ctx.output_tensors.clear();
+        if (!item->image.empty())
+        {
+            detector.InferenceStage(item->ctx);
+        }
+        return true;
+    });
+
+    launchStage(config.postprocessWorkers , 3 , &inferenceQueue , postprocessQueue , busyNs , [&](ItemPtr& item)
+    {
+        if (!item->image.empty())
+        {
+            detector.PostprocessStage(item->ctx , item->result);
+        }
+        // Release the output tensors before the item waits in the output queue
+        item->ctx.output_tensors.clear();
+        return true;
+    });
+
+    // Output stage on the calling thread , optionally reordering by input index
+    Tracer::SetThreadName("output");
+    std::map<size_t , ItemPtr> pending;
+    size_t nextOutput = 0;
+    processed = 0;
+    ItemPtr item;
+    while (postprocessQueue.Pop(item))
+    {
+        if (!config.ordered)
+        {
+            onResult(*item);
+            processed++;
+            freeItems.Push(std::move(item));
+            continue;
+        }
+        pending[item->index] = std::move(item);
+        while (!pending.empty() && pending.begin()->first == nextOutput)
+        {
+            ItemPtr ready = std::move(pending.begin()->second);
+            pending.erase(pending.begin());
+            onResult(*ready);
+            processed++;
+            nextOutput++;
+            freeItems.Push(std::move(ready));
+        }
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    auto time_end = std::chrono::high_resolution_clock::now();
+    elapsedSeconds = std::chrono::duration<double>(time_end - time_start).count();
+
+    queueStats = {
+        { "decode->preprocess" , decodeQueue.Stats() } ,
+        { "preprocess->inference" , preprocessQueue.Stats() } ,
+        { "inference->postprocess" , inferenceQueue.Stats() } ,
+        { "postprocess->output" , postprocessQueue.Stats() }
+    };
+    stageBusyMs = {
+        { PIPELINE_STAGE_NAMES[0] , busyNs[0] / 1e6 } ,
+        { PIPELINE_STAGE_NAMES[1] , busyNs[1] / 1e6 } ,
+        { PIPELINE_STAGE_NAMES[2] , busyNs[2] / 1e6 } ,
+        { PIPELINE_STAGE_NAMES[3] , busyNs[3] / 1e6 }
+    };
+}
+
+void PipelineRunner::PrintReport() const
+{
+    const int stageWorkers[4] = { config.decodeWorkers , config.preprocessWorkers , \
+        config.inferenceWorkers , config.postprocessWorkers };
+
+    fprintf(stdout, "[PIPELINE] images : %zu , elapsed : %.3fs , throughput : %.2f images/s\n",
+        processed, elapsedSeconds, elapsedSeconds > 0 ? processed / elapsedSeconds : 0.0);
+    for (size_t i = 0 ; i < stageBusyMs.size() ; i++)
+    {
+        double utilization = elapsedSeconds > 0 ? stageBusyMs[i].second / (elapsedSeconds * 1000.0 * stageWorkers[i]) : 0.0;
+        fprintf(stdout, "[PIPELINE] stage %-12s workers %d , busy %.1fms , utilization %.0f%%\n",
+            stageBusyMs[i].first.c_str(), stageWorkers[i], stageBusyMs[i].second, 100.0 * utilization);
+    }
+    for (auto& queue : queueStats)
+    {
+        fprintf(stdout, "[PIPELINE] queue %-24s capacity %zu , mean occupancy %.2f , max %zu , producer blocked %.1fms , consumer starved %.1fms\n",
+            queue.first.c_str(), queue.second.capacity, queue.second.meanOccupancy, queue.second.maxOccupancy,
+            queue.second.pushWaitMs, queue.second.popWaitMs);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <filesystem>
+
+#include "BoundedQueue.h"
+#include "YOLOv8OnnxRunner.h"
+
+typedef struct _PIPELINE_CONFIG
+{
+    int decodeWorkers = 2;
+    int preprocessWorkers = 1;
+    int inferenceWorkers = 1;
+    int postprocessWorkers = 1;
+    int queueCapacity = 8; // Per inter-stage queue
+    bool ordered = true; // Hand results to the output stage in input order
+} PIPELINE_CONFIG;
+
+typedef struct _PIPELINE_ITEM
+{
+    size_t index = 0;
+    std::filesystem::path path;
+    cv::Mat image;
+    REQUEST_CONTEXT ctx;
+    std::vector<DETECT_RESULT> result;
+} PIPELINE_ITEM;
+
+/*
+    decode -> preprocess -> inference -> postprocess -> output , each stage on its own worker
+    threads , joined by bounded queues. Items (and their tensor buffers) come from a fixed pool
+    and go back to it after the output stage , so the number of frames in flight is bounded and
+    a slow stage stalls the ones upstream of it instead of growing a backlog.
+*/
+class PipelineRunner
+{
+public:
+    using ResultCallback = std::function<void(PIPELINE_ITEM& item)>;
+
+private:
+    using ItemPtr = std::unique_ptr<PIPELINE_ITEM>;
+
+    YOLOv8OnnxRunner& detector;
+    PIPELINE_CONFIG config;
+
+    // Report of the last Run
+    size_t processed = 0;
+    double elapsedSeconds = 0.0;
+    std::vector<std::pair<std::string , QUEUE_STATS>> queueStats;
+    std::vector<std::pair<std::string , double>> stageBusyMs;
+
+public:
+    PipelineRunner(YOLOv8OnnxRunner& detector , const PIPELINE_CONFIG& config);
+
+    // Process every path , onResult runs on the calling thread (the output stage)
+    void Run(const std::vector<std::filesystem::path>& imagePaths , const ResultCallback& onResult);
+
+    void PrintReport() const;
+};
@@ -0,0 +1,136 @@
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "PreprocessKernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PREPROCESS_KERNEL_AVX2
+#elif defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define PREPROCESS_KERNEL_SSE41
+#endif
+
+#if defined(PREPROCESS_KERNEL_AVX2) || defined(PREPROCESS_KERNEL_SSE41)
+// pshufb masks splitting 16 interleaved BGR pixels (48 bytes in v0 , v1 , v2) into one channel each
+static inline __m128i DeinterleaveChannel(__m128i v0 , __m128i v1 , __m128i v2 , int channel)
+{
+    static const signed char masks[3][3][16] = {
+        { // B : bytes 0,3,..,45
+            { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+            { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+            { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 } },
+        { // G : bytes 1,4,..,46
+            { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+            { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+            { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 } },
+        { // R : bytes 2,5,..,47
+            { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+            { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+            { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 } }
+    };
+    __m128i m0 = _mm_loadu_si128((const __m128i*)masks[channel][0]);
+    __m128i m1 = _mm_loadu_si128((const __m128i*)masks[channel][1]);
+    __m128i m2 = _mm_loadu_si128((const __m128i*)masks[channel][2]);
+    return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0 , m0) , _mm_shuffle_epi8(v1 , m1)) , \
+        _mm_shuffle_epi8(v2 , m2));
+}
+
+// Convert 16 bytes to 16 floats divided by 255 (division keeps parity with the scalar path)
+static inline void StoreNormalized16(__m128i bytes , float* dst)
+{
+#if defined(PREPROCESS_KERNEL_AVX2)
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+    __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes , 8)));
+    _mm256_storeu_ps(dst , _mm256_div_ps(lo , scale));
+    _mm256_storeu_ps(dst + 8 , _mm256_div_ps(hi , scale));
+#else
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (int k = 0 ; k < 4 ; k++)
+    {
+        __m128 v = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes));
+        _mm_storeu_ps(dst + 4 * k , _mm_div_ps(v , scale));
+        bytes = _mm_srli_si128(bytes , 4);
+    }
+#endif
+}
+#endif
+
+static void ConvertRowBGR(const uchar* src , float* dstB , float* dstG , float* dstR , int width)
+{
+    int x = 0;
+#if defined(PREPROCESS_KERNEL_AVX2) || defined(PREPROCESS_KERNEL_SSE41)
+    for ( ; x + 16 <= width ; x += 16)
+    {
+        const uchar* p = src + 3 * x;
+        __m128i v0 = _mm_loadu_si128((const __m128i*)p);
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(p + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(p + 32));
+        StoreNormalized16(DeinterleaveChannel(v0 , v1 , v2 , 0) , dstB + x);
+        StoreNormalized16(DeinterleaveChannel(v0 , v1 , v2 , 1) , dstG + x);
+        StoreNormalized16(DeinterleaveChannel(v0 , v1 , v2 , 2) , dstR + x);
+    }
+#endif
+    for ( ; x < width ; x++)
+    {
+        dstB[x] = src[3 * x] / 255.0f;
+        dstG[x] = src[3 * x + 1] / 255.0f;
+        dstR[x] = src[3 * x + 2] / 255.0f;
+    }
+}
+
+void PackLetterboxToBlob(const cv::Mat& image , float* blob , int blobWidth , int blobHeight , \
+    int left , int top , const uchar padValue[3])
+{
+    CV_Assert(image.type() == CV_8UC3);
+    CV_Assert(left >= 0 && top >= 0 && left + image.cols <= blobWidth && top + image.rows <= blobHeight);
+
+    size_t planeSize = (size_t)blobWidth * blobHeight;
+    float* planes[3] = { blob , blob + planeSize , blob + 2 * planeSize };
+    float pad[3] = { padValue[0] / 255.0f , padValue[1] / 255.0f , padValue[2] / 255.0f };
+    int right = blobWidth - left - image.cols;
+
+    for (int c = 0 ; c < 3 ; c++)
+    {
+        // Whole border rows above and below the image
+        std::fill(planes[c] , planes[c] + (size_t)top * blobWidth , pad[c]);
+        std::fill(planes[c] + (size_t)(top + image.rows) * blobWidth , planes[c] + planeSize , pad[c]);
+    }
+
+    for (int h = 0 ; h < image.rows ; h++)
+    {
+        size_t rowOffset = (size_t)(top + h) * blobWidth;
+        for (int c = 0 ; c < 3 ; c++)
+        {
+            std::fill(planes[c] + rowOffset , planes[c] + rowOffset + left , pad[c]);
+            std::fill(planes[c] + rowOffset + left + image.cols , planes[c] + rowOffset + left + image.cols + right , pad[c]);
+        }
+        ConvertRowBGR(image.ptr<uchar>(h) , planes[0] + rowOffset + left , planes[1] + rowOffset + left , \
+            planes[2] + rowOffset + left , image.cols);
+    }
+}
+
+void QuantizeBlob(const float* blob , size_t count , float scale , int zeroPoint , bool isSigned , uint8_t* output)
+{
+    const float low = isSigned ? -128.0f : 0.0f;
+    const float high = isSigned ? 127.0f : 255.0f;
+    for (size_t i = 0 ; i < count ; i++)
+    {
+        // nearbyint follows the default round-to-nearest-even mode
+        float q = std::nearbyint(blob[i] / scale) + (float)zeroPoint;
+        output[i] = (uint8_t)(int)std::min(std::max(q , low) , high);
+    }
+}
+
+const char* PreprocessKernelName()
+{
+#if defined(PREPROCESS_KERNEL_AVX2)
+    return "avx2";
+#elif defined(PREPROCESS_KERNEL_SSE41)
+    return "sse4.1";
+#else
+    return "scalar";
+#endif
+}
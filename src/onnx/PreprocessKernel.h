@@ -0,0 +1,26 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+/*
+    Fused letterbox tail : write an already resized 8UC3 image into a planar float blob.
+    The image lands at (left , top) inside a blobWidth x blobHeight canvas , every pixel is
+    divided by 255 and de-interleaved from HWC to CHW in the same pass , and the border is
+    filled with padValue[c] / 255. Output matches cv::copyMakeBorder followed by the
+    per-pixel Normalize loop bit for bit.
+
+    The row kernel is vectorized with AVX2 or SSE4.1 when the compiler targets them and
+    falls back to scalar code otherwise.
+*/
+void PackLetterboxToBlob(const cv::Mat& image , float* blob , int blobWidth , int blobHeight , \
+    int left , int top , const uchar padValue[3]);
+
+/*
+    Blob for models with an 8-bit input (QDQ models whose input QuantizeLinear was folded away) :
+    q = saturate(round(x / scale) + zeroPoint) , rounding half to even like QuantizeLinear.
+    isSigned writes int8 bit patterns instead of uint8.
+*/
+void QuantizeBlob(const float* blob , size_t count , float scale , int zeroPoint , bool isSigned , uint8_t* output);
+
+// Name of the row kernel compiled into this binary : "avx2" , "sse4.1" or "scalar"
+const char* PreprocessKernelName();
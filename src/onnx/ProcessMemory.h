@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+// Resident set size of this process in bytes , 0 when the platform does not report it
+
+inline uint64_t CurrentRSSBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess() , &counters , sizeof(counters)))
+    {
+        return (uint64_t)counters.WorkingSetSize;
+    }
+    return 0;
+#else
+    long pages = 0;
+    FILE* statm = fopen("/proc/self/statm" , "r");
+    if (statm == nullptr)
+    {
+        return 0;
+    }
+    if (fscanf(statm , "%*s %ld" , &pages) != 1)
+    {
+        pages = 0;
+    }
+    fclose(statm);
+    return (uint64_t)pages * (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+inline uint64_t PeakRSSBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess() , &counters , sizeof(counters)))
+    {
+        return (uint64_t)counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF , &usage) != 0)
+    {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// Memory of this process not backed by a file (heap , ORT arenas) , 0 when unknown. Mapped model
+// pages count towards the RSS of every process using them but are one page-cache copy , this does
+// not include them. Windows reports the private commit charge , Linux resident minus shared pages.
+inline uint64_t CurrentPrivateBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS_EX counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess() , (PROCESS_MEMORY_COUNTERS*)&counters , sizeof(counters)))
+    {
+        return (uint64_t)counters.PrivateUsage;
+    }
+    return 0;
+#else
+    long pages = 0 , shared = 0;
+    FILE* statm = fopen("/proc/self/statm" , "r");
+    if (statm == nullptr)
+    {
+        return 0;
+    }
+    if (fscanf(statm , "%*s %ld %ld" , &pages , &shared) != 2)
+    {
+        pages = shared = 0;
+    }
+    fclose(statm);
+    return (uint64_t)std::max(0L , pages - shared) * (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
@@ -0,0 +1,347 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "ResultStore.h"
+#include "Trace.h"
+
+// stdio buffer per output file , records are 32 bytes so this is one write call per 32K detections
+static const size_t WRITER_BUFFER_BYTES = 1 << 20;
+
+// Names and class names are user data , everything below 0x20 is escaped as JSON requires
+static void AppendJsonString(std::string& out , const std::string& text)
+{
+    out += '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped , sizeof(escaped) , "\\u%04x" , (unsigned)c);
+            out += escaped;
+        } else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+ResultWriter::ResultWriter(const YOLOv8OnnxRunner& detector , const RESULT_WRITER_CONFIG& config) : \
+    detector(detector) , config(config) , queue(config.queueCapacity) , encodeQueue(config.queueCapacity)
+{
+    std::error_code error;
+    std::filesystem::create_directories(config.directory , error);
+    if (config.images)
+    {
+        std::filesystem::create_directories(config.directory / "images" , error);
+    }
+    this->opened = !error;
+
+    if (this->opened && config.binary)
+    {
+        this->records = OpenWrite(config.directory / "detections.bin" , this->buffers[0]);
+        this->index = OpenWrite(config.directory / "detections.idx" , this->buffers[1]);
+        this->names = OpenWrite(config.directory / "images.txt" , this->buffers[2]);
+        this->opened = this->records != nullptr && this->index != nullptr && this->names != nullptr;
+        if (this->opened)
+        {
+            RESULT_FILE_HEADER header;
+            header.entrySize = sizeof(RESULT_RECORD);
+            fwrite(&header , sizeof(header) , 1 , this->records);
+            header.entrySize = sizeof(RESULT_INDEX_ENTRY);
+            fwrite(&header , sizeof(header) , 1 , this->index);
+        }
+    }
+    if (this->opened && config.jsonl)
+    {
+        this->jsonl = OpenWrite(config.directory / "detections.jsonl" , this->buffers[3]);
+        this->opened = this->jsonl != nullptr;
+    }
+    if (!this->opened)
+    {
+        LOG_ERROR("Cannot create the result files in " << config.directory.string());
+    }
+
+    this->writer = std::thread(&ResultWriter::WriteLoop , this);
+    if (config.images)
+    {
+        for (int i = 0 ; i < std::max(1 , config.encodeWorkers) ; i++)
+        {
+            this->encoders.emplace_back(&ResultWriter::EncodeLoop , this);
+        }
+    }
+}
+
+ResultWriter::~ResultWriter()
+{
+    Close();
+}
+
+FILE* ResultWriter::OpenWrite(const std::filesystem::path& path , std::vector<char>& buffer)
+{
+    FILE* file = fopen(path.string().c_str() , "wb");
+    if (file != nullptr)
+    {
+        buffer.resize(WRITER_BUFFER_BYTES);
+        setvbuf(file , buffer.data() , _IOFBF , buffer.size());
+    }
+    return file;
+}
+
+bool ResultWriter::IsOpen() const
+{
+    return this->opened;
+}
+
+uint64_t ResultWriter::Write(const std::string& name , const std::vector<DETECT_RESULT>& result , const cv::Mat& image)
+{
+    RESULT_WRITE_ITEM item;
+    item.name = name;
+    item.result = result;
+    if (this->config.images)
+    {
+        item.image = image;
+    }
+
+    std::lock_guard<std::mutex> lock(this->writeMutex);
+    uint64_t imageId = this->nextImageId;
+    item.imageId = imageId;
+    if (this->closed || !this->queue.Push(std::move(item)))
+    {
+        LOG_WARN("Result writer closed , " << name << " not written");
+        return imageId;
+    }
+    this->nextImageId++;
+    return imageId;
+}
+
+void ResultWriter::WriteJson(const RESULT_WRITE_ITEM& item)
+{
+    std::string line;
+    line.reserve(64 + item.result.size() * 96);
+    line += "{\"id\":" + std::to_string(item.imageId) + ",\"image\":";
+    AppendJsonString(line , item.name);
+    line += ",\"detections\":[";
+    for (size_t i = 0 ; i < item.result.size() ; i++)
+    {
+        const DETECT_RESULT& re = item.result[i];
+        char numbers[160];
+        snprintf(numbers , sizeof(numbers) , "{\"class\":%d,\"confidence\":%.4f,\"box\":[%d,%d,%d,%d],\"name\":" , \
+            re.classId , re.confidence , re.box.x , re.box.y , re.box.width , re.box.height);
+        line += i > 0 ? "," : "";
+        line += numbers;
+        AppendJsonString(line , this->detector.GetClassName(re.classId));
+        line += '}';
+    }
+    line += "]}\n";
+    fwrite(line.data() , 1 , line.size() , this->jsonl);
+}
+
+void ResultWriter::WriteLoop()
+{
+    RESULT_WRITE_ITEM item;
+    while (this->queue.Pop(item))
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (this->records != nullptr)
+        {
+            for (const auto& re : item.result)
+            {
+                RESULT_RECORD record;
+                record.imageId = item.imageId;
+                record.classId = re.classId;
+                record.confidence = re.confidence;
+                record.x = (float)re.box.x;
+                record.y = (float)re.box.y;
+                record.width = (float)re.box.width;
+                record.height = (float)re.box.height;
+                fwrite(&record , sizeof(record) , 1 , this->records);
+            }
+            RESULT_INDEX_ENTRY entry;
+            entry.imageId = item.imageId;
+            entry.firstRecord = this->recordCount;
+            entry.count = (uint32_t)item.result.size();
+            fwrite(&entry , sizeof(entry) , 1 , this->index);
+            this->recordCount += item.result.size();
+
+            fputs(item.name.c_str() , this->names);
+            fputc('\n' , this->names);
+        }
+        if (this->jsonl != nullptr)
+        {
+            WriteJson(item);
+        }
+        double elapsed = std::chrono::duration<double , std::milli>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(this->statsMutex);
+            this->stats.images++;
+            this->stats.detections += item.result.size();
+            this->stats.writeMs += elapsed;
+        }
+
+        if (this->config.images && !item.image.empty())
+        {
+            this->encodeQueue.Push(std::move(item));
+        }
+        item = RESULT_WRITE_ITEM();
+    }
+}
+
+void ResultWriter::EncodeLoop()
+{
+    const std::vector<int> params = { cv::IMWRITE_JPEG_QUALITY , this->config.imageQuality };
+    RESULT_WRITE_ITEM item;
+    while (this->encodeQueue.Pop(item))
+    {
+        auto start = std::chrono::steady_clock::now();
+        // The caller may still show its image , annotate a copy
+        cv::Mat annotated = this->detector.VisualizationPredicition(item.image.clone() , item.result);
+        char prefix[32];
+        snprintf(prefix , sizeof(prefix) , "%08llu_" , (unsigned long long)item.imageId);
+        std::filesystem::path path = this->config.directory / "images" / \
+            (prefix + std::filesystem::path(item.name).stem().string() + ".jpg");
+        bool written = false;
+        try
+        {
+            written = cv::imwrite(path.string() , annotated , params);
+        }
+        catch(const std::exception& e)
+        {
+            LOG_WARN("Cannot write " << path.string() << " : " << e.what());
+        }
+        double elapsed = std::chrono::duration<double , std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        this->stats.encoded += written ? 1 : 0;
+        this->stats.failed += written ? 0 : 1;
+        this->stats.encodeMs += elapsed;
+    }
+}
+
+void ResultWriter::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->writeMutex);
+        if (this->closed)
+        {
+            return;
+        }
+        this->closed = true;
+    }
+    this->queue.Close();
+    this->writer.join();
+    this->encodeQueue.Close();
+    for (auto& encoder : this->encoders)
+    {
+        encoder.join();
+    }
+    for (FILE* file : { this->records , this->index , this->names , this->jsonl })
+    {
+        if (file != nullptr)
+        {
+            fclose(file);
+        }
+    }
+    this->records = this->index = this->names = this->jsonl = nullptr;
+}
+
+RESULT_WRITER_STATS ResultWriter::GetStats()
+{
+    RESULT_WRITER_STATS result;
+    {
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        result = this->stats;
+    }
+    result.queue = this->queue.Stats();
+    result.encodeQueue = this->encodeQueue.Stats();
+    return result;
+}
+
+void ResultWriter::PrintReport()
+{
+    RESULT_WRITER_STATS report = GetStats();
+    fprintf(stdout, "[WRITER] %s : images %llu , detections %llu , writer busy %.1fms\n",
+        this->config.directory.string().c_str(), (unsigned long long)report.images,
+        (unsigned long long)report.detections, report.writeMs);
+    fprintf(stdout, "[WRITER] queue capacity %zu , mean occupancy %.2f , max %zu , inference blocked %.1fms\n",
+        report.queue.capacity, report.queue.meanOccupancy, report.queue.maxOccupancy, report.queue.pushWaitMs);
+    if (this->config.images)
+    {
+        fprintf(stdout, "[WRITER] annotated images %llu , failed %llu , encoders %zu busy %.1fms , writer blocked on them %.1fms\n",
+            (unsigned long long)report.encoded, (unsigned long long)report.failed, this->encoders.size(),
+            report.encodeMs, report.encodeQueue.pushWaitMs);
+    }
+}
+
+// Maps one store file and checks its header , nullptr data when it is missing or foreign
+static const char* MapStoreFile(const std::filesystem::path& path , uint32_t entrySize , \
+    std::unique_ptr<MappedFile>& file , size_t& entries)
+{
+    file.reset(new MappedFile(path.string()));
+    RESULT_FILE_HEADER expected;
+    const RESULT_FILE_HEADER* header = (const RESULT_FILE_HEADER*)file->Data();
+    if (!file->IsOpen() || file->Size() < sizeof(RESULT_FILE_HEADER) || \
+        memcmp(header->magic , expected.magic , sizeof(expected.magic)) != 0 || \
+        header->version != RESULT_VERSION || header->entrySize != entrySize)
+    {
+        return nullptr;
+    }
+    // A trailing partial entry is a write in progress
+    entries = (file->Size() - sizeof(RESULT_FILE_HEADER)) / entrySize;
+    return file->Data() + sizeof(RESULT_FILE_HEADER);
+}
+
+bool ResultReader::Open(const std::filesystem::path& directory)
+{
+    size_t entryCount = 0;
+    this->records = (const RESULT_RECORD*)MapStoreFile(directory / "detections.bin" , sizeof(RESULT_RECORD) , \
+        this->recordFile , this->recordCount);
+    this->entries = (const RESULT_INDEX_ENTRY*)MapStoreFile(directory / "detections.idx" , sizeof(RESULT_INDEX_ENTRY) , \
+        this->indexFile , entryCount);
+    if (this->records == nullptr || this->entries == nullptr)
+    {
+        this->records = nullptr;
+        this->entries = nullptr;
+        this->recordCount = this->imageCount = 0;
+        return false;
+    }
+
+    // Both files are flushed independently , keep the images whose records are all there
+    this->imageCount = entryCount;
+    while (this->imageCount > 0 && \
+        this->entries[this->imageCount - 1].firstRecord + this->entries[this->imageCount - 1].count > this->recordCount)
+    {
+        this->imageCount--;
+    }
+
+    this->names.clear();
+    std::ifstream nameFile((directory / "images.txt").string());
+    std::string line;
+    while (this->names.size() < this->imageCount && std::getline(nameFile , line))
+    {
+        this->names.push_back(line);
+    }
+    return true;
+}
+
+const RESULT_RECORD* ResultReader::ImageRecords(uint64_t imageId , size_t& count) const
+{
+    // Ids start at 0 and every image has an entry , so the id is the entry number
+    if (imageId >= this->imageCount || this->entries[imageId].imageId != imageId)
+    {
+        count = 0;
+        return nullptr;
+    }
+    count = this->entries[imageId].count;
+    return this->records + this->entries[imageId].firstRecord;
+}
+
+std::string ResultReader::ImageName(uint64_t imageId) const
+{
+    return imageId < this->names.size() ? this->names[imageId] : std::string();
+}
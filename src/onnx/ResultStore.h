@@ -0,0 +1,172 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <opencv2/opencv.hpp>
+
+#include "BoundedQueue.h"
+#include "MappedFile.h"
+#include "YOLOv8OnnxRunner.h"
+
+/*
+    Detection store , append-only , in a result directory :
+      detections.bin : RESULT_FILE_HEADER then one RESULT_RECORD per detection , images in id order
+      detections.idx : RESULT_FILE_HEADER then one RESULT_INDEX_ENTRY per image , also images without detections
+      images.txt     : image name of id n on line n
+    Each run starts a new store. A reader of files still being written uses only the index
+    entries whose records are already on disk. Little endian , as is every target of this runner.
+*/
+#define RESULT_MAGIC "YOLODET1"
+#define RESULT_VERSION 1
+
+#pragma pack(push , 1)
+typedef struct _RESULT_FILE_HEADER
+{
+    char magic[8] = { 'Y' , 'O' , 'L' , 'O' , 'D' , 'E' , 'T' , '1' };
+    uint32_t version = RESULT_VERSION;
+    uint32_t entrySize = 0; // sizeof the RESULT_RECORD or RESULT_INDEX_ENTRY that follow
+} RESULT_FILE_HEADER;
+
+typedef struct _RESULT_RECORD
+{
+    uint64_t imageId = 0;
+    int32_t classId = 0;
+    float confidence = 0.0f;
+    float x = 0.0f , y = 0.0f , width = 0.0f , height = 0.0f; // Source image pixels
+} RESULT_RECORD;
+
+typedef struct _RESULT_INDEX_ENTRY
+{
+    uint64_t imageId = 0;
+    uint64_t firstRecord = 0; // Record number in detections.bin , not a byte offset
+    uint32_t count = 0;
+    uint32_t reserved = 0;
+} RESULT_INDEX_ENTRY;
+#pragma pack(pop)
+
+typedef struct _RESULT_WRITER_CONFIG
+{
+    std::filesystem::path directory = "output";
+    bool binary = true; // detections.bin / .idx / images.txt
+    bool jsonl = false; // detections.jsonl , one line per image
+    bool images = false; // Annotated copies of the images , encoded off the writer thread
+    int imageQuality = 90; // JPEG quality of the annotated images
+    int encodeWorkers = 1;
+    int queueCapacity = 256; // Images waiting to be written before Write blocks
+} RESULT_WRITER_CONFIG;
+
+typedef struct _RESULT_WRITER_STATS
+{
+    uint64_t images = 0;
+    uint64_t detections = 0;
+    uint64_t encoded = 0;
+    uint64_t failed = 0; // Annotated images that could not be encoded or written
+    double writeMs = 0.0; // Writer thread busy time (records , index , JSON)
+    double encodeMs = 0.0; // Encoder threads busy time
+    QUEUE_STATS queue; // Write side : pushWaitMs is time inference threads were held up by the disk
+    QUEUE_STATS encodeQueue;
+} RESULT_WRITER_STATS;
+
+typedef struct _RESULT_WRITE_ITEM
+{
+    uint64_t imageId = 0;
+    std::string name;
+    std::vector<DETECT_RESULT> result;
+    cv::Mat image; // Only when annotated images are enabled
+} RESULT_WRITE_ITEM;
+
+/*
+    Background result writer. Write copies the detections into a queue and returns , one writer
+    thread appends the records , index and JSON lines through large stdio buffers , and encoder
+    threads draw and encode annotated images so JPEG encoding never sits in front of the records.
+    The queue is bounded : a disk that cannot keep up eventually blocks Write instead of growing
+    memory without limit , the stall is reported. Close (or the destructor) drains and flushes.
+*/
+class ResultWriter
+{
+private:
+    const YOLOv8OnnxRunner& detector; // Class names and annotation
+    RESULT_WRITER_CONFIG config;
+    BoundedQueue<RESULT_WRITE_ITEM> queue;
+    BoundedQueue<RESULT_WRITE_ITEM> encodeQueue;
+    std::thread writer;
+    std::vector<std::thread> encoders;
+    std::mutex writeMutex; // Ids are handed out in queue order , so the records stay sorted by image id
+    uint64_t nextImageId = 0;
+    bool opened = false;
+    bool closed = false;
+
+    FILE* records = nullptr;
+    FILE* index = nullptr;
+    FILE* names = nullptr;
+    FILE* jsonl = nullptr;
+    std::vector<char> buffers[4];
+    uint64_t recordCount = 0;
+
+    std::mutex statsMutex;
+    RESULT_WRITER_STATS stats;
+
+    FILE* OpenWrite(const std::filesystem::path& path , std::vector<char>& buffer);
+    void WriteLoop();
+    void EncodeLoop();
+    void WriteJson(const RESULT_WRITE_ITEM& item);
+
+public:
+    ResultWriter(const YOLOv8OnnxRunner& detector , const RESULT_WRITER_CONFIG& config);
+    ~ResultWriter();
+
+    // False when the result directory or a file cannot be created
+    bool IsOpen() const;
+
+    /* Thread safe. Queues the detections of one image and returns its id. image is only kept
+       when annotated images are enabled , shared and not copied : do not write into its pixels
+       afterwards (a fresh cv::imread per image is fine , a reused capture buffer is not). */
+    uint64_t Write(const std::string& name , const std::vector<DETECT_RESULT>& result , const cv::Mat& image = cv::Mat());
+
+    // Drain both queues , flush and close the files
+    void Close();
+
+    RESULT_WRITER_STATS GetStats();
+
+    void PrintReport();
+};
+
+/*
+    Reader over a result directory. detections.bin and .idx are mapped , so a query touches only
+    the pages it reads and any number of processes share one copy. Files still being appended
+    are read up to the last complete index entry at open time.
+*/
+class ResultReader
+{
+private:
+    std::unique_ptr<MappedFile> recordFile;
+    std::unique_ptr<MappedFile> indexFile;
+    const RESULT_RECORD* records = nullptr;
+    const RESULT_INDEX_ENTRY* entries = nullptr;
+    size_t recordCount = 0;
+    size_t imageCount = 0;
+    std::vector<std::string> names;
+
+public:
+    // False when the files are missing or not in this format
+    bool Open(const std::filesystem::path& directory);
+
+    size_t Images() const { return imageCount; }
+
+    size_t Records() const { return recordCount; }
+
+    // Every detection , in image id order
+    const RESULT_RECORD* AllRecords() const { return records; }
+
+    // Detections of one image , nullptr with count 0 for an unknown id
+    const RESULT_RECORD* ImageRecords(uint64_t imageId , size_t& count) const;
+
+    // Name the image was written with , empty when images.txt has no line for it
+    std::string ImageName(uint64_t imageId) const;
+};
@@ -0,0 +1,93 @@
+#include "RunnerPool.h"
+#include "HostProfile.h"
+#include "Trace.h"
+
+RunnerPool::Lease::~Lease()
+{
+    if (pool != nullptr)
+    {
+        pool->inflight[index]--;
+    }
+}
+
+RunnerPool::RunnerPool(const Configuration& cfg , int numSessions)
+{
+    numSessions = std::max(1 , numSessions);
+    inflight.reset(new std::atomic<int>[numSessions]);
+    dispatched.reset(new std::atomic<uint64_t>[numSessions]);
+    for (int i = 0 ; i < numSessions ; i++)
+    {
+        inflight[i] = 0;
+        dispatched[i] = 0;
+        // Each session pins its threads to its own processors
+        runners.emplace_back(new YOLOv8OnnxRunner(PoolSessionConfig(cfg , numSessions , i)));
+    }
+    LOG_INFO("RunnerPool sessions : " << numSessions);
+}
+
+RunnerPool::~RunnerPool()
+{
+    // Bound contexts reference the sessions , release them while the runners are still alive
+    std::lock_guard<std::mutex> lock(contextsMutex);
+    contexts.clear();
+}
+
+RunnerPool::Lease RunnerPool::Acquire()
+{
+    size_t count = runners.size();
+    size_t start = cursor++ % count;
+    size_t best = start;
+    int bestLoad = inflight[start].load();
+    for (size_t k = 1 ; k < count && bestLoad > 0 ; k++)
+    {
+        size_t candidate = (start + k) % count;
+        int load = inflight[candidate].load();
+        if (load < bestLoad)
+        {
+            best = candidate;
+            bestLoad = load;
+        }
+    }
+    inflight[best]++;
+    dispatched[best]++;
+    return Lease(this , best);
+}
+
+REQUEST_CONTEXT& RunnerPool::ThreadContext(size_t index)
+{
+    // Contexts of threads that have exited stay until the pool goes , a new thread with a reused id takes them over
+    std::lock_guard<std::mutex> lock(contextsMutex);
+    std::vector<std::unique_ptr<REQUEST_CONTEXT>>& threadContexts = contexts[std::this_thread::get_id()];
+    if (threadContexts.size() < runners.size())
+    {
+        threadContexts.resize(runners.size());
+    }
+    if (!threadContexts[index])
+    {
+        threadContexts[index].reset(new REQUEST_CONTEXT());
+    }
+    return *threadContexts[index];
+}
+
+std::vector<DETECT_RESULT> RunnerPool::InferenceSingleImage(const cv::Mat& srcImage , STAGE_TIMES* times)
+{
+    // One context per runner and thread , so IoBinding buffers stay bound to their session
+    Lease lease = Acquire();
+    REQUEST_CONTEXT& ctx = ThreadContext(lease.Index());
+    std::vector<DETECT_RESULT> result = lease.Runner().InferenceSingleImage(srcImage , ctx);
+    if (times != nullptr)
+    {
+        *times = ctx.times;
+    }
+    return result;
+}
+
+std::vector<uint64_t> RunnerPool::DispatchCounts() const
+{
+    std::vector<uint64_t> counts;
+    for (size_t i = 0 ; i < runners.size() ; i++)
+    {
+        counts.push_back(dispatched[i].load());
+    }
+    return counts;
+}
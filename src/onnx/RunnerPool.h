@@ -0,0 +1,62 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "Configuration.h"
+#include "YOLOv8OnnxRunner.h"
+
+/*
+    K independent runners (one Ort::Session each) shared by any number of caller threads.
+    Every call goes to the runner with the fewest requests in flight , scanning from a rotating
+    start so ties spread evenly. Each caller thread gets its own REQUEST_CONTEXT per runner , owned
+    by the pool : contexts hold IoBindings of the pool's sessions and are freed before them.
+*/
+class RunnerPool
+{
+private:
+    std::vector<std::unique_ptr<YOLOv8OnnxRunner>> runners;
+    std::unique_ptr<std::atomic<int>[]> inflight;
+    std::unique_ptr<std::atomic<uint64_t>[]> dispatched;
+    std::atomic<size_t> cursor{ 0 };
+    // Per caller thread , one context per runner. Declared after runners , so destroyed first
+    std::mutex contextsMutex;
+    std::map<std::thread::id , std::vector<std::unique_ptr<REQUEST_CONTEXT>>> contexts;
+
+    REQUEST_CONTEXT& ThreadContext(size_t index);
+
+public:
+    // Keeps a runner marked busy for as long as it lives
+    class Lease
+    {
+    private:
+        RunnerPool* pool;
+        size_t index;
+
+    public:
+        Lease(RunnerPool* pool , size_t index) : pool(pool) , index(index) {}
+        Lease(Lease&& other) noexcept : pool(other.pool) , index(other.index) { other.pool = nullptr; }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        YOLOv8OnnxRunner& Runner() const { return *pool->runners[index]; }
+        size_t Index() const { return index; }
+    };
+
+    RunnerPool(const Configuration& cfg , int numSessions);
+    ~RunnerPool();
+
+    size_t Size() const { return runners.size(); }
+
+    Lease Acquire();
+
+    // Thread safe , the calling thread's context buffers are reused between calls
+    std::vector<DETECT_RESULT> InferenceSingleImage(const cv::Mat& srcImage , STAGE_TIMES* times = nullptr);
+
+    // Requests handed to each runner so far
+    std::vector<uint64_t> DispatchCounts() const;
+};
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "ServerProtocol.h"
+
+#ifdef _WIN32
+#include <afunix.h>
+typedef int SOCKET_LENGTH;
+#define SHUTDOWN_BOTH SD_BOTH
+#else
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+typedef socklen_t SOCKET_LENGTH;
+#define SHUTDOWN_BOTH SHUT_RDWR
+#endif
+
+static bool LocalAddress(const std::string& path , sockaddr_un& address)
+{
+    memset(&address , 0 , sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    memcpy(address.sun_path , path.c_str() , path.size());
+    return true;
+}
+
+bool SocketStartup()
+{
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2 , 2) , &data) == 0;
+#else
+    return true;
+#endif
+}
+
+LOCAL_SOCKET ListenLocal(const std::string& path , int backlog)
+{
+    sockaddr_un address;
+    if (!LocalAddress(path , address))
+    {
+        return INVALID_LOCAL_SOCKET;
+    }
+    std::error_code error;
+    std::filesystem::remove(path , error);
+
+    LOCAL_SOCKET listener = socket(AF_UNIX , SOCK_STREAM , 0);
+    if (listener == INVALID_LOCAL_SOCKET)
+    {
+        return INVALID_LOCAL_SOCKET;
+    }
+    if (bind(listener , (const sockaddr*)&address , (SOCKET_LENGTH)sizeof(address)) != 0 || listen(listener , backlog) != 0)
+    {
+        CloseLocal(listener);
+        return INVALID_LOCAL_SOCKET;
+    }
+    return listener;
+}
+
+LOCAL_SOCKET ConnectLocal(const std::string& path)
+{
+    sockaddr_un address;
+    if (!LocalAddress(path , address))
+    {
+        return INVALID_LOCAL_SOCKET;
+    }
+    LOCAL_SOCKET client = socket(AF_UNIX , SOCK_STREAM , 0);
+    if (client == INVALID_LOCAL_SOCKET)
+    {
+        return INVALID_LOCAL_SOCKET;
+    }
+    if (connect(client , (const sockaddr*)&address , (SOCKET_LENGTH)sizeof(address)) != 0)
+    {
+        CloseLocal(client);
+        return INVALID_LOCAL_SOCKET;
+    }
+    return client;
+}
+
+LOCAL_SOCKET AcceptLocal(LOCAL_SOCKET listener , int timeoutMs)
+{
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(listener , &readable);
+    timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    // The first argument is ignored by Winsock
+    if (select((int)listener + 1 , &readable , nullptr , nullptr , &timeout) <= 0)
+    {
+        return INVALID_LOCAL_SOCKET;
+    }
+    return accept(listener , nullptr , nullptr);
+}
+
+bool SendAll(LOCAL_SOCKET socket , const void* data , size_t bytes)
+{
+    const char* cursor = (const char*)data;
+    while (bytes > 0)
+    {
+#ifdef _WIN32
+        int sent = send(socket , cursor , (int)std::min(bytes , (size_t)1 << 30) , 0);
+#else
+        ssize_t sent = send(socket , cursor , bytes , MSG_NOSIGNAL);
+#endif
+        if (sent <= 0)
+        {
+            return false;
+        }
+        cursor += sent;
+        bytes -= (size_t)sent;
+    }
+    return true;
+}
+
+bool RecvAll(LOCAL_SOCKET socket , void* data , size_t bytes)
+{
+    char* cursor = (char*)data;
+    while (bytes > 0)
+    {
+#ifdef _WIN32
+        int received = recv(socket , cursor , (int)std::min(bytes , (size_t)1 << 30) , 0);
+#else
+        ssize_t received = recv(socket , cursor , bytes , 0);
+#endif
+        if (received <= 0)
+        {
+            return false;
+        }
+        cursor += received;
+        bytes -= (size_t)received;
+    }
+    return true;
+}
+
+void ShutdownLocal(LOCAL_SOCKET socket)
+{
+    shutdown(socket , SHUTDOWN_BOTH);
+}
+
+void CloseLocal(LOCAL_SOCKET socket)
+{
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+typedef SOCKET LOCAL_SOCKET;
+#define INVALID_LOCAL_SOCKET INVALID_SOCKET
+#else
+typedef int LOCAL_SOCKET;
+#define INVALID_LOCAL_SOCKET (-1)
+#endif
+
+/*
+    Wire protocol of the local inference server , over a Unix domain socket (AF_UNIX , on
+    Windows 10 1803 and later too). Both ends run on the same host , so structs go out in host
+    byte order. A client may keep several requests in flight on one connection : every request
+    carries an id that comes back in its response , and responses follow batch completion ,
+    not request order.
+
+        request  : WIRE_REQUEST , payloadBytes of frame
+        response : WIRE_RESPONSE , count x WIRE_DETECTION
+*/
+
+#define SERVER_MAGIC 0x4F4C4F59 // "YOLO"
+#define DEFAULT_SOCKET_PATH "yolov8-server.sock"
+#define MAX_REQUEST_PAYLOAD (64u << 20)
+
+// FRAME_ENCODED : any cv::imdecode format ; FRAME_RAW_BGR : width x height x 3 bytes , no row padding
+enum FRAME_KIND { FRAME_ENCODED = 0 , FRAME_RAW_BGR = 1 };
+
+enum { STATUS_OK = 0 , STATUS_BAD_REQUEST = -1 , STATUS_DECODE_FAILED = -2 , STATUS_OVERLOADED = -3 , STATUS_FAILED = -4 };
+
+#pragma pack(push , 1)
+typedef struct _WIRE_REQUEST
+{
+    uint32_t magic = SERVER_MAGIC;
+    uint32_t kind = FRAME_ENCODED;
+    uint64_t requestId = 0;
+    uint32_t width = 0; // Raw frames only
+    uint32_t height = 0;
+    uint32_t payloadBytes = 0;
+} WIRE_REQUEST;
+
+typedef struct _WIRE_RESPONSE
+{
+    uint32_t magic = SERVER_MAGIC;
+    int32_t status = STATUS_OK;
+    uint64_t requestId = 0;
+    uint32_t count = 0; // Detections following
+    uint32_t batchSize = 0; // Requests in the batch this one ran in
+    float queueMs = 0.0f; // Received -> batch start
+    float inferenceMs = 0.0f; // The whole batch
+} WIRE_RESPONSE;
+
+typedef struct _WIRE_DETECTION
+{
+    int32_t classId;
+    float confidence;
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+} WIRE_DETECTION;
+#pragma pack(pop)
+
+// Winsock initialization , a no-op elsewhere ; call once before any other socket function
+bool SocketStartup();
+
+// Bind path (a stale socket file is removed first) and listen
+LOCAL_SOCKET ListenLocal(const std::string& path , int backlog);
+
+LOCAL_SOCKET ConnectLocal(const std::string& path);
+
+// Wait up to timeoutMs for a client , INVALID_LOCAL_SOCKET on timeout or error
+LOCAL_SOCKET AcceptLocal(LOCAL_SOCKET listener , int timeoutMs);
+
+// false when the peer went away
+bool SendAll(LOCAL_SOCKET socket , const void* data , size_t bytes);
+
+bool RecvAll(LOCAL_SOCKET socket , void* data , size_t bytes);
+
+// Ends both directions , a thread blocked in RecvAll on the socket returns false
+void ShutdownLocal(LOCAL_SOCKET socket);
+
+void CloseLocal(LOCAL_SOCKET socket);
@@ -0,0 +1,143 @@
+#include <map>
+#include <cstring>
+
+#include "SharedModel.h"
+#include "GraphPreprocess.h"
+#include "Trace.h"
+
+// Smaller initializers (biases , shapes , scalars) are left to the session , sharing them saves nothing
+static const size_t SHARED_INITIALIZER_MIN_BYTES = 1024;
+
+// Bytes per element of a TensorProto.DataType with a fixed size , 0 for the others
+static size_t ElementSize(int32_t dataType)
+{
+    switch (dataType)
+    {
+    case 2: case 3: case 9: // uint8 int8 bool
+        return 1;
+    case 4: case 5: case 10: case 16: // uint16 int16 float16 bfloat16
+        return 2;
+    case 1: case 6: case 12: // float int32 uint32
+        return 4;
+    case 7: case 11: case 13: // int64 double uint64
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+SharedModel::SharedModel(std::unique_ptr<MappedFile> mapped) : mapped(std::move(mapped))
+{
+}
+
+std::shared_ptr<SharedModel> SharedModel::Acquire(const std::string& path)
+{
+    static std::mutex registryMutex;
+    static std::map<std::string , std::weak_ptr<SharedModel>> registry;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::shared_ptr<SharedModel> model = registry[path].lock();
+    if (model)
+    {
+        return model;
+    }
+    std::unique_ptr<MappedFile> mapped(new MappedFile(path));
+    if (!mapped->IsOpen())
+    {
+        LOG_WARN("Cannot map " << path);
+        return nullptr;
+    }
+    LOG_INFO("Model mapped : " << path << " , " << mapped->Size() / (1024 * 1024) << "MB");
+    model = std::make_shared<SharedModel>(std::move(mapped));
+    registry[path] = model;
+    return model;
+}
+
+void SharedModel::RegisterEnvAllocator(Ort::Env& env)
+{
+    static std::mutex registerMutex;
+    static bool registered = false;
+
+    std::lock_guard<std::mutex> lock(registerMutex);
+    if (registered)
+    {
+        return;
+    }
+    try
+    {
+        // The env is a process-wide singleton , the arena outlives every runner's Ort::Env handle
+        Ort::MemoryInfo arenaInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator , OrtMemTypeDefault);
+        env.CreateAndRegisterAllocator(arenaInfo , nullptr);
+        registered = true;
+    }
+    catch(const std::exception& e)
+    {
+        LOG_WARN("Shared CPU arena not registered , sessions keep their own : " << e.what());
+    }
+}
+
+void SharedModel::BuildInitializers()
+{
+    std::vector<RAW_INITIALIZER> initializers;
+    if (!ListRawInitializers(std::string_view(mapped->Data() , mapped->Size()) , initializers))
+    {
+        LOG_WARN("Cannot read the model initializers , weights are not shared");
+        return;
+    }
+
+    for (const auto& initializer : initializers)
+    {
+        size_t elementSize = ElementSize(initializer.dataType);
+        size_t elements = 1;
+        for (auto dim : initializer.dims)
+        {
+            elements *= dim > 0 ? (size_t)dim : 0;
+        }
+        if (elementSize == 0 || initializer.bytes < SHARED_INITIALIZER_MIN_BYTES || elements * elementSize != initializer.bytes)
+        {
+            continue;
+        }
+
+        // The mapping is page aligned , so only the payload offset decides whether it can be used in place
+        void* weights = (void*)(mapped->Data() + initializer.offset);
+        if (initializer.offset % elementSize != 0)
+        {
+            copies.emplace_back(new int64_t[(initializer.bytes + 7) / 8]);
+            memcpy(copies.back().get() , weights , initializer.bytes);
+            weights = copies.back().get();
+            stats.copiedBytes += initializer.bytes;
+        } else
+        {
+            stats.mappedBytes += initializer.bytes;
+        }
+        names.push_back(initializer.name);
+        values.emplace_back(Ort::Value::CreateTensor(memoryInfo , weights , initializer.bytes , initializer.dims.data() , \
+            initializer.dims.size() , (ONNXTensorElementDataType)initializer.dataType));
+    }
+    stats.initializers = values.size();
+    LOG_INFO("Shared initializers : " << stats.initializers << " , " << stats.mappedBytes / (1024 * 1024) \
+        << "MB in place , " << stats.copiedBytes / (1024 * 1024) << "MB copied for alignment");
+}
+
+void SharedModel::Share(Ort::SessionOptions& options)
+{
+    {
+        std::lock_guard<std::mutex> lock(initializersMutex);
+        if (!initializersReady)
+        {
+            BuildInitializers();
+            initializersReady = true;
+        }
+    }
+    for (size_t i = 0 ; i < values.size() ; i++)
+    {
+        options.AddInitializer(names[i].c_str() , values[i]);
+    }
+    options.AddConfigEntry("session.use_env_allocators" , "1");
+}
+
+SHARED_MODEL_STATS SharedModel::GetStats()
+{
+    std::lock_guard<std::mutex> lock(initializersMutex);
+    return stats;
+}
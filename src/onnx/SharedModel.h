@@ -0,0 +1,66 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <onnxruntime_cxx_api.h>
+
+#include "MappedFile.h"
+
+typedef struct _SHARED_MODEL_STATS
+{
+    size_t initializers = 0; // Handed to every session with AddInitializer
+    size_t mappedBytes = 0; // ... used in place from the mapping
+    size_t copiedBytes = 0; // ... copied once per process , their raw_data is not element aligned
+} SHARED_MODEL_STATS;
+
+/*
+    One model file shared by every session of the process built from it.
+    1. The file is mapped and sessions are created from the mapping , so co-located processes
+       read the model through one page-cache copy instead of each reading it into private memory.
+    2. Share : the raw_data initializers are handed to every session with AddInitializer as tensors
+       over the mapping , so ORT uses them in place instead of keeping a copy per session ; one
+       PrepackedWeightsContainer lets kernels that prepack their weights do it once ; and the
+       sessions allocate from one arena registered on the env (session.use_env_allocators).
+    Weights ORT rewrites while optimizing (e.g. NCHWc reordered convolutions) become new
+    initializers owned by each session and are not shared.
+*/
+class SharedModel
+{
+private:
+    std::unique_ptr<MappedFile> mapped;
+    Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator , OrtMemTypeDefault);
+    Ort::PrepackedWeightsContainer prepacked;
+
+    // Built by the first Share call
+    std::mutex initializersMutex;
+    bool initializersReady = false;
+    std::vector<std::string> names;
+    std::vector<Ort::Value> values;
+    std::vector<std::unique_ptr<int64_t[]>> copies; // 8-byte aligned storage for misaligned raw_data
+    SHARED_MODEL_STATS stats;
+
+    void BuildInitializers();
+
+public:
+    explicit SharedModel(std::unique_ptr<MappedFile> mapped);
+
+    // One instance per model path , alive while any runner holds it ; nullptr when the file cannot be mapped
+    static std::shared_ptr<SharedModel> Acquire(const std::string& path);
+
+    // Once per process : the CPU arena every session with use_env_allocators allocates from
+    static void RegisterEnvAllocator(Ort::Env& env);
+
+    const char* Data() const { return mapped->Data(); }
+    size_t Size() const { return mapped->Size(); }
+
+    /* AddInitializer every shared weight to options and opt them into the env allocator.
+       Only for sessions of this model (or a rewrite keeping its initializer names) , and the
+       sessions must not outlive this object. */
+    void Share(Ort::SessionOptions& options);
+
+    OrtPrepackedWeightsContainer* Prepacked() const { return prepacked; }
+
+    SHARED_MODEL_STATS GetStats();
+};
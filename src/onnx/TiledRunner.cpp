@@ -0,0 +1,258 @@
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+
+#include "TiledRunner.h"
+#include "Trace.h"
+
+static std::vector<int> TileOffsets(int length , int tile , float overlap)
+{
+    std::vector<int> offsets;
+    if (length <= tile)
+    {
+        offsets.push_back(0);
+        return offsets;
+    }
+    int step = std::max(1 , (int)std::round(tile * (1.0f - std::min(std::max(overlap , 0.0f) , 0.9f))));
+    for (int offset = 0 ; offset + tile < length ; offset += step)
+    {
+        offsets.push_back(offset);
+    }
+    if (offsets.back() != length - tile)
+    {
+        offsets.push_back(length - tile);
+    }
+    return offsets;
+}
+
+std::vector<cv::Rect> TileGrid(int width , int height , cv::Size tileSize , float overlap)
+{
+    std::vector<cv::Rect> tiles;
+    int tileWidth = std::min(width , tileSize.width);
+    int tileHeight = std::min(height , tileSize.height);
+    for (int y : TileOffsets(height , tileHeight , overlap))
+    {
+        for (int x : TileOffsets(width , tileWidth , overlap))
+        {
+            tiles.emplace_back(x , y , tileWidth , tileHeight);
+        }
+    }
+    return tiles;
+}
+
+void MergeTileDetections(std::vector<DETECT_RESULT>& detections , float threshold , bool classAgnostic)
+{
+    size_t count = detections.size();
+    std::vector<int> byScore(count);
+    std::iota(byScore.begin() , byScore.end() , 0);
+    std::stable_sort(byScore.begin() , byScore.end() , [&](int a , int b)
+    {
+        return detections[a].confidence > detections[b].confidence;
+    });
+
+    // Boxes sorted by left edge : only those starting in [x - widest box , right edge) can overlap x
+    std::vector<int> byLeft(count);
+    std::iota(byLeft.begin() , byLeft.end() , 0);
+    std::sort(byLeft.begin() , byLeft.end() , [&](int a , int b)
+    {
+        return detections[a].box.x < detections[b].box.x;
+    });
+    std::vector<int> lefts(count);
+    int widest = 0;
+    for (size_t k = 0 ; k < count ; k++)
+    {
+        lefts[k] = detections[byLeft[k]].box.x;
+        widest = std::max(widest , detections[byLeft[k]].box.width);
+    }
+
+    std::vector<char> absorbed(count , 0);
+    std::vector<DETECT_RESULT> merged;
+    for (int i : byScore)
+    {
+        if (absorbed[i])
+        {
+            continue;
+        }
+        absorbed[i] = 1;
+        const cv::Rect box = detections[i].box;
+        cv::Rect grown = box;
+        size_t first = std::lower_bound(lefts.begin() , lefts.end() , box.x - widest) - lefts.begin();
+        size_t last = std::lower_bound(lefts.begin() , lefts.end() , box.x + box.width) - lefts.begin();
+        for (size_t k = first ; k < last ; k++)
+        {
+            int j = byLeft[k];
+            if (absorbed[j] || (!classAgnostic && detections[j].classId != detections[i].classId))
+            {
+                continue;
+            }
+            const cv::Rect& other = detections[j].box;
+            int smaller = std::min(box.area() , other.area());
+            if (smaller > 0 && (box & other).area() > threshold * smaller)
+            {
+                grown |= other;
+                absorbed[j] = 1;
+            }
+        }
+        DETECT_RESULT result = detections[i];
+        result.box = grown;
+        merged.emplace_back(result);
+    }
+    detections.swap(merged);
+}
+
+TiledRunner::TiledRunner(YOLOv8OnnxRunner& detector , const TILE_CONFIG& config) : detector(detector) , config(config)
+{
+    this->config.workers = std::max(1 , config.workers);
+    for (int w = 0 ; w < this->config.workers ; w++)
+    {
+        contexts.emplace_back(new REQUEST_CONTEXT());
+    }
+    // The calling thread is worker 0
+    for (int w = 1 ; w < this->config.workers ; w++)
+    {
+        threads.emplace_back(&TiledRunner::WorkerLoop , this , (size_t)w);
+    }
+}
+
+TiledRunner::~TiledRunner()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void TiledRunner::WorkerLoop(size_t worker)
+{
+    Tracer::SetThreadName("tile-" + std::to_string(worker));
+    uint64_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock , [&] { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+        }
+        RunJobs(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0)
+            {
+                done.notify_all();
+            }
+        }
+    }
+}
+
+void TiledRunner::RunJobs(size_t worker)
+{
+    REQUEST_CONTEXT& ctx = *contexts[worker];
+    for (size_t i = nextJob++ ; i < jobs->size() ; i = nextJob++)
+    {
+        TRACE_SCOPE("tile");
+        const cv::Rect& rect = (*jobs)[i];
+        (*jobResults)[i] = rect.empty() ? detector.InferenceSingleImage(*jobImage , ctx) : \
+            detector.InferenceSingleImage((*jobImage)(rect) , ctx);
+    }
+}
+
+void TiledRunner::RunParallel(const cv::Mat& srcImage , const std::vector<cv::Rect>& tiles , \
+    std::vector<std::vector<DETECT_RESULT>>& results)
+{
+    jobImage = &srcImage;
+    jobs = &tiles;
+    jobResults = &results;
+    nextJob = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = threads.size();
+        generation++;
+    }
+    wake.notify_all();
+    RunJobs(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock , [&] { return pending == 0; });
+}
+
+std::vector<DETECT_RESULT> TiledRunner::InferenceSingleImage(const cv::Mat& srcImage , TILE_STATS* stats)
+{
+    TRACE_SCOPE("tiled frame");
+    std::vector<DETECT_RESULT> detections;
+    if (srcImage.empty())
+    {
+        return detections;
+    }
+
+    std::vector<cv::Rect> tiles = TileGrid(srcImage.cols , srcImage.rows , detector.GetInputSize() , config.overlap);
+    LOG_DEBUG("Tiles : " << tiles.size() << " , image " << srcImage.cols << "x" << srcImage.rows);
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<DETECT_RESULT>> tileResults;
+    if (config.workers > 1)
+    {
+        // The full image pass is one more job , an empty rect , so it overlaps with the tiles
+        if (config.fullImagePass)
+        {
+            tiles.emplace_back();
+        }
+        tileResults.resize(tiles.size());
+        RunParallel(srcImage , tiles , tileResults);
+    } else
+    {
+        std::vector<cv::Mat> tileImages;
+        for (const auto& rect : tiles)
+        {
+            tileImages.emplace_back(srcImage(rect));
+        }
+        tileResults = detector.InferenceBatch(tileImages);
+        if (config.fullImagePass)
+        {
+            tiles.emplace_back();
+            tileResults.emplace_back(detector.InferenceSingleImage(srcImage , *contexts[0]));
+        }
+    }
+    double inferenceMs = std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_start).count();
+
+    // Back to source coordinates , the full image pass already is
+    time_start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0 ; i < tiles.size() ; i++)
+    {
+        for (auto& det : tileResults[i])
+        {
+            det.box += tiles[i].tl();
+            det.maskRect += tiles[i].tl();
+            for (auto& point : det.keyPoints)
+            {
+                point.x += tiles[i].x;
+                point.y += tiles[i].y;
+            }
+            detections.emplace_back(det);
+        }
+    }
+    size_t rawDetections = detections.size();
+    {
+        TRACE_SCOPE("merge");
+        MergeTileDetections(detections , config.mergeThreshold , config.classAgnosticMerge);
+    }
+    double mergeMs = std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_start).count();
+    LOG_DEBUG("Tile detections : " << rawDetections << " , merged : " << detections.size());
+
+    if (stats != nullptr)
+    {
+        stats->tiles = tiles.size() - (config.fullImagePass ? 1 : 0);
+        stats->rawDetections = rawDetections;
+        stats->inferenceMs = inferenceMs;
+        stats->mergeMs = mergeMs;
+    }
+    return detections;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <condition_variable>
+
+#include "YOLOv8OnnxRunner.h"
+
+typedef struct _TILE_CONFIG
+{
+    float overlap = 0.2f; // Share of a tile repeated in its neighbour , on both axes
+    bool fullImagePass = true; // Also run the whole image letterboxed to the input size , for objects larger than a tile
+    int workers = 1; // Threads running tiles on the runner , 1 feeds all tiles to InferenceBatch
+    float mergeThreshold = 0.5f; // Boxes whose intersection over the smaller one exceeds this are merged
+    bool classAgnosticMerge = false;
+} TILE_CONFIG;
+
+typedef struct _TILE_STATS
+{
+    size_t tiles = 0;
+    size_t rawDetections = 0; // Tile and full image detections before the merge
+    double inferenceMs = 0.0; // Every tile and the full image pass , wall time
+    double mergeMs = 0.0;
+} TILE_STATS;
+
+/* Tiles of tileSize covering a width x height image , neighbours share about `overlap` of a
+   tile and the last row / column is moved back flush with the border. An image smaller than
+   a tile is a single tile of the image size (the runner letterboxes it up). */
+std::vector<cv::Rect> TileGrid(int width , int height , cv::Size tileSize , float overlap);
+
+/* Greedy non-maximum merge over source coordinates. Highest score first , every lower scored
+   box of the same class whose intersection over the smaller box exceeds threshold is absorbed :
+   the kept box grows to the union and keeps its score. IoS rather than IoU , so the half of
+   an object cut by a tile seam still merges into the whole box from the neighbouring tile. */
+void MergeTileDetections(std::vector<DETECT_RESULT>& detections , float threshold , bool classAgnostic);
+
+/*
+    Sliced inference for images much larger than the network input. The source image is cut
+    into overlapping tiles of the input size , read in place through ROI headers , and run at
+    full resolution , so small objects are not shrunk away by the letterbox. Tile boxes are
+    shifted back to source coordinates , optionally joined by one low resolution pass over the
+    whole image , and merged across the seams.
+*/
+class TiledRunner
+{
+private:
+    YOLOv8OnnxRunner& detector;
+    TILE_CONFIG config;
+    // One per worker , buffers kept from image to image ; contexts[0] belongs to the calling thread
+    std::vector<std::unique_ptr<REQUEST_CONTEXT>> contexts;
+
+    // Persistent workers , woken once per image
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+
+    // Jobs of the current image , jobs[i] is a tile or the whole image for an empty rect
+    const cv::Mat* jobImage = nullptr;
+    const std::vector<cv::Rect>* jobs = nullptr;
+    std::vector<std::vector<DETECT_RESULT>>* jobResults = nullptr;
+    std::atomic<size_t> nextJob{ 0 };
+
+    void WorkerLoop(size_t worker);
+    void RunJobs(size_t worker);
+    void RunParallel(const cv::Mat& srcImage , const std::vector<cv::Rect>& tiles , \
+        std::vector<std::vector<DETECT_RESULT>>& results);
+
+public:
+    TiledRunner(YOLOv8OnnxRunner& detector , const TILE_CONFIG& config);
+    ~TiledRunner();
+    TiledRunner(const TiledRunner&) = delete;
+    TiledRunner& operator=(const TiledRunner&) = delete;
+
+    // Not thread safe , use one TiledRunner per caller thread
+    std::vector<DETECT_RESULT> InferenceSingleImage(const cv::Mat& srcImage , TILE_STATS* stats = nullptr);
+};
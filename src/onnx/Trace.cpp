@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+
+#include "Trace.h"
+
+std::atomic<int> Logger::level{ LOG_LEVEL_TRACE };
+
+int Logger::ParseLevel(const std::string& name)
+{
+    const char* names[] = { "trace" , "debug" , "info" , "warn" , "error" , "off" };
+    for (int i = LOG_LEVEL_TRACE ; i <= LOG_LEVEL_OFF ; i++)
+    {
+        if (name == names[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void Logger::Write(int value , const std::string& message)
+{
+    const char* prefixes[] = { "[TRACE] " , "[DEBUG] " , "[INFO] " , "[WARN] " , "[ERROR] : " };
+    std::string line = prefixes[std::min(std::max(value , 0) , LOG_LEVEL_ERROR)] + message + "\n";
+    // One fwrite per line : stdio locks the stream per call , so lines of different threads never interleave
+    fwrite(line.data() , 1 , line.size() , value >= LOG_LEVEL_WARN ? stderr : stdout);
+}
+
+std::atomic<bool> Tracer::enabled{ false };
+std::atomic<size_t> Tracer::bufferCapacity{ 1 << 16 };
+std::mutex Tracer::registryMutex;
+std::vector<std::shared_ptr<TraceBuffer>> Tracer::registry;
+
+TraceBuffer::TraceBuffer(uint32_t tid , size_t capacity)
+    : events(new TRACE_EVENT[capacity]) , capacity(capacity) , tid(tid)
+{
+}
+
+TraceBuffer& Tracer::ThreadBuffer()
+{
+    // The registry keeps the buffer alive after its thread exits , until the trace is written
+    static thread_local std::shared_ptr<TraceBuffer> buffer;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer = std::make_shared<TraceBuffer>((uint32_t)registry.size() + 1 , bufferCapacity.load());
+        registry.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void Tracer::SetThreadName(const std::string& name)
+{
+    // Names only matter for a trace , do not allocate a buffer for threads that never record
+    if (!IsEnabled())
+    {
+        return;
+    }
+    TraceBuffer& buffer = ThreadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.threadName = name;
+}
+
+int64_t Tracer::NowNs()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+static std::string Json_Escape(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool Tracer::WriteChromeTrace(const std::string& path)
+{
+    FILE* file = fopen(path.c_str() , "w");
+    if (file == nullptr)
+    {
+        LOG_ERROR("Failed to open trace file " << path);
+        return false;
+    }
+
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::vector<std::string> threadNames;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffers = registry;
+        for (auto& buffer : buffers)
+        {
+            threadNames.push_back(buffer->threadName);
+        }
+    }
+
+    size_t events = 0;
+    uint64_t dropped = 0;
+    bool first = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t b = 0 ; b < buffers.size() ; b++)
+    {
+        const TraceBuffer& buffer = *buffers[b];
+        std::string threadName = threadNames[b].empty() ? "thread-" + std::to_string(buffer.tid) : threadNames[b];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",\n", buffer.tid, Json_Escape(threadName).c_str());
+        first = false;
+
+        size_t count = buffer.Size();
+        for (size_t i = 0 ; i < count ; i++)
+        {
+            const TRACE_EVENT& event = buffer[i];
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"yolov8\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                event.name, buffer.tid, event.beginNs / 1000.0, event.durationNs / 1000.0);
+        }
+        events += count;
+        dropped += buffer.Dropped();
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    LOG_INFO("Trace written to " << path << " , events : " << events << " , threads : " << buffers.size() \
+        << " , dropped : " << dropped);
+    return true;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdint>
+
+/*
+    Logging : LOG_DEBUG(...) etc. take a stream expression , e.g. LOG_INFO("size : " << n).
+    Levels below YOLO_LOG_LEVEL are compiled out (the expression is never evaluated) , the
+    rest can be raised further at runtime with Logger::SetLevel. Each line is one fwrite ,
+    no per-line flush.
+*/
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+#ifndef YOLO_LOG_LEVEL
+#define YOLO_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Scoped trace spans , 0 compiles every TRACE_SCOPE out
+#ifndef YOLO_ENABLE_TRACE
+#define YOLO_ENABLE_TRACE 1
+#endif
+
+class Logger
+{
+private:
+    static std::atomic<int> level;
+
+public:
+    static void SetLevel(int value) { level.store(value , std::memory_order_relaxed); }
+
+    static int Level() { return level.load(std::memory_order_relaxed); }
+
+    static bool Enabled(int value) { return value >= level.load(std::memory_order_relaxed); }
+
+    // Accepts trace , debug , info , warn , error , off ; returns -1 otherwise
+    static int ParseLevel(const std::string& name);
+
+    static void Write(int value , const std::string& message);
+};
+
+#define YOLO_LOG(value , expr) \
+    do \
+    { \
+        if ((value) >= YOLO_LOG_LEVEL && Logger::Enabled(value)) \
+        { \
+            std::ostringstream yolo_log_stream; \
+            yolo_log_stream << expr; \
+            Logger::Write(value , yolo_log_stream.str()); \
+        } \
+    } while (0)
+
+#define LOG_TRACE(expr) YOLO_LOG(LOG_LEVEL_TRACE , expr)
+#define LOG_DEBUG(expr) YOLO_LOG(LOG_LEVEL_DEBUG , expr)
+#define LOG_INFO(expr) YOLO_LOG(LOG_LEVEL_INFO , expr)
+#define LOG_WARN(expr) YOLO_LOG(LOG_LEVEL_WARN , expr)
+#define LOG_ERROR(expr) YOLO_LOG(LOG_LEVEL_ERROR , expr)
+
+typedef struct _TRACE_EVENT
+{
+    const char* name; // String literal , never copied
+    int64_t beginNs;
+    int64_t durationNs;
+} TRACE_EVENT;
+
+/*
+    Events of one thread. Only the owning thread appends , so a push is a plain store plus a
+    release of the new count ; the exporter reads up to the acquired count without locking.
+    A full buffer drops new events and counts them.
+*/
+class TraceBuffer
+{
+private:
+    std::unique_ptr<TRACE_EVENT[]> events;
+    size_t capacity;
+    std::atomic<size_t> count{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+
+public:
+    const uint32_t tid;
+    std::string threadName; // Guarded by the Tracer registry mutex
+
+    TraceBuffer(uint32_t tid , size_t capacity);
+
+    void Push(const TRACE_EVENT& event)
+    {
+        size_t n = count.load(std::memory_order_relaxed);
+        if (n >= capacity)
+        {
+            dropped.fetch_add(1 , std::memory_order_relaxed);
+            return;
+        }
+        events[n] = event;
+        count.store(n + 1 , std::memory_order_release);
+    }
+
+    size_t Size() const { return count.load(std::memory_order_acquire); }
+
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    const TRACE_EVENT& operator[](size_t i) const { return events[i]; }
+};
+
+class Tracer
+{
+private:
+    static std::atomic<bool> enabled;
+    static std::atomic<size_t> bufferCapacity;
+    static std::mutex registryMutex;
+    static std::vector<std::shared_ptr<TraceBuffer>> registry;
+
+    // Registers the calling thread's buffer on first use
+    static TraceBuffer& ThreadBuffer();
+
+public:
+    static void Enable(bool value) { enabled.store(value , std::memory_order_relaxed); }
+
+    static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Events per thread , applies to threads that record their first event afterwards
+    static void SetBufferCapacity(size_t events) { bufferCapacity = events; }
+
+    // Label of the calling thread in the trace viewer , ignored while tracing is disabled
+    static void SetThreadName(const std::string& name);
+
+    // Monotonic ns since the first call in this process
+    static int64_t NowNs();
+
+    static void Record(const char* name , int64_t beginNs , int64_t durationNs)
+    {
+        ThreadBuffer().Push(TRACE_EVENT{ name , beginNs , durationNs });
+    }
+
+    // Chrome trace-event JSON (chrome://tracing , Perfetto) of everything recorded so far
+    static bool WriteChromeTrace(const std::string& path);
+};
+
+class TraceSpan
+{
+private:
+    const char* name;
+    int64_t beginNs;
+
+public:
+    explicit TraceSpan(const char* name) : name(Tracer::IsEnabled() ? name : nullptr) , \
+        beginNs(this->name != nullptr ? Tracer::NowNs() : 0) {}
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    ~TraceSpan()
+    {
+        if (name != nullptr)
+        {
+            Tracer::Record(name , beginNs , Tracer::NowNs() - beginNs);
+        }
+    }
+};
+
+// Enables tracing for its lifetime when path is not empty and writes the trace when it goes away
+class TraceSession
+{
+private:
+    std::string path;
+
+public:
+    explicit TraceSession(const std::string& path) : path(path) { Tracer::Enable(!path.empty()); }
+    TraceSession(const TraceSession&) = delete;
+    TraceSession& operator=(const TraceSession&) = delete;
+
+    ~TraceSession()
+    {
+        if (!path.empty())
+        {
+            Tracer::Enable(false);
+            Tracer::WriteChromeTrace(path);
+        }
+    }
+};
+
+#if YOLO_ENABLE_TRACE
+#define TRACE_CONCAT_IMPL(a , b) a##b
+#define TRACE_CONCAT(a , b) TRACE_CONCAT_IMPL(a , b)
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(trace_span_ , __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,95 @@
+#include <chrono>
+
+#include "TrackingRunner.h"
+#include "Trace.h"
+
+TrackingRunner::TrackingRunner(YOLOv8OnnxRunner& detector , const TRACKING_CONFIG& config)
+    : detector(detector) , config(config) , tracker(config.tracker)
+{
+    this->config.minInterval = std::max(1 , config.minInterval);
+    this->config.maxInterval = std::max(this->config.minInterval , config.maxInterval);
+    interval = this->config.adaptive ? this->config.minInterval : this->config.maxInterval;
+    stats.interval = interval;
+}
+
+void TrackingRunner::Reset()
+{
+    tracker.Reset();
+    interval = config.adaptive ? config.minInterval : config.maxInterval;
+    sinceKeyframe = 0;
+    stats.interval = interval;
+}
+
+void TrackingRunner::Schedule(const TRACK_UPDATE_STATS& update)
+{
+    if (!config.adaptive)
+    {
+        return;
+    }
+    // A started track has no velocity yet , it needs the next keyframe close to be confirmed
+    size_t active = std::max((size_t)1 , update.tracked + update.lost);
+    float churn = (float)(update.born + update.started + update.lost) / active;
+    if (update.predictionIoU < config.minPredictionIoU || churn > config.maxChurn || \
+        (update.tracked > 0 && update.meanScore < config.minTrackScore))
+    {
+        interval = std::max(config.minInterval , interval / 2);
+    } else if (update.predictionIoU >= config.growPredictionIoU)
+    {
+        interval = std::min(config.maxInterval , interval + 1);
+    }
+    if (update.maxSpeed > 0.0f)
+    {
+        interval = std::max(config.minInterval , std::min(interval , (int)(config.maxDrift / update.maxSpeed)));
+    }
+    LOG_DEBUG("Keyframe : tracked " << update.tracked << " , born " << update.born << " , lost " << update.lost \
+        << " , prediction IoU " << update.predictionIoU << " , next interval " << interval);
+}
+
+std::vector<DETECT_RESULT> TrackingRunner::InferenceSingleImage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx , \
+    int frameStep , bool* keyframe)
+{
+    stats.frames++;
+    sinceKeyframe += std::max(1 , frameStep);
+    bool detect = stats.keyframes == 0 || sinceKeyframe >= interval;
+    if (keyframe != nullptr)
+    {
+        *keyframe = detect;
+    }
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+    {
+        TRACE_SCOPE("track predict");
+        tracker.Predict(std::max(1 , frameStep));
+    }
+    double trackerMs = std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_start).count();
+
+    if (detect)
+    {
+        time_start = std::chrono::high_resolution_clock::now();
+        std::vector<DETECT_RESULT> detections = detector.InferenceSingleImage(srcImage , ctx);
+        auto time_detected = std::chrono::high_resolution_clock::now();
+        stats.detectorMs += std::chrono::duration<double , std::milli>(time_detected - time_start).count();
+
+        TRACK_UPDATE_STATS update;
+        {
+            TRACE_SCOPE("track update");
+            update = tracker.Update(detections);
+        }
+        Schedule(update);
+        trackerMs += std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_detected).count();
+        stats.keyframes++;
+        sinceKeyframe = 0;
+    }
+    stats.trackerMs += trackerMs;
+    stats.interval = interval;
+    return tracker.Results();
+}
+
+void TrackingRunner::PrintReport() const
+{
+    fprintf(stdout, "[TRACK] frames : %llu , keyframes : %llu (every %.2f frames) , interval now %d\n",
+        (unsigned long long)stats.frames, (unsigned long long)stats.keyframes,
+        stats.keyframes > 0 ? (double)stats.frames / stats.keyframes : 0.0, stats.interval);
+    fprintf(stdout, "[TRACK] detector per keyframe %.2fms , tracker per frame %.3fms\n",
+        stats.keyframes > 0 ? stats.detectorMs / stats.keyframes : 0.0, stats.frames > 0 ? stats.trackerMs / stats.frames : 0.0);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ByteTracker.h"
+
+typedef struct _TRACKING_CONFIG
+{
+    TRACK_CONFIG tracker;
+    int maxInterval = 5; // The detector runs at least every maxInterval frames
+    int minInterval = 1;
+    bool adaptive = true; // Otherwise every maxInterval frames
+    float minPredictionIoU = 0.6f; // Predicted vs detected boxes at a keyframe below this : halve the interval
+    float growPredictionIoU = 0.8f; // ... above this , with steady tracks : one frame more
+    float maxChurn = 0.25f; // Tracks born , started or lost at a keyframe , share of the tracked ones , above this : halve
+    float minTrackScore = 0.6f; // Mean score of the matched detections below this : halve
+    float maxDrift = 0.5f; // Distance the fastest track may move between keyframes , in box heights
+} TRACKING_CONFIG;
+
+typedef struct _TRACKING_STATS
+{
+    uint64_t frames = 0;
+    uint64_t keyframes = 0; // Detector runs
+    double detectorMs = 0.0;
+    double trackerMs = 0.0; // Predict and association , all frames
+    int interval = 1; // Current keyframe interval
+} TRACKING_STATS;
+
+/*
+    Detect every N frames : the full detector runs on keyframes only and the tracker carries
+    the boxes , with stable ids , through the frames in between. With adaptive scheduling the
+    interval follows the scene : it halves when the last keyframe showed the propagation going
+    wrong (predicted boxes far from the detections , many tracks born or lost , low scores) and
+    grows one frame at a time while the predictions hold , capped so the fastest track does not
+    move more than maxDrift box heights between two keyframes.
+
+    The detector should keep detections down to tracker.lowThreshold , the second association
+    round feeds on them ; the high threshold then plays the role of the usual confidence cut.
+*/
+class TrackingRunner
+{
+private:
+    YOLOv8OnnxRunner& detector;
+    TRACKING_CONFIG config;
+    ByteTracker tracker;
+    int interval;
+    int sinceKeyframe = 0;
+    TRACKING_STATS stats;
+
+    void Schedule(const TRACK_UPDATE_STATS& update);
+
+public:
+    TrackingRunner(YOLOv8OnnxRunner& detector , const TRACKING_CONFIG& config);
+
+    /* frameStep : frames since the last call , more than 1 when the caller dropped frames.
+       keyframe , when given , tells whether the detector ran. Not thread safe , one per stream. */
+    std::vector<DETECT_RESULT> InferenceSingleImage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx , \
+        int frameStep = 1 , bool* keyframe = nullptr);
+    void Reset();
+
+    TRACKING_STATS GetStats() const { return stats; }
+    void PrintReport() const;
+};
@@ -0,0 +1,170 @@
+#include <thread>
+
+#include "VideoStreamRunner.h"
+#include "Trace.h"
+
+VideoStreamRunner::VideoStreamRunner(YOLOv8OnnxRunner& detector , const STREAM_CONFIG& config)
+    : detector(detector) , config(config)
+{
+    this->config.ringSize = std::max(1 , config.ringSize);
+    if (config.tracking)
+    {
+        tracker.reset(new TrackingRunner(detector , config.track));
+    } else if (config.frameCache)
+    {
+        cache.reset(new CachedRunner(detector , config.cache));
+    }
+}
+
+void VideoStreamRunner::DecodeLoop(cv::VideoCapture& capture)
+{
+    Tracer::SetThreadName("capture");
+    cv::Mat frame;
+    auto time_start = std::chrono::steady_clock::now();
+    uint64_t seq = 0;
+    while (!stopRequested)
+    {
+        if (config.paceToSourceFps && sourceFps > 0.0)
+        {
+            std::this_thread::sleep_until(time_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>( \
+                std::chrono::duration<double>(seq / sourceFps)));
+        }
+        {
+            TRACE_SCOPE("capture");
+            if (!capture.read(frame) || frame.empty())
+            {
+                break;
+            }
+        }
+        seq++;
+
+        {
+            // Swap instead of copy : the displaced slot buffer is decoded into next time
+            std::lock_guard<std::mutex> lock(mutex);
+            STREAM_FRAME& slot = ring[seq % ring.size()];
+            std::swap(slot.image , frame);
+            slot.seq = seq;
+            slot.captured = std::chrono::steady_clock::now();
+            latestSeq = seq;
+            captured = seq;
+        }
+        frameReady.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    frameReady.notify_one();
+}
+
+bool VideoStreamRunner::Run(const std::string& source , const ResultCallback& onResult)
+{
+    cv::VideoCapture capture(source);
+    if (!capture.isOpened())
+    {
+        LOG_ERROR("Failed to open video " << source);
+        return false;
+    }
+    sourceFps = capture.get(cv::CAP_PROP_FPS);
+    LOG_INFO("Video : " << source << " , fps : " << sourceFps);
+
+    ring.assign(config.ringSize , STREAM_FRAME());
+    latestSeq = 0;
+    finished = false;
+    stopRequested = false;
+    captured = processed = skipped = stale = 0;
+    latency.Clear();
+    inferenceLatency.Clear();
+    if (cache)
+    {
+        cache->Reset();
+    }
+    if (tracker)
+    {
+        tracker->Reset();
+    }
+
+    std::thread decoder(&VideoStreamRunner::DecodeLoop , this , std::ref(capture));
+
+    REQUEST_CONTEXT ctx;
+    STREAM_FRAME current;
+    uint64_t lastSeq = 0;
+    uint64_t lastProcessedSeq = 0;
+    std::chrono::steady_clock::time_point firstResult , lastResult;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frameReady.wait(lock , [&] { return latestSeq > lastSeq || finished; });
+            if (latestSeq == lastSeq)
+            {
+                break;
+            }
+            STREAM_FRAME& slot = ring[latestSeq % ring.size()];
+            std::swap(current.image , slot.image);
+            current.seq = slot.seq;
+            current.captured = slot.captured;
+            skipped += latestSeq - lastSeq - 1;
+            lastSeq = latestSeq;
+        }
+
+        auto pickup = std::chrono::steady_clock::now();
+        double age = std::chrono::duration<double , std::milli>(pickup - current.captured).count();
+        if (config.latencyBudgetMs > 0.0 && age > config.latencyBudgetMs)
+        {
+            stale++;
+            continue;
+        }
+
+        // Skipped and stale frames still move the tracks , the step is in source frames
+        std::vector<DETECT_RESULT> result = tracker ? \
+            tracker->InferenceSingleImage(current.image , ctx , (int)(current.seq - lastProcessedSeq)) : \
+            cache ? cache->InferenceSingleImage(current.image , ctx) : detector.InferenceSingleImage(current.image , ctx);
+        lastProcessedSeq = current.seq;
+        auto done = std::chrono::steady_clock::now();
+        latency.Add(std::chrono::duration<double , std::milli>(done - current.captured).count());
+        inferenceLatency.Add(std::chrono::duration<double , std::milli>(done - pickup).count());
+        if (processed == 0)
+        {
+            firstResult = done;
+        }
+        lastResult = done;
+        processed++;
+
+        if (!onResult(current , result))
+        {
+            stopRequested = true;
+            break;
+        }
+    }
+
+    stopRequested = true;
+    decoder.join();
+
+    // First result carries the session warm-up , measure the rate after it
+    steadySeconds = processed > 1 ? std::chrono::duration<double>(lastResult - firstResult).count() : 0.0;
+    return true;
+}
+
+void VideoStreamRunner::PrintReport() const
+{
+    uint64_t dropped = skipped + stale;
+    fprintf(stdout, "[STREAM] frames captured : %llu , processed : %llu , skipped : %llu , stale : %llu , drop rate : %.1f%%\n",
+        (unsigned long long)captured, (unsigned long long)processed, (unsigned long long)skipped,
+        (unsigned long long)stale, captured > 0 ? 100.0 * dropped / captured : 0.0);
+    fprintf(stdout, "[STREAM] steady-state fps : %.2f (source %.2f)\n",
+        steadySeconds > 0 ? (processed - 1) / steadySeconds : 0.0, sourceFps);
+    fprintf(stdout, "[STREAM] capture->result latency ms : p50 %.2f , p90 %.2f , p99 %.2f , max %.2f\n",
+        latency.Percentile(50), latency.Percentile(90), latency.Percentile(99), latency.Max());
+    fprintf(stdout, "[STREAM] inference latency ms       : p50 %.2f , p90 %.2f , p99 %.2f , max %.2f\n",
+        inferenceLatency.Percentile(50), inferenceLatency.Percentile(90), inferenceLatency.Percentile(99), inferenceLatency.Max());
+    if (cache)
+    {
+        cache->PrintReport();
+    }
+    if (tracker)
+    {
+        tracker->PrintReport();
+    }
+}
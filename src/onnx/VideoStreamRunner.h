@@ -0,0 +1,77 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+#include "FrameCache.h"
+#include "TrackingRunner.h"
+#include "LatencyRecorder.h"
+#include "YOLOv8OnnxRunner.h"
+
+typedef struct _STREAM_CONFIG
+{
+    int ringSize = 4; // Decoded frames kept , the newest one is always the next to run
+    double latencyBudgetMs = 0.0; // Frames older than this when inference picks them up are dropped , 0 disables
+    bool paceToSourceFps = true; // Decode files at their nominal frame rate like a live stream
+    bool frameCache = false; // Reuse the last result while the scene does not change , see CachedRunner
+    FRAME_CACHE_CONFIG cache;
+    bool tracking = false; // Detector on keyframes only , tracked boxes in between ; takes precedence over frameCache
+    TRACKING_CONFIG track;
+} STREAM_CONFIG;
+
+typedef struct _STREAM_FRAME
+{
+    cv::Mat image;
+    uint64_t seq = 0; // 1-based capture order
+    std::chrono::steady_clock::time_point captured;
+} STREAM_FRAME;
+
+/*
+    Video / stream runner. A decode thread reads cv::VideoCapture into a ring of frames while
+    the calling thread runs inference on whatever frame is newest ("latest frame wins").
+    Frames overwritten before inference got to them are counted as skipped , frames that are
+    already older than the latency budget when picked up are counted as stale ; neither is
+    queued , so latency stays bounded when inference falls behind.
+*/
+class VideoStreamRunner
+{
+public:
+    // Return false to stop the stream
+    using ResultCallback = std::function<bool(const STREAM_FRAME& frame , const std::vector<DETECT_RESULT>& result)>;
+
+private:
+    YOLOv8OnnxRunner& detector;
+    STREAM_CONFIG config;
+    std::unique_ptr<CachedRunner> cache; // Only with config.frameCache
+    std::unique_ptr<TrackingRunner> tracker; // Only with config.tracking
+
+    std::mutex mutex;
+    std::condition_variable frameReady;
+    std::vector<STREAM_FRAME> ring;
+    uint64_t latestSeq = 0;
+    bool finished = false;
+    std::atomic<bool> stopRequested{ false };
+
+    // Report of the last Run
+    double sourceFps = 0.0;
+    uint64_t captured = 0;
+    uint64_t processed = 0;
+    uint64_t skipped = 0;
+    uint64_t stale = 0;
+    double steadySeconds = 0.0;
+    LatencyRecorder latency; // capture -> result , ms
+    LatencyRecorder inferenceLatency; // pick up -> result , ms
+
+    void DecodeLoop(cv::VideoCapture& capture);
+
+public:
+    VideoStreamRunner(YOLOv8OnnxRunner& detector , const STREAM_CONFIG& config);
+
+    bool Run(const std::string& source , const ResultCallback& onResult);
+
+    void PrintReport() const;
+};
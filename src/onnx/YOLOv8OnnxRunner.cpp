@@ -1,9 +1,37 @@
 #pragma once
 
+#include <cmath>
 #include <chrono>
 
 #include "Configuration.h"
 #include "YOLOv8OnnxRunner.h"
+#include "PreprocessKernel.h"
+#include "OutputDecoder.h"
+#include "Trace.h"
+#include "ModelCache.h"
+#include "GraphPreprocess.h"
+#include "HostProfile.h"
+
+// Letterbox border colour (BGR) , shared by the reference and the fused preprocess
+static const uchar LETTERBOX_PAD[3] = { 114 , 114 , 144 };
+// Largest stride of the detect head , rect mode tensors are a multiple of it
+static const int RECT_STRIDE = 32;
+
+static double ElapsedMs(const std::chrono::high_resolution_clock::time_point& time_start)
+{
+    return std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_start).count();
+}
+
+// size x type view into buffer , which is only reallocated when it is too small or of another type.
+// Writing into the view (cv::resize , cv::cvtColor) then reuses the memory for frames of any size.
+static cv::Mat ScratchView(cv::Mat& buffer , cv::Size size , int type)
+{
+    if (buffer.type() != type || buffer.cols < size.width || buffer.rows < size.height)
+    {
+        buffer.create(std::max(buffer.rows , size.height) , std::max(buffer.cols , size.width) , type);
+    }
+    return buffer(cv::Rect(0 , 0 , size.width , size.height));
+}
 
 YOLOv8OnnxRunner::YOLOv8OnnxRunner(Configuration cfg)
 {
@@ -11,16 +39,26 @@ YOLOv8OnnxRunner::YOLOv8OnnxRunner(Configuration cfg)
     {
         this->confThreshold = cfg.confThreshold;
         this->iouThreshold = cfg.iouThreshold;
+        this->nmsConfig.topK = cfg.nmsTopK;
+        this->nmsConfig.maxDet = cfg.maxDet;
+        this->nmsConfig.classAgnostic = cfg.agnosticNMS;
+        this->nmsConfig.softNMS = cfg.softNMS;
+        this->nmsConfig.softSigma = cfg.softNMSSigma;
         InitOrtEnv(cfg);
     }
     catch(const std::exception& e)
     {
-        std::cerr << "[ERROR] : " << e.what() << '\n';
+        LOG_ERROR(e.what());
     }
 }
 
 YOLOv8OnnxRunner::~YOLOv8OnnxRunner()
 {
+    // Builders use the env , options and model of this runner
+    for (auto& builder : this->shapeBuilders)
+    {
+        builder.join();
+    }
     delete session;
 }
 
@@ -39,12 +77,11 @@ void YOLOv8OnnxRunner::Softmax()
 
 }
 
-void YOLOv8OnnxRunner::Normalize(cv::Mat image)
+void YOLOv8OnnxRunner::Normalize(const cv::Mat& image , float* blob)
 {
     int imageWidth = image.cols;
     int imageHeight = image.rows;
     int imageChannel = image.channels();
-    this->input_image.resize(imageWidth * imageHeight * imageChannel);
 
     for (int c = 0 ; c < imageChannel ; c++)
     {
@@ -52,20 +89,42 @@ void YOLOv8OnnxRunner::Normalize(cv::Mat image)
         {
             for (int w = 0 ; w < imageWidth ; w++)
             {
-                this->input_image[c * imageWidth * imageHeight + h * imageWidth + w] = \
+                blob[c * imageWidth * imageHeight + h * imageWidth + w] = \
                     image.at<cv::Vec3b>(h , w)[c] / 255.0f;
             }
         }
     }
 }
 
-void YOLOv8OnnxRunner::NonMaximumSuppression()
+void YOLOv8OnnxRunner::NonMaximumSuppression(const NMS_BOXES& boxes , std::vector<int>& keep , std::vector<float>& keepScores , \
+    NMSEngine& engine)
 {
+    NMS_CONFIG config = this->nmsConfig;
+    config.iouThreshold = this->iouThreshold.load();
+    engine.Run(boxes , config , keep , &keepScores);
 }
 
 void YOLOv8OnnxRunner::InitOrtEnv(Configuration cfg)
 {
     env = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "YOLOv8Model");
+
+	session_options = Ort::SessionOptions();
+	session_options.SetInterOpNumThreads(cfg.num_thread);
+    if (cfg.intraThreads > 0)
+    {
+        session_options.SetIntraOpNumThreads(cfg.intraThreads);
+    }
+    session_options.SetExecutionMode(cfg.parallelExecution ? ExecutionMode::ORT_PARALLEL : ExecutionMode::ORT_SEQUENTIAL);
+    session_options.AddConfigEntry("session.intra_op.allow_spinning" , cfg.allowSpinning ? "1" : "0");
+    session_options.AddConfigEntry("session.inter_op.allow_spinning" , cfg.allowSpinning ? "1" : "0");
+    std::string affinities = IntraOpAffinities(GetHostTopology() , cfg.threadAffinity , cfg.intraThreads , cfg.sessionSlot);
+    if (!affinities.empty())
+    {
+        session_options.AddConfigEntry("session.intra_op_thread_affinities" , affinities.c_str());
+        LOG_INFO("Intra-op thread affinities : " << affinities);
+    }
+	session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+    // Appended to the options the sessions are created with , not to a copy that is reset afterwards
     if (cfg.cudaEnable)
     {
         OrtCUDAProviderOptions cudaOption;
@@ -73,12 +132,39 @@ void YOLOv8OnnxRunner::InitOrtEnv(Configuration cfg)
         session_options.AppendExecutionProvider_CUDA(cudaOption);
     }
 
-	session_options = Ort::SessionOptions();
-	session_options.SetInterOpNumThreads(cfg.num_thread);
-	session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-
-    std::wstring model_path = std::wstring(cfg.ModelPath.begin() , cfg.ModelPath.end());
-    session = new Ort::Session(env , model_path.c_str() , session_options);
+    auto time_start = std::chrono::high_resolution_clock::now();
+    this->modelPath = cfg.ModelPath;
+    if (cfg.mmapModel || cfg.shareWeights)
+    {
+        this->sharedModel = SharedModel::Acquire(cfg.ModelPath);
+        this->shareWeights = cfg.shareWeights && this->sharedModel != nullptr;
+        if (this->shareWeights)
+        {
+            SharedModel::RegisterEnvAllocator(env);
+        }
+    }
+    // In-graph preprocessing : the rewritten model only exists in memory , sessions are built from its bytes
+    if (cfg.rawInput)
+    {
+        std::string original , error = "cannot read " + cfg.ModelPath;
+        if (ReadModelFile(cfg.ModelPath , original) && AddInGraphPreprocess(original , this->modelBytes , error))
+        {
+            this->rawInput = true;
+        } else
+        {
+            this->modelBytes.clear();
+            LOG_WARN("In-graph preprocessing disabled : " << error);
+        }
+    }
+    if (cfg.modelCache)
+    {
+        session = CreateCachedSession(cfg);
+    }
+    if (session == nullptr)
+    {
+        session = NewSession(session_options);
+    }
+    this->startupTimes.sessionMs = ElapsedMs(time_start);
 
     Ort::AllocatorWithDefaultOptions allocator;
     size_t inputNodesNum = session->GetInputCount();
@@ -89,12 +175,12 @@ void YOLOv8OnnxRunner::InitOrtEnv(Configuration cfg)
         inputNodeNames.push_back(temp_buf);
         inputNodeDims.push_back(session->GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape());
     }
-    std::cout << "[INFO] InputNodeNum : " << inputNodesNum << " InputNodeName : ";
+    std::string inputNames;
     for (int idx = 0 ; idx < inputNodeNames.size() ; idx++)
     {
-        std::cout << inputNodeNames[idx] << " ";
+        inputNames += std::string(inputNodeNames[idx]) + " ";
     }
-    std::cout << std::endl;
+    LOG_INFO("InputNodeNum : " << inputNodesNum << " InputNodeName : " << inputNames);
 
     size_t OutputNodesNum = session->GetOutputCount();
     for (size_t i = 0; i < OutputNodesNum; i++)
@@ -104,25 +190,497 @@ void YOLOv8OnnxRunner::InitOrtEnv(Configuration cfg)
         outputNodeNames.push_back(temp_buf);
         outputNodeDims.push_back(session->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape());
     }
-    std::cout << "[INFO] OutputNodesNum : " << OutputNodesNum << " OutputNodeName : ";
+    std::string outputNames;
     for (int idx = 0 ; idx < outputNodeNames.size() ; idx++)
     {
-        std::cout << outputNodeNames[idx] << " ";
+        outputNames += std::string(outputNodeNames[idx]) + " ";
     }
-    std::cout << std::endl;
+    LOG_INFO("OutputNodesNum : " << OutputNodesNum << " OutputNodeName : " << outputNames);
 
-    this->input_width = inputNodeDims[0][2];
-    this->input_height = inputNodeDims[0][3];
+    // [N , 3 , H , W] , or [N , H , W , 3] for the raw input
+    int heightAxis = this->rawInput ? 1 : 2;
+    int widthAxis = heightAxis + 1;
+    // Dynamic axes are exported as -1 , keep the default 640x640 for them
+    bool dynamicShape = inputNodeDims[0][heightAxis] <= 0 || inputNodeDims[0][widthAxis] <= 0;
+    if (!dynamicShape)
+    {
+        this->input_height = (int)inputNodeDims[0][heightAxis];
+        this->input_width = (int)inputNodeDims[0][widthAxis];
+    }
+    if (this->rawInput)
+    {
+        LOG_INFO("In-graph preprocessing : input is the letterboxed uint8 NHWC frame");
+    }
+    LOG_INFO("Model input size : " << this->input_width << "x" << this->input_height << (dynamicShape ? " (dynamic)" : ""));
 
-    std::cout << "[INFO] Build Session successfully." << std::endl;
+    if (cfg.rectInput)
+    {
+        if (dynamicShape)
+        {
+            this->rectEnable = true;
+            LOG_INFO("Rect mode : frames padded to the next multiple of " << RECT_STRIDE);
+        } else
+        {
+            LOG_WARN("Rect mode needs a model exported with dynamic height / width , disabled");
+        }
+    }
+    if (this->rectEnable && cfg.shapeSessions > 0)
+    {
+        // Names of the symbolic axes , the TypeInfo owns the strings
+        Ort::TypeInfo typeInfo = session->GetInputTypeInfo(0);
+        auto shapeInfo = typeInfo.GetTensorTypeAndShapeInfo();
+        std::vector<const char*> symbolic = shapeInfo.GetSymbolicDimensions();
+        if (symbolic.size() == inputNodeDims[0].size() && symbolic[heightAxis][0] != '\0' && symbolic[widthAxis][0] != '\0')
+        {
+            this->heightDimName = symbolic[heightAxis];
+            this->widthDimName = symbolic[widthAxis];
+            this->shapeSessionLimit = cfg.shapeSessions;
+            LOG_INFO("Per-shape sessions : up to " << this->shapeSessionLimit << " , axes " << this->heightDimName \
+                << " / " << this->widthDimName);
+        } else
+        {
+            LOG_WARN("Per-shape sessions need named height / width axes , every shape runs on the dynamic session");
+        }
+    }
+    if (this->shapeSessionLimit <= 0)
+    {
+        std::string().swap(this->modelBytes);
+    }
+    // Head layout : ultralytics exports name the task and the keypoint shape in the metadata ,
+    // others are told apart by their outputs (a 4-D prototype output , the 56-channel COCO pose head)
+    std::string taskName;
+    int keypointShape[2] = { 17 , 3 };
+    {
+        Ort::ModelMetadata metadata = session->GetModelMetadata();
+        auto taskValue = metadata.LookupCustomMetadataMapAllocated("task" , allocator);
+        auto keypointValue = metadata.LookupCustomMetadataMapAllocated("kpt_shape" , allocator);
+        if (taskValue.get() != nullptr)
+        {
+            taskName = taskValue.get();
+        }
+        if (keypointValue.get() != nullptr)
+        {
+            sscanf(keypointValue.get() , "[%d,%d]" , &keypointShape[0] , &keypointShape[1]);
+        }
+    }
+    int outputChannels = outputNodeDims[0].size() == 3 ? (int)outputNodeDims[0][1] : 0;
+    if (outputNodeDims.size() > 1 && outputNodeDims[1].size() == 4 && outputNodeDims[1][1] > 0 && \
+        (taskName.empty() || taskName == "segment"))
+    {
+        this->task = TASK_SEGMENT;
+        this->num_masks = (int)outputNodeDims[1][1];
+    } else if ((taskName == "pose" || (taskName.empty() && outputChannels == 4 + 1 + 17 * 3)) && \
+        keypointShape[0] > 0 && (keypointShape[1] == 2 || keypointShape[1] == 3))
+    {
+        this->task = TASK_POSE;
+        this->num_keypoints = keypointShape[0];
+        this->keypoint_dims = keypointShape[1];
+    }
+    // output0 : [batch , 4 + num_classes + num_masks (segment) or num_keypoints * keypoint_dims (pose) , num_anchors]
+    int headChannels = 4 + this->num_masks + this->num_keypoints * this->keypoint_dims;
+    if (outputChannels > headChannels)
+    {
+        this->num_classes = outputChannels - headChannels;
+    }
+    static const char* TASK_NAMES[] = { "detect" , "segment" , "pose" };
+    LOG_INFO("Model task : " << TASK_NAMES[this->task] << (this->num_masks > 0 ? " , mask channels : " + \
+        std::to_string(this->num_masks) : "") << (this->num_keypoints > 0 ? " , keypoints : " + \
+        std::to_string(this->num_keypoints) + "x" + std::to_string(this->keypoint_dims) : ""));
+    LOG_INFO("Model num classes : " << this->num_classes);
+    LOG_INFO("Model batch size : " << (GetModelBatchSize() > 0 ? std::to_string(GetModelBatchSize()) : "dynamic"));
+
+    // Static INT8 (QDQ) models keep a float input unless its QuantizeLinear was folded away ,
+    // then the scale / zero point are stored in the model metadata by tools/quantize_int8.py.
+    // The raw uint8 input of in-graph preprocessing is not quantized , inputType stays float for it.
+    if (!this->rawInput)
+    {
+        this->inputType = session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetElementType();
+    }
+    if (this->inputType == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 || this->inputType == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8)
+    {
+        bool isSigned = this->inputType == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8;
+        this->inputZeroPoint = isSigned ? -128 : 0;
+        Ort::ModelMetadata metadata = session->GetModelMetadata();
+        auto scale = metadata.LookupCustomMetadataMapAllocated("input_scale" , allocator);
+        auto zeroPoint = metadata.LookupCustomMetadataMapAllocated("input_zero_point" , allocator);
+        if (scale.get() != nullptr)
+        {
+            this->inputScale = std::stof(scale.get());
+        }
+        if (zeroPoint.get() != nullptr)
+        {
+            this->inputZeroPoint = std::stoi(zeroPoint.get());
+        }
+        LOG_INFO("Quantized input : " << (isSigned ? "int8" : "uint8") << " , scale : " << this->inputScale \
+            << " , zero point : " << this->inputZeroPoint);
+    } else if (this->inputType != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
+    {
+        LOG_ERROR("Unsupported input element type " << this->inputType << " , expected float , uint8 or int8");
+    }
+    if (session->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
+    {
+        LOG_ERROR("Output0 is not float , keep the final DequantizeLinear when quantizing the model");
+    }
+
+    this->ioBindingEnable = cfg.ioBinding;
+    if (this->ioBindingEnable)
+    {
+        BindContext(this->boundContext);
+        LOG_INFO("IoBinding enabled , input and output buffers preallocated.");
+    }
+
+    if (cfg.warmupRuns > 0)
+    {
+        Warmup(cfg.warmupRuns);
+    }
+
+    LOG_INFO("Build Session successfully. session : " << this->startupTimes.sessionMs << "ms" \
+        << (this->startupTimes.cacheHit ? " (cached)" : "") << " , warm-up : " << this->startupTimes.warmupMs << "ms");
 }
 
+Ort::Session* YOLOv8OnnxRunner::NewSession(const Ort::SessionOptions& sessionOptions , bool share)
+{
+    const void* modelData = nullptr;
+    size_t modelSize = 0;
+    if (!this->modelBytes.empty())
+    {
+        modelData = this->modelBytes.data();
+        modelSize = this->modelBytes.size();
+    } else if (this->sharedModel)
+    {
+        modelData = this->sharedModel->Data();
+        modelSize = this->sharedModel->Size();
+    }
 
-void YOLOv8OnnxRunner::Preprocess(cv::Mat srcImage , cv::Mat& processImage , float* pad_left , float* pad_top)
-{   
-    std::cout << "[INFO] PreProcess Image ..." << std::endl;
-    int src_width = srcImage.cols , src_height = srcImage.rows;
-    std::cout << "[INFO] Image width : " << src_width << " , hegiht : " << src_height << std::endl;
+    if (this->shareWeights && share)
+    {
+        // The rewritten raw input model keeps the original initializer names , so the mapped weights fit it too
+        Ort::SessionOptions sharedOptions = sessionOptions.Clone();
+        this->sharedModel->Share(sharedOptions);
+        return new Ort::Session(env , modelData , modelSize , sharedOptions , this->sharedModel->Prepacked());
+    }
+    if (modelData != nullptr)
+    {
+        return new Ort::Session(env , modelData , modelSize , sessionOptions);
+    }
+    std::wstring model_path = std::wstring(this->modelPath.begin() , this->modelPath.end());
+    return new Ort::Session(env , model_path.c_str() , sessionOptions);
+}
+
+Ort::Session* YOLOv8OnnxRunner::SessionFor(const cv::Size& shape)
+{
+    if (this->shapeSessionLimit <= 0)
+    {
+        return this->session;
+    }
+    auto key = std::make_pair(shape.width , shape.height);
+    {
+        // Every frame looks its session up , concurrent requests only share this lock
+        std::shared_lock<std::shared_mutex> lock(this->shapeSessionsMutex);
+        auto found = this->shapeSessions.find(key);
+        if (found != this->shapeSessions.end())
+        {
+            return found->second ? found->second.get() : this->session;
+        }
+    }
+
+    // First sight of the shape : the entry answers every later lookup under the shared lock
+    std::unique_lock<std::shared_mutex> lock(this->shapeSessionsMutex);
+    auto found = this->shapeSessions.find(key);
+    if (found != this->shapeSessions.end())
+    {
+        return found->second ? found->second.get() : this->session;
+    }
+    this->shapeSessions[key].reset();
+    if (this->shapeSessionBuilds >= this->shapeSessionLimit)
+    {
+        LOG_DEBUG("Per-shape session limit reached , " << shape.width << "x" << shape.height << " runs on the dynamic session");
+        return this->session;
+    }
+    // Graph optimization takes seconds , no caller waits for it
+    this->shapeSessionBuilds++;
+    this->shapeBuilders.emplace_back(&YOLOv8OnnxRunner::BuildShapeSession , this , shape);
+    return this->session;
+}
+
+void YOLOv8OnnxRunner::BuildShapeSession(cv::Size shape)
+{
+    Ort::Session* created = nullptr;
+    try
+    {
+        auto time_start = std::chrono::high_resolution_clock::now();
+        Ort::SessionOptions shapeOptions = session_options.Clone();
+        Ort::ThrowOnError(Ort::GetApi().AddFreeDimensionOverrideByName(shapeOptions , this->heightDimName.c_str() , shape.height));
+        Ort::ThrowOnError(Ort::GetApi().AddFreeDimensionOverrideByName(shapeOptions , this->widthDimName.c_str() , shape.width));
+        created = NewSession(shapeOptions);
+        LOG_INFO("Session for " << shape.width << "x" << shape.height << " created in " << ElapsedMs(time_start) << "ms");
+    }
+    catch(const std::exception& e)
+    {
+        // The null entry stays , the shape keeps running on the dynamic session
+        LOG_WARN("Per-shape session " << shape.width << "x" << shape.height << " failed , using the dynamic session : " << e.what());
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(this->shapeSessionsMutex);
+    this->shapeSessions[std::make_pair(shape.width , shape.height)].reset(created);
+}
+
+Ort::Session* YOLOv8OnnxRunner::CreateCachedSession(const Configuration& cfg)
+{
+    std::filesystem::path cachePath = OptimizedModelCachePath(cfg);
+    if (cachePath.empty())
+    {
+        LOG_WARN("Model cache disabled , cannot read " << cfg.ModelPath);
+        return nullptr;
+    }
+
+    std::error_code error;
+    bool written = false;
+    if (!std::filesystem::exists(cachePath , error))
+    {
+        try
+        {
+            /* Serialized at the extended level : the layout transforms of ORT_ENABLE_ALL depend on the
+               CPU (NCHWc block size with AVX2 or AVX-512) , and workers of different instance types may
+               share one model volume. Under a private name and published with a rename , so a
+               concurrently starting worker never loads a half written file. */
+            std::filesystem::path tempPath = cachePath;
+            tempPath += ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+            Ort::SessionOptions writeOptions = session_options.Clone();
+            writeOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+            writeOptions.SetOptimizedModelFilePath(tempPath.wstring().c_str());
+            // Only built to write the file and never run : no prepacked weights , no thread pool
+            writeOptions.SetIntraOpNumThreads(1);
+            writeOptions.AddConfigEntry("session.disable_prepacking" , "1");
+
+            // The initializers must land in the file , not stay external tensors over the original mapping
+            delete NewSession(writeOptions , false);
+            std::filesystem::rename(tempPath , cachePath , error);
+            if (error)
+            {
+                LOG_WARN("Could not publish model cache " << cachePath.string() << " : " << error.message());
+                std::filesystem::remove(tempPath , error);
+                return nullptr;
+            }
+            written = true;
+            LOG_INFO("Optimized model cached to " << cachePath.string());
+        }
+        catch(const std::exception& e)
+        {
+            LOG_WARN("Model cache write failed : " << e.what());
+            return nullptr;
+        }
+    }
+
+    /* From here on the cache file is the model , for this session and the per-shape ones : mapped
+       and its weights shared exactly like the original with --mmap-model / --share-weights */
+    std::string originalPath = this->modelPath;
+    std::string originalBytes;
+    originalBytes.swap(this->modelBytes);
+    std::shared_ptr<SharedModel> originalModel = this->sharedModel;
+    bool originalShare = this->shareWeights;
+    try
+    {
+        this->modelPath = cachePath.string();
+        if (originalModel)
+        {
+            this->sharedModel = SharedModel::Acquire(this->modelPath);
+            this->shareWeights = originalShare && this->sharedModel != nullptr;
+        }
+        // Basic and extended rewrites are already in the file , only the layout transforms for this host run again
+        Ort::Session* cached = NewSession(session_options);
+        this->startupTimes.cacheHit = !written;
+        LOG_INFO("Optimized model loaded from cache " << cachePath.string() << (this->sharedModel ? " (mapped)" : ""));
+        return cached;
+    }
+    catch(const std::exception& e)
+    {
+        LOG_WARN("Discarding unreadable model cache " << cachePath.string() << " : " << e.what());
+        this->sharedModel.reset();
+        std::filesystem::remove(cachePath , error);
+    }
+    this->modelPath = originalPath;
+    this->modelBytes.swap(originalBytes);
+    this->sharedModel = originalModel;
+    this->shareWeights = originalShare;
+    return nullptr;
+}
+
+void YOLOv8OnnxRunner::Warmup(int runs)
+{
+    auto time_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0 ; i < runs ; i++)
+    {
+        auto run_start = std::chrono::high_resolution_clock::now();
+        if (this->ioBindingEnable)
+        {
+            // Warm the bound buffers the first requests will use
+            std::lock_guard<std::mutex> lock(this->boundContextMutex);
+            if (this->rawInput)
+            {
+                this->boundContext.letterboxImage.setTo(cv::Scalar::all(LETTERBOX_PAD[0]));
+            } else
+            {
+                std::fill(this->boundContext.input_image.begin() , this->boundContext.input_image.end() , LETTERBOX_PAD[0] / 255.0f);
+            }
+            Inference(this->boundContext);
+        } else
+        {
+            int64_t batchSize = std::max<int64_t>(1 , GetModelBatchSize());
+            size_t inputSize = (size_t)batchSize * 3 * this->input_width * this->input_height;
+            if (this->rawInput)
+            {
+                std::vector<uint8_t> pixels(inputSize , LETTERBOX_PAD[0]);
+                InferenceBatchTensor(pixels.data() , batchSize , GetInputSize());
+            } else
+            {
+                std::vector<float> blob(inputSize , LETTERBOX_PAD[0] / 255.0f);
+                InferenceBatchTensor(blob.data() , batchSize , GetInputSize());
+            }
+        }
+        if (i == 0)
+        {
+            this->startupTimes.firstRunMs = ElapsedMs(run_start);
+        }
+    }
+    this->startupTimes.warmupMs = ElapsedMs(time_start);
+}
+
+bool YOLOv8OnnxRunner::IsBound(const REQUEST_CONTEXT& ctx)
+{
+    return this->ioBindingEnable && ctx.boundSession != nullptr && ctx.boundShape == ctx.inputShape;
+}
+
+void YOLOv8OnnxRunner::BindContext(REQUEST_CONTEXT& ctx)
+{
+    if (ctx.inputShape.area() == 0)
+    {
+        ctx.inputShape = GetInputSize();
+    }
+    // Once per frame : a per-shape session that became ready since the last frame takes over here
+    Ort::Session* runSession = SessionFor(ctx.inputShape);
+    if (IsBound(ctx) && ctx.boundSession == runSession)
+    {
+        return;
+    }
+    cv::Size shape = ctx.inputShape;
+
+    // resize / create , not assign : a frame may already have been preprocessed into the buffer
+    if (this->rawInput)
+    {
+        ctx.letterboxImage.create(shape.height , shape.width , CV_8UC3);
+        ctx.boundInput = CreateRawInputTensor(ctx.letterboxImage.data , 1 , shape);
+    } else
+    {
+        ctx.input_image.resize((size_t)3 * shape.height * shape.width);
+        ctx.boundInput = CreateInputTensor(ctx.input_image.data() , 1 , shape , ctx.quant_input);
+    }
+
+    // Output shapes from outputNodeDims , dynamic axes are resolved by one probe run
+    std::vector<std::vector<int64_t>> outputDims = this->outputNodeDims;
+    bool dynamicOutput = false;
+    for (auto& dims : outputDims)
+    {
+        dims[0] = 1;
+        for (auto dim : dims)
+        {
+            dynamicOutput = dynamicOutput || dim <= 0;
+        }
+    }
+    if (dynamicOutput)
+    {
+        auto probe = runSession->Run(options , inputNodeNames.data() , &ctx.boundInput , 1 , \
+            outputNodeNames.data() , outputNodeNames.size());
+        for (size_t i = 0 ; i < probe.size() ; i++)
+        {
+            outputDims[i] = probe[i].GetTensorTypeAndShapeInfo().GetShape();
+        }
+    }
+
+    ctx.ioBinding.reset(new Ort::IoBinding(*runSession));
+    ctx.ioBinding->BindInput(inputNodeNames[0] , ctx.boundInput);
+    ctx.boundOutputs.clear();
+    ctx.boundOutputDims = outputDims;
+    ctx.outputBuffers.resize(outputDims.size());
+    for (size_t i = 0 ; i < outputDims.size() ; i++)
+    {
+        size_t elements = 1;
+        for (auto dim : outputDims[i])
+        {
+            elements *= (size_t)dim;
+        }
+        ctx.outputBuffers[i].resize(elements);
+        ctx.boundOutputs.emplace_back(Ort::Value::CreateTensor<float>(memory_info_handler , ctx.outputBuffers[i].data() , \
+            elements , outputDims[i].data() , outputDims[i].size()));
+        ctx.ioBinding->BindOutput(outputNodeNames[i] , ctx.boundOutputs.back());
+        this->tensorAllocationCount++;
+    }
+    ctx.boundSession = runSession;
+    ctx.boundShape = shape;
+}
+
+RUNNER_COUNTERS YOLOv8OnnxRunner::GetCounters() const
+{
+    RUNNER_COUNTERS counters;
+    counters.runs = this->runCount.load();
+    counters.boundRuns = this->boundRunCount.load();
+    counters.tensorAllocations = this->tensorAllocationCount.load();
+    return counters;
+}
+
+
+int64_t YOLOv8OnnxRunner::GetModelBatchSize() const
+{
+    if (inputNodeDims.empty() || inputNodeDims[0].empty())
+    {
+        return 1;
+    }
+    return inputNodeDims[0][0] > 0 ? inputNodeDims[0][0] : 0;
+}
+
+cv::Size YOLOv8OnnxRunner::InputShapeFor(int src_width , int src_height) const
+{
+    if (!this->rectEnable || src_width <= 0 || src_height <= 0)
+    {
+        return GetInputSize();
+    }
+    // Same rounding as LetterboxGeometry , then only up to the next stride multiple
+    float scale = std::min((float)this->input_width / (float)src_width , (float)this->input_height / (float)src_height);
+    int width = (int)std::round((float)src_width * scale);
+    int height = (int)std::round((float)src_height * scale);
+    width = std::min(this->input_width , (width + RECT_STRIDE - 1) / RECT_STRIDE * RECT_STRIDE);
+    height = std::min(this->input_height , (height + RECT_STRIDE - 1) / RECT_STRIDE * RECT_STRIDE);
+    return cv::Size(width , height);
+}
+
+void YOLOv8OnnxRunner::LetterboxGeometry(int src_width , int src_height , cv::Size canvas , LETTERBOX_INFO& info , \
+    cv::Size& resizeSize , int border[4])
+{
+    LOG_DEBUG("Image width : " << src_width << " , hegiht : " << src_height);
+    info.scale = std::min((float)this->input_width / (float)src_width , 
+        (float)this->input_height / (float)src_height);
+    LOG_DEBUG("Set resizeScales : " << info.scale);
+    int new_un_pad[2] = { (int)std::round((float)src_width * info.scale) , \
+                            (int)std::round((float)src_height * info.scale) };
+    resizeSize = cv::Size(new_un_pad[0] , new_un_pad[1]);
+
+    auto dw = (float)(canvas.width - new_un_pad[0]);
+	auto dh = (float)(canvas.height - new_un_pad[1]);
+    dw /= 2.0f;
+	dh /= 2.0f;
+    LOG_DEBUG("dw : " << dw << " dh : " << dh);
+
+    border[0] = int(std::round(dh - 0.1f)); // top
+	border[1] = int(std::round(dh + 0.1f)); // bottom
+	border[2] = int(std::round(dw - 0.1f)); // left
+	border[3] = int(std::round(dw + 0.1f)); // right
+
+    info.pad_left = border[2];
+    info.pad_top = border[0];
+}
+
+void YOLOv8OnnxRunner::Letterbox(const cv::Mat& srcImage , cv::Mat& processImage , LETTERBOX_INFO& info)
+{
     if (srcImage.channels() == 3)
     {
         processImage = srcImage.clone();
@@ -132,145 +690,499 @@ void YOLOv8OnnxRunner::Preprocess(cv::Mat srcImage , cv::Mat& processImage , flo
         cv::cvtColor(srcImage , processImage , cv::COLOR_GRAY2RGB);
     }
 
-    this->resizeScales = std::min((float)this->input_width / (float)src_width , 
-        (float)this->input_height / (float)src_height);
-    std::cout << "[INFO] Set resizeScales : " << this->resizeScales << std::endl;
-    int new_un_pad[2] = { (int)std::round((float)src_width * this->resizeScales) , \
-                            (int)std::round((float)src_height * this->resizeScales) };
-    // std::cout << new_un_pad[0] << " " << new_un_pad[1] << std::endl;
-
-    auto dw = (float)(this->input_width - new_un_pad[0]);
-	auto dh = (float)(this->input_height - new_un_pad[1]);
-    dw /= 2.0f;
-	dh /= 2.0f;
-    std::cout << "[INFO] dw : " << dw << " dh : " << dh << std::endl;
+    cv::Size resizeSize;
+    int border[4];
+    LetterboxGeometry(srcImage.cols , srcImage.rows , InputShapeFor(srcImage.cols , srcImage.rows) , info , resizeSize , border);
 
-    if (src_width != new_un_pad[0] && src_height != new_un_pad[1])
+    // Either side differing is enough , otherwise the padded image would not match the tensor slice
+    if (srcImage.cols != resizeSize.width || srcImage.rows != resizeSize.height)
 	{
-		cv::resize(processImage, processImage, cv::Size(new_un_pad[0], new_un_pad[1]));
-        std::cout << "[INFO] resizeImage width : " << processImage.cols << ", resizeImage height : " << processImage.rows << std::endl;
+		cv::resize(processImage, processImage, resizeSize);
+        LOG_DEBUG("resizeImage width : " << processImage.cols << ", resizeImage height : " << processImage.rows);
 	}
 
-    int top = int(std::round(dh - 0.1f));
-	int bottom = int(std::round(dh + 0.1f));
-	int left = int(std::round(dw - 0.1f));
-	int right = int(std::round(dw + 0.1f));
+	cv::copyMakeBorder(processImage, processImage, border[0], border[1], border[2], border[3], cv::BORDER_CONSTANT, \
+        cv::Scalar(LETTERBOX_PAD[0] , LETTERBOX_PAD[1] , LETTERBOX_PAD[2]));
+    // cv::imshow("processImage" , processImage);
+}
+
+void YOLOv8OnnxRunner::PreprocessToBlob(const cv::Mat& srcImage , float* blob , cv::Size canvas , LETTERBOX_INFO& info , \
+    REQUEST_CONTEXT& ctx)
+{
+    // No clone and no padded copy : resize into a reused scratch Mat (or not at all) and let the
+    // kernel pad , scale and transpose straight into the tensor buffer
+    cv::Mat image = srcImage;
+    if (srcImage.channels() != 3)
+    {
+        image = ScratchView(ctx.colorImage , srcImage.size() , CV_8UC3);
+        cv::cvtColor(srcImage , image , cv::COLOR_GRAY2RGB);
+    }
 
-    *pad_left = left;
-    *pad_top = top;
+    cv::Size resizeSize;
+    int border[4];
+    LetterboxGeometry(srcImage.cols , srcImage.rows , canvas , info , resizeSize , border);
 
-	cv::copyMakeBorder(processImage, processImage, top, bottom, left, right, cv::BORDER_CONSTANT, cv::Scalar(114,114,144));
-    // cv::imshow("processImage" , processImage);
-    Normalize(processImage);
+    if (image.cols != resizeSize.width || image.rows != resizeSize.height)
+    {
+        cv::Mat resized = ScratchView(ctx.resizeImage , resizeSize , CV_8UC3);
+        cv::resize(image , resized , resizeSize);
+        image = resized;
+    }
 
-    std::cout << "[INFO] processImage width : " << processImage.cols << ", processImage height : " << processImage.rows << std::endl;
+    PackLetterboxToBlob(image , blob , canvas.width , canvas.height , border[2] , border[0] , LETTERBOX_PAD);
 }
 
-void YOLOv8OnnxRunner::Inference(float*& result)
+void YOLOv8OnnxRunner::PreprocessToImage(const cv::Mat& srcImage , cv::Mat& letterbox , LETTERBOX_INFO& info , REQUEST_CONTEXT& ctx)
+{
+    cv::Mat image = srcImage;
+    if (srcImage.channels() != 3)
+    {
+        image = ScratchView(ctx.colorImage , srcImage.size() , CV_8UC3);
+        cv::cvtColor(srcImage , image , cv::COLOR_GRAY2RGB);
+    }
+
+    cv::Size resizeSize;
+    int border[4];
+    LetterboxGeometry(srcImage.cols , srcImage.rows , letterbox.size() , info , resizeSize , border);
+
+    // Resize straight into the inner rectangle (a ROI of the right size and type is written in place)
+    // and paint only the four border strips
+    cv::Rect inner(border[2] , border[0] , resizeSize.width , resizeSize.height);
+    cv::Mat innerImage = letterbox(inner);
+    if (image.cols != resizeSize.width || image.rows != resizeSize.height)
+    {
+        cv::resize(image , innerImage , resizeSize);
+    } else
+    {
+        image.copyTo(innerImage);
+    }
+
+    cv::Scalar pad(LETTERBOX_PAD[0] , LETTERBOX_PAD[1] , LETTERBOX_PAD[2]);
+    int bottom = inner.y + inner.height;
+    int right = inner.x + inner.width;
+    letterbox(cv::Rect(0 , 0 , letterbox.cols , inner.y)).setTo(pad);
+    letterbox(cv::Rect(0 , bottom , letterbox.cols , letterbox.rows - bottom)).setTo(pad);
+    letterbox(cv::Rect(0 , inner.y , inner.x , inner.height)).setTo(pad);
+    letterbox(cv::Rect(right , inner.y , letterbox.cols - right , inner.height)).setTo(pad);
+}
+
+void YOLOv8OnnxRunner::PreprocessStage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx)
+{
+    TRACE_SCOPE("preprocess");
+    LOG_DEBUG("PreProcess Image ...");
+    auto time_start = std::chrono::high_resolution_clock::now();
+    ctx.times = STAGE_TIMES();
+    ctx.inputShape = InputShapeFor(srcImage.cols , srcImage.rows);
+    if (this->ioBindingEnable)
+    {
+        // Preprocess straight into the bound input buffer , rebound when the frame shape changes
+        BindContext(ctx);
+    }
+    if (this->rawInput)
+    {
+        // create is a no-op once allocated , a bound tensor keeps pointing at these pixels
+        ctx.letterboxImage.create(ctx.inputShape.height , ctx.inputShape.width , CV_8UC3);
+        PreprocessToImage(srcImage , ctx.letterboxImage , ctx.info , ctx);
+    } else
+    {
+        ctx.input_image.resize((size_t)3 * ctx.inputShape.area());
+        PreprocessToBlob(srcImage , ctx.input_image.data() , ctx.inputShape , ctx.info , ctx);
+    }
+    ctx.times.preprocessMs = ElapsedMs(time_start);
+}
+
+void YOLOv8OnnxRunner::InferenceStage(REQUEST_CONTEXT& ctx)
+{
+    Inference(ctx);
+}
+
+void YOLOv8OnnxRunner::PostprocessStage(REQUEST_CONTEXT& ctx , std::vector<DETECT_RESULT>& result)
+{
+    Postprocess(ctx , result);
+}
+
+float YOLOv8OnnxRunner::CompareFusedPreprocess(const cv::Mat& srcImage)
+{
+    cv::Mat processImage;
+    REQUEST_CONTEXT reference , fused;
+    Preprocess(srcImage , processImage , reference);
+    PreprocessStage(srcImage , fused);
+    if (this->rawInput)
+    {
+        // The graph divides by 255 exactly like Normalize , so compare what it will compute
+        fused.input_image.resize(reference.input_image.size());
+        Normalize(fused.letterboxImage , fused.input_image.data());
+    }
+
+    float maxDiff = 0.0f;
+    for (size_t i = 0 ; i < reference.input_image.size() ; i++)
+    {
+        maxDiff = std::max(maxDiff , std::abs(reference.input_image[i] - fused.input_image[i]));
+    }
+    return maxDiff;
+}
+
+void YOLOv8OnnxRunner::Preprocess(const cv::Mat& srcImage , cv::Mat& processImage , REQUEST_CONTEXT& ctx)
 {   
-    try
+    LOG_DEBUG("PreProcess Image ...");
+    Letterbox(srcImage , processImage , ctx.info);
+
+    ctx.input_image.resize((size_t)processImage.cols * processImage.rows * processImage.channels());
+    Normalize(processImage , ctx.input_image.data());
+
+    LOG_DEBUG("processImage width : " << processImage.cols << ", processImage height : " << processImage.rows);
+}
+
+Ort::Value YOLOv8OnnxRunner::CreateInputTensor(float* blob , int64_t batchSize , cv::Size shape , std::vector<uint8_t>& quantBuffer)
+{
+    std::vector<int64_t> inputDims = { batchSize , 3 , shape.height , shape.width };
+    size_t inputSize = (size_t)batchSize * 3 * shape.height * shape.width;
+    this->tensorAllocationCount++;
+    if (this->inputType == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
     {
-        Ort::Value input_tensor = Ort::Value::CreateTensor<float>( \
-        memory_info_handler , this->input_image.data() , this->input_image.size() , inputNodeDims[0].data() , inputNodeDims[0].size());
-    
-        std::cout << "[INFO] Inference Start ..." << std::endl;
-        
-        auto time_start = std::chrono::high_resolution_clock::now();
-        auto output_tensor = session->Run(
-            options , inputNodeNames.data() , &input_tensor , 1 , outputNodeNames.data() , outputNodeNames.size());
-        auto time_end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> diff = time_end - time_start;
+        return Ort::Value::CreateTensor<float>(memory_info_handler , blob , inputSize , inputDims.data() , inputDims.size());
+    }
 
-        std::cout << "[INFO] Inference Finish ..." << std::endl;
-        std::cout << "[INFO] Inference Cost time : " << diff.count() << "s" << std::endl;
+    quantBuffer.resize(inputSize);
+    QuantizeBlob(blob , inputSize , this->inputScale , this->inputZeroPoint , \
+        this->inputType == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8 , quantBuffer.data());
+    return Ort::Value::CreateTensor(memory_info_handler , quantBuffer.data() , inputSize , \
+        inputDims.data() , inputDims.size() , this->inputType);
+}
 
-        auto temp = output_tensor[0].GetTensorMutableRawData();
-        auto temp_dims = output_tensor[0].GetTypeInfo().GetTensorTypeAndShapeInfo().GetShape();
+Ort::Value YOLOv8OnnxRunner::CreateRawInputTensor(uint8_t* pixels , int64_t batchSize , cv::Size shape)
+{
+    std::vector<int64_t> inputDims = { batchSize , shape.height , shape.width , 3 };
+    size_t inputSize = (size_t)batchSize * shape.height * shape.width * 3;
+    this->tensorAllocationCount++;
+    return Ort::Value::CreateTensor<uint8_t>(memory_info_handler , pixels , inputSize , inputDims.data() , inputDims.size());
+}
 
-        std::cout << "[INFO] Concatoutput0_dim_0 : "<< static_cast<int>(temp_dims.at(0)) \
-                    << ", Concatoutput0_dim_1 : " << static_cast<int>(temp_dims.at(1)) \
-                    << ", Concatoutput0_dim_2 : " << static_cast<int>(temp_dims.at(2)) << std::endl;
+std::vector<Ort::Value> YOLOv8OnnxRunner::InferenceBatchTensor(float* blob , int64_t batchSize , cv::Size shape)
+{
+    try
+    {
+        std::vector<uint8_t> quantBuffer;
+        Ort::Value input_tensor = CreateInputTensor(blob , batchSize , shape , quantBuffer);
+        return RunInputTensor(SessionFor(shape) , input_tensor , batchSize);
+    }
+    catch(const std::exception& e)
+    {
+        LOG_ERROR(e.what());
+    }
+    return std::vector<Ort::Value>();
+}
 
-        result = output_tensor[0].GetTensorMutableData<float>();
+std::vector<Ort::Value> YOLOv8OnnxRunner::InferenceBatchTensor(uint8_t* pixels , int64_t batchSize , cv::Size shape)
+{
+    try
+    {
+        Ort::Value input_tensor = CreateRawInputTensor(pixels , batchSize , shape);
+        return RunInputTensor(SessionFor(shape) , input_tensor , batchSize);
     }
     catch(const std::exception& e)
     {
-        std::cerr << "[ERROR] : " << e.what() << '\n';
+        LOG_ERROR(e.what());
     }
+    return std::vector<Ort::Value>();
 }
 
-void YOLOv8OnnxRunner::Postprocess(float* output , std::vector<DETECT_RESULT>& result , float* pad_left , float* pad_top)
+std::vector<Ort::Value> YOLOv8OnnxRunner::RunInputTensor(Ort::Session* runSession , Ort::Value& input_tensor , int64_t batchSize)
 {
-    std::cout << "[INFO] Postprocess Start ..." << std::endl;
-    int strideNum = outputNodeDims[0][1]; // 84
-    int signalResultNum = outputNodeDims[0][2]; // 8400
-    int score_array_length = (int)outputNodeDims[0][1] - 4;
-    std::cout << "[INFO] strideNum : " << strideNum << " , signalResultNum : " << signalResultNum << std::endl;
+    LOG_DEBUG("Inference Start ... batch size : " << batchSize);
 
-    std::vector<int> class_ids;
-    std::vector<float> confidences;
-    std::vector<cv::Rect> boxes;
+    auto time_start = std::chrono::high_resolution_clock::now();
+    auto output_tensor = runSession->Run(
+        options , inputNodeNames.data() , &input_tensor , 1 , outputNodeNames.data() , outputNodeNames.size());
+    auto time_end = std::chrono::high_resolution_clock::now();
+    this->runCount++;
+    this->tensorAllocationCount += output_tensor.size();
+    std::chrono::duration<double> diff = time_end - time_start;
 
-    cv::Mat rawData = cv::Mat(cv::Size((int)outputNodeDims[0][2] , (int)outputNodeDims[0][1])  , CV_32F , output).t();
-    float* data = (float*)rawData.data;
-    std::cout << "[INFO] rawData width : " << rawData.cols << ", rawData height : " << rawData.rows << std::endl;
-    
-    for (int i = 0 ; i < signalResultNum ; ++i)
-    {
-        float* classesScores = data + 4;
-        cv::Mat scores(1 , score_array_length , CV_32F, data + 4);
-        cv::Point class_id;
-        double maxClassScore;
-        cv::minMaxLoc(scores , 0 , &maxClassScore , 0 , &class_id);
-        maxClassScore = (float)maxClassScore;
-        if (maxClassScore >= this->confThreshold)
-        {
-            confidences.emplace_back(maxClassScore);
-            class_ids.emplace_back(class_id.x);
-            // [x,y,w,h]
-            float x = (data[0] - *pad_left) / this->resizeScales;
-            float y = (data[1] - *pad_top) / this->resizeScales;
-            float w = data[2] / this->resizeScales;
-            float h = data[3] / this->resizeScales;
+    LOG_DEBUG("Inference Finish ...");
+    LOG_DEBUG("Inference Cost time : " << diff.count() << "s");
+
+#if YOLO_LOG_LEVEL <= LOG_LEVEL_DEBUG
+    auto temp_dims = output_tensor[0].GetTensorTypeAndShapeInfo().GetShape();
+    LOG_DEBUG("Concatoutput0_dim_0 : "<< static_cast<int>(temp_dims.at(0)) \
+                << ", Concatoutput0_dim_1 : " << static_cast<int>(temp_dims.at(1)) \
+                << ", Concatoutput0_dim_2 : " << static_cast<int>(temp_dims.at(2)));
+#endif
+
+    return output_tensor;
+}
+
+void YOLOv8OnnxRunner::Inference(REQUEST_CONTEXT& ctx)
+{   
+    TRACE_SCOPE("inference");
+    auto time_start = std::chrono::high_resolution_clock::now();
+    ctx.ranBound = IsBound(ctx);
+    if (ctx.ranBound)
+    {
+        // Input already sits in the bound buffer , outputs are written into the preallocated ones
+        try
+        {
+            LOG_DEBUG("Inference Start ... (IoBinding)");
+            if (this->inputType != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
+            {
+                // Same size as at bind time , so the bound tensor still points at this buffer
+                QuantizeBlob(ctx.input_image.data() , ctx.quant_input.size() , this->inputScale , this->inputZeroPoint , \
+                    this->inputType == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8 , ctx.quant_input.data());
+            }
+            ctx.boundSession->Run(options , *ctx.ioBinding);
+            auto time_end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> diff = time_end - time_start;
+            this->runCount++;
+            this->boundRunCount++;
+            LOG_DEBUG("Inference Cost time : " << diff.count() << "s");
+        }
+        catch(const std::exception& e)
+        {
+            // No outputs for this frame rather than the previous frame's
+            LOG_ERROR(e.what());
+            ctx.ranBound = false;
+            ctx.output_tensors.clear();
+        }
+        ctx.times.inferenceMs = ElapsedMs(time_start);
+        return;
+    }
+
+    // session->Run is thread safe , the outputs live in the caller's context instead of the runner
+    ctx.output_tensors = this->rawInput ? InferenceBatchTensor(ctx.letterboxImage.data , 1 , ctx.inputShape) : \
+        InferenceBatchTensor(ctx.input_image.data() , 1 , ctx.inputShape);
+    ctx.times.inferenceMs = ElapsedMs(time_start);
+}
+
+void YOLOv8OnnxRunner::Postprocess(REQUEST_CONTEXT& ctx , std::vector<DETECT_RESULT>& result)
+{
+    TRACE_SCOPE("postprocess");
+    LOG_DEBUG("Postprocess Start ...");
+    // Decided by the run , the binding may have changed since
+    bool bound = ctx.ranBound;
+    std::vector<Ort::Value>& outputs = bound ? ctx.boundOutputs : ctx.output_tensors;
+    if (outputs.empty())
+    {
+        LOG_DEBUG("Postprocess Finish ...");
+        return;
+    }
+
+    ctx.times.decodeMs = ctx.times.nmsMs = ctx.times.maskMs = 0.0;
+    if (bound)
+    {
+        DecodeOutput(HeadOutput(outputs , ctx.boundOutputDims , 0 , ctx.inputShape) , ctx.info , result , \
+            ctx.workspace , ctx.times);
+    } else
+    {
+        // Anchor count from the actual output : 8400 at 640x640 , fewer for a rect mode tensor
+        std::vector<std::vector<int64_t>> outputDims;
+        for (auto& output : outputs)
+        {
+            outputDims.push_back(output.GetTensorTypeAndShapeInfo().GetShape());
+        }
+        DecodeOutput(HeadOutput(outputs , outputDims , 0 , ctx.inputShape) , ctx.info , result , ctx.workspace , ctx.times);
+    }
+    LOG_DEBUG("Postprocess Finish ...");
+}
+
+HEAD_OUTPUT YOLOv8OnnxRunner::HeadOutput(std::vector<Ort::Value>& outputs , const std::vector<std::vector<int64_t>>& dims , \
+    size_t index , cv::Size inputShape)
+{
+    // output0 : [batch , channels , anchors]
+    HEAD_OUTPUT head;
+    head.channels = (int)dims[0][1]; // 84
+    head.anchors = (int)dims[0][2]; // 8400
+    head.output = outputs[0].GetTensorMutableData<float>() + index * head.channels * head.anchors;
+    head.inputShape = inputShape;
+    // output1 : [batch , mask channels , height / 4 , width / 4]
+    if (this->task == TASK_SEGMENT && outputs.size() > 1 && dims.size() > 1 && dims[1].size() == 4)
+    {
+        head.protoHeight = (int)dims[1][2];
+        head.protoWidth = (int)dims[1][3];
+        head.protos = outputs[1].GetTensorMutableData<float>() + index * dims[1][1] * head.protoHeight * head.protoWidth;
+    }
+    return head;
+}
+
+void YOLOv8OnnxRunner::DecodeOutput(const HEAD_OUTPUT& head , const LETTERBOX_INFO& info , std::vector<DETECT_RESULT>& result , \
+    DECODE_WORKSPACE& workspace , STAGE_TIMES& times)
+{
+    auto time_start = std::chrono::high_resolution_clock::now();
+    const float* output = head.output;
+    int strideNum = head.channels;
+    int signalResultNum = head.anchors;
+    // Class count follows the model head , not the 80 COCO names
+    int numClasses = this->num_classes > 0 ? this->num_classes : \
+        strideNum - 4 - this->num_masks - this->num_keypoints * this->keypoint_dims;
+    LOG_DEBUG("strideNum : " << strideNum << " , signalResultNum : " << signalResultNum \
+        << " , numClasses : " << numClasses);
+
+    DECODE_CANDIDATES& candidates = workspace.candidates;
+    NMS_BOXES& boxes = workspace.boxes;
+    candidates.clear();
+    boxes.clear();
+    {
+        TRACE_SCOPE("decode");
+        DecodeCandidates(output , strideNum , signalResultNum , numClasses , this->confThreshold.load() , candidates);
 
-            int left = std::max(int(x - 0.5 * w + 0.5), 0);
-            int top = std::max(int(y - 0.5 * h + 0.5), 0);
+        boxes.reserve(candidates.size());
+        for (size_t i = 0 ; i < candidates.size() ; i++)
+        {
+            // [x,y,w,h]
+            const cv::Vec4f& box = candidates.boxes[i];
+            float x = (box[0] - info.pad_left) / info.scale;
+            float y = (box[1] - info.pad_top) / info.scale;
+            float w = box[2] / info.scale;
+            float h = box[3] / info.scale;
 
-            boxes.emplace_back(cv::Rect(left , top , int(w + 0.5), int(h + 0.5)));
+            boxes.push_back(x - 0.5f * w , y - 0.5f * h , x + 0.5f * w , y + 0.5f * h , \
+                candidates.scores[i] , candidates.classIds[i]);
         }
-        data += strideNum;
     }
+    times.decodeMs += ElapsedMs(time_start);
 
-    std::vector<int> nmsResult;
-    cv::dnn::NMSBoxes(boxes , confidences , this->confThreshold , this->iouThreshold , nmsResult);
-    std::cout << "[INFO] NMSResult Size : " << nmsResult.size() << std::endl;
+    time_start = std::chrono::high_resolution_clock::now();
+    std::vector<int>& nmsResult = workspace.keep;
+    std::vector<float>& nmsScores = workspace.keepScores;
+    {
+        TRACE_SCOPE("nms");
+        NonMaximumSuppression(boxes , nmsResult , nmsScores , workspace.nmsEngine);
+    }
+    times.nmsMs += ElapsedMs(time_start);
+    LOG_DEBUG("NMSResult Size : " << nmsResult.size());
+
+    // Rows after the class scores : mask coefficients or keypoints , read at the kept anchors only
+    const float* extraRows = output + (size_t)(4 + numClasses) * signalResultNum;
+    size_t firstKept = result.size();
     for (int i = 0 ; i < nmsResult.size() ; i++)
     {
         int idx = nmsResult[i];
         DETECT_RESULT res;
-        res.classId = class_ids[idx];
-        res.confidence = confidences[idx];
-        res.box = boxes[idx];
+        res.classId = boxes.classIds[idx];
+        res.confidence = nmsScores[i];
 
-        std::cout << "[INFO] classId : " << res.classId << " , className : " << this->classes[res.classId] << " , Confidence : " << res.confidence << " , Box : " << res.box << std::endl;
+        float w = boxes.x2[idx] - boxes.x1[idx];
+        float h = boxes.y2[idx] - boxes.y1[idx];
+        int left = std::max(int(boxes.x1[idx] + 0.5f), 0);
+        int top = std::max(int(boxes.y1[idx] + 0.5f), 0);
+        res.box = cv::Rect(left , top , int(w + 0.5f), int(h + 0.5f));
 
-        result.emplace_back(res);
+        if (this->num_keypoints > 0)
+        {
+            // Model input pixels like the box , the confidence row is already a probability
+            const float* point = extraRows + candidates.anchors[idx];
+            res.keyPoints.resize(this->num_keypoints);
+            for (int k = 0 ; k < this->num_keypoints ; k++)
+            {
+                res.keyPoints[k] = cv::Point3f((point[0] - info.pad_left) / info.scale , \
+                    (point[signalResultNum] - info.pad_top) / info.scale , \
+                    this->keypoint_dims > 2 ? point[2 * signalResultNum] : 1.0f);
+                point += (size_t)this->keypoint_dims * signalResultNum;
+            }
+        }
+
+        LOG_TRACE("classId : " << res.classId << " , className : " << GetClassName(res.classId) << " , Confidence : " << res.confidence << " , Box : " << res.box);
+
+        result.emplace_back(std::move(res));
     }
-    std::cout << "[INFO] Postprocess Finish ..." << std::endl;
+
+    if (head.protos == nullptr || this->num_masks <= 0 || head.inputShape.area() == 0)
+    {
+        return;
+    }
+    time_start = std::chrono::high_resolution_clock::now();
+    {
+        TRACE_SCOPE("mask");
+        // Prototype cells per model input pixel , 1/4 for the YOLOv8 heads
+        float gridX = (float)head.protoWidth / head.inputShape.width;
+        float gridY = (float)head.protoHeight / head.inputShape.height;
+        for (size_t i = 0 ; i < nmsResult.size() ; i++)
+        {
+            int idx = nmsResult[i];
+            DETECT_RESULT& res = result[firstKept + i];
+            // Box on the prototype grid , rounded outwards
+            int x1 = std::max((int)std::floor((boxes.x1[idx] * info.scale + info.pad_left) * gridX) , 0);
+            int y1 = std::max((int)std::floor((boxes.y1[idx] * info.scale + info.pad_top) * gridY) , 0);
+            int x2 = std::min((int)std::ceil((boxes.x2[idx] * info.scale + info.pad_left) * gridX) , head.protoWidth);
+            int y2 = std::min((int)std::ceil((boxes.y2[idx] * info.scale + info.pad_top) * gridY) , head.protoHeight);
+            if (x2 <= x1 || y2 <= y1)
+            {
+                continue;
+            }
+            cv::Rect region(x1 , y1 , x2 - x1 , y2 - y1);
+            DecodeMask(head.protos , this->num_masks , head.protoHeight , head.protoWidth , \
+                extraRows + candidates.anchors[idx] , signalResultNum , region , res.mask);
+
+            // The same cells in source pixels , so the upsampled mask lines up with them
+            res.maskRect = cv::Rect(cv::Point((int)std::lround((x1 / gridX - info.pad_left) / info.scale) , \
+                (int)std::lround((y1 / gridY - info.pad_top) / info.scale)) , \
+                cv::Point((int)std::lround((x2 / gridX - info.pad_left) / info.scale) , \
+                (int)std::lround((y2 / gridY - info.pad_top) / info.scale)));
+        }
+    }
+    times.maskMs += ElapsedMs(time_start);
 }
 
-cv::Mat YOLOv8OnnxRunner::VisualizationPredicition(cv::Mat image , std::vector<DETECT_RESULT> result)
+cv::Mat YOLOv8OnnxRunner::UpsampleMask(const DETECT_RESULT& result , float threshold)
 {
-    for (auto& re : result)
+    cv::Mat mask;
+    if (result.mask.empty() || result.maskRect.area() <= 0)
+    {
+        return mask;
+    }
+    cv::Mat probabilities;
+    cv::resize(result.mask , probabilities , result.maskRect.size() , 0 , 0 , cv::INTER_LINEAR);
+    cv::threshold(probabilities , probabilities , threshold , 255.0 , cv::THRESH_BINARY);
+    probabilities.convertTo(mask , CV_8U);
+
+    // Prototype cells overhang the box , the head's masks are cropped to it
+    cv::Mat cropped = cv::Mat::zeros(mask.size() , CV_8U);
+    cv::Rect inside = (result.box - result.maskRect.tl()) & cv::Rect(cv::Point(0 , 0) , mask.size());
+    cv::Mat target = cropped(inside);
+    mask(inside).copyTo(target);
+    return cropped;
+}
+
+std::string YOLOv8OnnxRunner::GetClassName(int classId) const
+{
+    if (classId >= 0 && classId < (int)this->classes.size())
+    {
+        return this->classes[classId];
+    }
+    return std::to_string(classId);
+}
+
+cv::Mat YOLOv8OnnxRunner::VisualizationPredicition(cv::Mat image , const std::vector<DETECT_RESULT>& result) const
+{
+    for (const auto& re : result)
     {
         cv::RNG rng(cv::getTickCount());
         cv::Scalar color(rng.uniform(0 , 256) , rng.uniform(0 , 256) , rng.uniform(0 , 256));
+        cv::Rect maskArea = re.maskRect & cv::Rect(0 , 0 , image.cols , image.rows);
+        if (!re.mask.empty() && maskArea.area() > 0)
+        {
+            // Half transparent fill of the mask pixels
+            cv::Mat mask = UpsampleMask(re);
+            cv::Mat region = image(maskArea);
+            cv::Mat tinted;
+            cv::addWeighted(region , 0.5 , cv::Mat(region.size() , region.type() , color) , 0.5 , 0.0 , tinted);
+            tinted.copyTo(region , mask(maskArea - re.maskRect.tl()));
+        }
         cv::rectangle(image , re.box , color , 3);
+        for (const auto& point : re.keyPoints)
+        {
+            if (point.z >= 0.5f)
+            {
+                cv::circle(image , cv::Point((int)point.x , (int)point.y) , 4 , color , cv::FILLED);
+            }
+        }
         
         float confidence = float(100 * re.confidence) / 100;
-        std::cout << std::fixed << std::setprecision(2);
-        std::string label = this->classes[re.classId] + " " + \
+        std::string label = GetClassName(re.classId) + " " + \
             std::to_string(confidence).substr(0 , std::to_string(confidence).size() - 4);
+        if (re.trackId >= 0)
+        {
+            label = "#" + std::to_string(re.trackId) + " " + label;
+        }
         
         cv::rectangle(image , cv::Point(re.box.x , re.box.y - 25) , \
             cv::Point(re.box.x + label.length() * 15 , re.box.y) , color , cv::FILLED);
@@ -284,17 +1196,126 @@ cv::Mat YOLOv8OnnxRunner::VisualizationPredicition(cv::Mat image , std::vector<D
 
 std::vector<DETECT_RESULT> YOLOv8OnnxRunner::InferenceSingleImage(const cv::Mat& srcImage)
 {
-    float* predict = nullptr;
-    cv::Mat processImage;
+    if (this->ioBindingEnable)
+    {
+        // The context bound at init time serves one caller at a time , others bind their own
+        std::unique_lock<std::mutex> lock(this->boundContextMutex , std::try_to_lock);
+        if (lock.owns_lock())
+        {
+            return InferenceSingleImage(srcImage , this->boundContext);
+        }
+    }
+    REQUEST_CONTEXT ctx;
+    return InferenceSingleImage(srcImage , ctx);
+}
+
+std::vector<DETECT_RESULT> YOLOv8OnnxRunner::InferenceSingleImage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx)
+{
     std::vector<DETECT_RESULT> result;
-    float pad_left = 0 , pad_top = 0;
+    InferenceSingleImage(srcImage , ctx , result);
+    return result;
+}
 
-    Preprocess(srcImage , processImage , &pad_left , &pad_top);
+void YOLOv8OnnxRunner::InferenceSingleImage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx , std::vector<DETECT_RESULT>& result)
+{
+    TRACE_SCOPE("frame");
+    result.clear();
+
+    PreprocessStage(srcImage , ctx);
     
-    Inference(predict);
+    Inference(ctx);
     
-    Postprocess(predict , result ,  &pad_left , &pad_top);
+    Postprocess(ctx , result);
 
-    return result;
+    // Outputs belong to the session allocator , do not keep them in a context that may outlive it
+    ctx.output_tensors.clear();
 }
 
+std::vector<std::vector<DETECT_RESULT>> YOLOv8OnnxRunner::InferenceBatch(const std::vector<cv::Mat>& srcImages , \
+    STAGE_TIMES* times)
+{
+    std::vector<std::vector<DETECT_RESULT>> results(srcImages.size());
+    if (srcImages.empty())
+    {
+        return results;
+    }
+
+    // Dynamic-batch models take the whole list at once , fixed-batch models are fed chunk by chunk
+    int64_t modelBatch = GetModelBatchSize();
+    int64_t chunkSize = modelBatch > 0 ? modelBatch : (int64_t)srcImages.size();
+
+    std::vector<float> blob;
+    std::vector<uint8_t> pixels; // Raw input mode
+    std::vector<LETTERBOX_INFO> infos;
+    REQUEST_CONTEXT ctx;
+
+    for (size_t begin = 0 ; begin < srcImages.size() ; begin += chunkSize)
+    {
+        size_t count = std::min((size_t)chunkSize , srcImages.size() - begin);
+
+        // One tensor shape per chunk : in rect mode the smallest one every image of the chunk fits in
+        cv::Size shape(0 , 0);
+        for (size_t i = 0 ; i < count ; i++)
+        {
+            cv::Size imageShape = InputShapeFor(srcImages[begin + i].cols , srcImages[begin + i].rows);
+            shape.width = std::max(shape.width , imageShape.width);
+            shape.height = std::max(shape.height , imageShape.height);
+        }
+        size_t sliceSize = (size_t)3 * shape.area();
+
+        // Unused slots of a fixed-batch chunk are filled with the letterbox pad colour and ignored afterwards
+        if (this->rawInput)
+        {
+            pixels.assign(chunkSize * sliceSize , LETTERBOX_PAD[0]);
+        } else
+        {
+            blob.assign(chunkSize * sliceSize , LETTERBOX_PAD[0] / 255.0f);
+        }
+        infos.assign(count , LETTERBOX_INFO());
+        auto time_start = std::chrono::high_resolution_clock::now();
+        {
+            TRACE_SCOPE("preprocess");
+            for (size_t i = 0 ; i < count ; i++)
+            {
+                if (this->rawInput)
+                {
+                    cv::Mat slot(shape.height , shape.width , CV_8UC3 , pixels.data() + i * sliceSize);
+                    PreprocessToImage(srcImages[begin + i] , slot , infos[i] , ctx);
+                } else
+                {
+                    PreprocessToBlob(srcImages[begin + i] , blob.data() + i * sliceSize , shape , infos[i] , ctx);
+                }
+            }
+        }
+        ctx.times.preprocessMs += ElapsedMs(time_start);
+
+        time_start = std::chrono::high_resolution_clock::now();
+        std::vector<Ort::Value> outputs;
+        {
+            TRACE_SCOPE("inference");
+            outputs = this->rawInput ? InferenceBatchTensor(pixels.data() , chunkSize , shape) : \
+                InferenceBatchTensor(blob.data() , chunkSize , shape);
+        }
+        ctx.times.inferenceMs += ElapsedMs(time_start);
+        if (outputs.empty())
+        {
+            continue;
+        }
+
+        std::vector<std::vector<int64_t>> outputDims;
+        for (auto& output : outputs)
+        {
+            outputDims.push_back(output.GetTensorTypeAndShapeInfo().GetShape());
+        }
+        for (size_t i = 0 ; i < count ; i++)
+        {
+            DecodeOutput(HeadOutput(outputs , outputDims , i , shape) , infos[i] , results[begin + i] , ctx.workspace , ctx.times);
+        }
+    }
+
+    if (times != nullptr)
+    {
+        *times = ctx.times;
+    }
+    return results;
+}
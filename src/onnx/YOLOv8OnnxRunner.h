@@ -1,29 +1,133 @@
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <thread>
+#include <shared_mutex>
+#include <atomic>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <onnxruntime_cxx_api.h>
 
 #include "Configuration.h"
+#include "NMSEngine.h"
+#include "OutputDecoder.h"
+#include "SharedModel.h"
 
 typedef struct _DL_RESULT
 {
     int classId;
     float confidence;
     cv::Rect box;
-    // std::vector<cv::Point2f> keyPoints;
+    int trackId = -1; // Tracking mode only , stable across frames
+    std::vector<cv::Point3f> keyPoints; // Pose : x , y in source image pixels , z the keypoint confidence
+    cv::Mat mask; // Segment : CV_32F probabilities at prototype resolution , see YOLOv8OnnxRunner::UpsampleMask
+    cv::Rect maskRect; // Segment : source image region mask covers , the box rounded out to the prototype grid
 } DETECT_RESULT;
 
+// Head the model was exported with , from the ultralytics "task" metadata or the output shapes
+enum MODEL_TASK { TASK_DETECT , TASK_SEGMENT , TASK_POSE };
+
+// One image's slice of the head outputs , as DecodeOutput reads them
+typedef struct _HEAD_OUTPUT
+{
+    const float* output = nullptr; // output0 : [4 + classes + mask coefficients or keypoints , anchors]
+    int channels = 0;
+    int anchors = 0;
+    const float* protos = nullptr; // Segment output1 : [mask channels , protoHeight , protoWidth]
+    int protoHeight = 0;
+    int protoWidth = 0;
+    cv::Size inputShape; // Tensor the image was letterboxed into , maps boxes onto the prototype grid
+} HEAD_OUTPUT;
+
+typedef struct _LETTERBOX_INFO
+{
+    float scale = 1.0f;
+    float pad_left = 0.0f;
+    float pad_top = 0.0f;
+} LETTERBOX_INFO;
+
+// Wall time of each stage of the last frame (or batch) run through a context , in ms
+typedef struct _STAGE_TIMES
+{
+    double preprocessMs = 0.0;
+    double inferenceMs = 0.0;
+    double decodeMs = 0.0; // Candidate decode and mapping back to the source image
+    double nmsMs = 0.0;
+    double maskMs = 0.0; // Segment : mask assembly of the boxes NMS kept
+} STAGE_TIMES;
+
+// Postprocess scratch , cleared but never shrunk , so a warm context decodes without touching the heap
+typedef struct _DECODE_WORKSPACE
+{
+    DECODE_CANDIDATES candidates;
+    NMS_BOXES boxes; // Candidates mapped back to source image corners
+    std::vector<int> keep;
+    std::vector<float> keepScores;
+    NMSEngine nmsEngine;
+} DECODE_WORKSPACE;
+
+/*
+    Per-frame state handed from stage to stage. A stage call only touches the context it is
+    given , so different frames can sit in different stages on different threads.
+    Every buffer only grows : once a context has seen the largest frame and the most
+    candidates of a stream , the single image path runs without heap allocations.
+*/
+typedef struct _REQUEST_CONTEXT
+{
+    cv::Mat colorImage; // Scratch for non BGR sources , frames use a ROI of it
+    cv::Mat resizeImage; // Scratch for the resized , unpadded image , frames use a ROI of it
+    std::vector<float> input_image;
+    std::vector<uint8_t> quant_input; // 8-bit copy of input_image for models with a quantized input
+    cv::Mat letterboxImage; // Raw input mode : the letterboxed 8UC3 frame , fed to the model as is
+    LETTERBOX_INFO info;
+    cv::Size inputShape; // Tensor width x height of the frame , below the input size in rect mode
+    std::vector<Ort::Value> output_tensors;
+    DECODE_WORKSPACE workspace;
+    STAGE_TIMES times;
+
+    // IoBinding mode : input_image (or letterboxImage) and outputBuffers are bound once and reused for every frame
+    Ort::Session* boundSession = nullptr;
+    cv::Size boundShape;
+    std::unique_ptr<Ort::IoBinding> ioBinding;
+    Ort::Value boundInput{ nullptr };
+    std::vector<Ort::Value> boundOutputs;
+    std::vector<std::vector<float>> outputBuffers;
+    std::vector<std::vector<int64_t>> boundOutputDims; // Shapes of boundOutputs , GetShape allocates
+    bool ranBound = false; // Inference wrote boundOutputs , not output_tensors : what Postprocess decodes
+} REQUEST_CONTEXT;
+
+typedef struct _RUNNER_COUNTERS
+{
+    uint64_t runs = 0; // session->Run calls
+    uint64_t boundRuns = 0; // ... of which went through a reused IoBinding
+    uint64_t tensorAllocations = 0; // Ort::Value tensors created by the runner or returned by session->Run
+} RUNNER_COUNTERS;
+
+typedef struct _STARTUP_TIMES
+{
+    double sessionMs = 0.0; // Ort::Session construction , graph optimization included unless cached
+    double warmupMs = 0.0; // All warm-up runs
+    double firstRunMs = 0.0; // The first warm-up run alone
+    bool cacheHit = false; // Session loaded from the optimized model cache
+} STARTUP_TIMES;
+
 class YOLOv8OnnxRunner
 {
 private:
     bool cudaEnable;
     int input_width = 640;
     int input_height = 640;
-    int num_classes = 1;
-    float resizeScales = 1.0f; // Letterbox Scales
+    int num_classes = 0; // Read from outputNodeDims , 0 means take it from the output shape
+    MODEL_TASK task = TASK_DETECT;
+    int num_masks = 0; // Segment : mask coefficients per anchor , one per prototype channel
+    int num_keypoints = 0; // Pose : keypoints per anchor ...
+    int keypoint_dims = 0; // ... of 2 (x , y) or 3 (x , y , confidence) values
     const int reg_max = 16;
-    float confThreshold = 0.60f;
-    float iouThreshold = 0.45f;
+    // Read by every in-flight request , may be changed from another thread
+    std::atomic<float> confThreshold{ 0.60f };
+    std::atomic<float> iouThreshold{ 0.45f };
+    NMS_CONFIG nmsConfig;
     std::vector<std::string> classes = {
         "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat", "traffic light", 
         "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat", "dog", "horse", "sheep", "cow", 
@@ -42,7 +146,36 @@ private:
     Ort::MemoryInfo memory_info_handler = Ort::MemoryInfo::CreateCpu(
 		OrtArenaAllocator, OrtMemTypeDefault
 	);
-    std::vector<float> input_image;
+    // Quantized input (uint8 / int8) : the float blob is quantized with these before every Run
+    ONNXTensorElementDataType inputType = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+    float inputScale = 1.0f / 255.0f;
+    int inputZeroPoint = 0;
+    // In-graph preprocessing : the model takes the letterboxed uint8 NHWC frame and normalizes it itself
+    bool rawInput = false;
+    std::string modelPath;
+    std::string modelBytes; // Rewritten model when rawInput , kept while per-shape sessions may still be created
+    // Mapped model file , shared with the other runners of the process ; shareWeights also shares its initializers
+    std::shared_ptr<SharedModel> sharedModel;
+    bool shareWeights = false;
+    // Rect mode : pad each frame only to the next stride multiple , needs dynamic height / width axes
+    bool rectEnable = false;
+    // Per-shape sessions : height / width pinned with free dimension overrides , for providers that want fixed shapes
+    int shapeSessionLimit = 0;
+    std::string heightDimName;
+    std::string widthDimName;
+    std::shared_mutex shapeSessionsMutex; // Shared for lookups , exclusive only to claim or insert a shape
+    // Null while the session is being built , and for good past the limit or after a failed build
+    std::map<std::pair<int , int> , std::unique_ptr<Ort::Session>> shapeSessions;
+    int shapeSessionBuilds = 0; // Claimed builds , finished or not , counted against shapeSessionLimit
+    std::vector<std::thread> shapeBuilders; // Joined by the destructor
+    bool ioBindingEnable = false;
+    REQUEST_CONTEXT boundContext; // Bound at InitOrtEnv , used by InferenceSingleImage(srcImage)
+    std::mutex boundContextMutex;
+    std::atomic<uint64_t> runCount{ 0 };
+    std::atomic<uint64_t> boundRunCount{ 0 };
+    std::atomic<uint64_t> tensorAllocationCount{ 0 };
+    STARTUP_TIMES startupTimes;
+
     std::vector<const char*> inputNodeNames;
     std::vector<const char*> outputNodeNames;
     // float32[1,3,640,640]
@@ -52,15 +185,64 @@ private:
 
 private:
     inline void Softmax();
-    inline void Normalize(cv::Mat image);
-    void NonMaximumSuppression();
+    inline void Normalize(const cv::Mat& image , float* blob);
+    // Scale fits the input size , border centres the resized image inside canvas
+    void LetterboxGeometry(int src_width , int src_height , cv::Size canvas , LETTERBOX_INFO& info , \
+        cv::Size& resizeSize , int border[4]);
+    void NonMaximumSuppression(const NMS_BOXES& boxes , std::vector<int>& keep , std::vector<float>& keepScores , \
+        NMSEngine& engine);
+    // Session from the optimized model cache , optimizing and writing the cache on a miss ; nullptr on failure
+    Ort::Session* CreateCachedSession(const Configuration& cfg);
+    /* From modelBytes when not empty (rewritten model) , the mapped model , otherwise from modelPath.
+       share : with the shared weights when shareWeights is on */
+    Ort::Session* NewSession(const Ort::SessionOptions& sessionOptions , bool share = true);
+    /* Session that runs tensors of this shape : the shared one , or a per-shape session. The first caller
+       of a new shape starts a background build , the shape runs on the shared session until it is ready */
+    Ort::Session* SessionFor(const cv::Size& shape);
+    void BuildShapeSession(cv::Size shape);
+    // The context's IoBinding matches its current frame shape , BindContext also checks the session
+    bool IsBound(const REQUEST_CONTEXT& ctx);
 
 protected:
-    void Preprocess(cv::Mat srcImage , cv::Mat& processImage , float* pad_left , float* pad_top);
+    // Reference preprocess : clone , resize , copyMakeBorder and the per-pixel Normalize loop
+    void Preprocess(const cv::Mat& srcImage , cv::Mat& processImage , REQUEST_CONTEXT& ctx);
+
+    void Letterbox(const cv::Mat& srcImage , cv::Mat& processImage , LETTERBOX_INFO& info);
+
+    // Fused letterbox + normalize + HWC->CHW , writes canvas.width x canvas.height planar floats into blob
+    void PreprocessToBlob(const cv::Mat& srcImage , float* blob , cv::Size canvas , LETTERBOX_INFO& info , REQUEST_CONTEXT& ctx);
+
+    // Raw input mode : letterbox into an allocated 8UC3 Mat (its size is the canvas) without reallocating it
+    void PreprocessToImage(const cv::Mat& srcImage , cv::Mat& letterbox , LETTERBOX_INFO& info , REQUEST_CONTEXT& ctx);
+
+    void Inference(REQUEST_CONTEXT& ctx);
 
-    void Inference(float*& predict);
+    std::vector<Ort::Value> InferenceBatchTensor(float* blob , int64_t batchSize , cv::Size shape);
 
-    void Postprocess(float* output , std::vector<DETECT_RESULT>& result , float* pad_left , float* pad_top);
+    // Raw input mode : pixels holds batchSize letterboxed BGR frames , NHWC
+    std::vector<Ort::Value> InferenceBatchTensor(uint8_t* pixels , int64_t batchSize , cv::Size shape);
+
+    std::vector<Ort::Value> RunInputTensor(Ort::Session* runSession , Ort::Value& input_tensor , int64_t batchSize);
+
+    // Input tensor over blob , or over quantBuffer filled from blob when the model input is 8-bit
+    Ort::Value CreateInputTensor(float* blob , int64_t batchSize , cv::Size shape , std::vector<uint8_t>& quantBuffer);
+
+    // uint8 [batch , height , width , 3] tensor over pixels , no copy
+    Ort::Value CreateRawInputTensor(uint8_t* pixels , int64_t batchSize , cv::Size shape);
+
+    // Allocate the context's input/output buffers for its inputShape and bind them , again only when the shape changes
+    void BindContext(REQUEST_CONTEXT& ctx);
+
+    void Postprocess(REQUEST_CONTEXT& ctx , std::vector<DETECT_RESULT>& result);
+
+    // Image index of a batched output as a HEAD_OUTPUT , dims are the output shapes
+    HEAD_OUTPUT HeadOutput(std::vector<Ort::Value>& outputs , const std::vector<std::vector<int64_t>>& dims , \
+        size_t index , cv::Size inputShape);
+
+    /* Appends to result , adds its decode , NMS and mask time to times. Keypoints are read with the
+       boxes of the detections NMS kept , masks are assembled for those detections only. */
+    void DecodeOutput(const HEAD_OUTPUT& head , const LETTERBOX_INFO& info , std::vector<DETECT_RESULT>& result , \
+        DECODE_WORKSPACE& workspace , STAGE_TIMES& times);
 
 public:
     explicit YOLOv8OnnxRunner(Configuration cfg); 
@@ -68,9 +250,61 @@ public:
 
     void InitOrtEnv(Configuration cfg);
 
+    /* All per-request state lives in a REQUEST_CONTEXT , so one runner (and its Ort::Session)
+       can serve any number of threads. Reuse a context per thread to keep its buffers. */
     std::vector<DETECT_RESULT> InferenceSingleImage(const cv::Mat& srcImage);
 
-    cv::Mat VisualizationPredicition(cv::Mat image , std::vector<DETECT_RESULT> result);
+    std::vector<DETECT_RESULT> InferenceSingleImage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx);
+
+    /* Detections are written into the caller's result (cleared first , capacity kept). With IoBinding
+       and a warm ctx and result this is the allocation free path , see --check-allocations. */
+    void InferenceSingleImage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx , std::vector<DETECT_RESULT>& result);
+
+    /* Letterbox every image into one NCHW tensor and run them through a single session->Run.
+       Fixed-batch models are fed in chunks of their batch size , dynamic-batch models in one go.
+       times , when given , receives the stage times summed over the whole call. */
+    std::vector<std::vector<DETECT_RESULT>> InferenceBatch(const std::vector<cv::Mat>& srcImages , \
+        STAGE_TIMES* times = nullptr);
+
+    /* Single image path split into stages for pipelined callers. Stages of different frames
+       may run concurrently as long as each frame has its own REQUEST_CONTEXT. */
+    void PreprocessStage(const cv::Mat& srcImage , REQUEST_CONTEXT& ctx);
+
+    void InferenceStage(REQUEST_CONTEXT& ctx);
+
+    void PostprocessStage(REQUEST_CONTEXT& ctx , std::vector<DETECT_RESULT>& result);
+
+    // Tensor allocation counters , flat after warm-up when IoBinding is enabled
+    RUNNER_COUNTERS GetCounters() const;
+
+    // Run `runs` pad-coloured dummy frames so the first real request does not pay for arena growth
+    void Warmup(int runs);
+
+    STARTUP_TIMES GetStartupTimes() const { return startupTimes; }
+
+    // Max absolute difference between the fused preprocess blob and the Preprocess/Normalize reference
+    float CompareFusedPreprocess(const cv::Mat& srcImage);
+
+    // Network input size (width , height)
+    cv::Size GetInputSize() const { return cv::Size(this->input_width , this->input_height); }
+
+    // Tensor size a src_width x src_height image is letterboxed into : the input size , or in rect
+    // mode the resized image rounded up to the stride
+    cv::Size InputShapeFor(int src_width , int src_height) const;
+
+    // Return the batch size fixed by the model , or 0 when the batch axis is dynamic
+    int64_t GetModelBatchSize() const;
+
+    MODEL_TASK GetTask() const { return task; }
+
+    cv::Mat VisualizationPredicition(cv::Mat image , const std::vector<DETECT_RESULT>& result) const;
+
+    /* Segment : result.mask upsampled to maskRect and thresholded , CV_8U 0 / 255 with everything
+       outside the box cleared. Masks stay at prototype resolution until a caller asks for this. */
+    static cv::Mat UpsampleMask(const DETECT_RESULT& result , float threshold = 0.5f);
+
+    // Class name for visualization , falls back to the id when the model has more classes than names
+    std::string GetClassName(int classId) const;
 
     void setConfThreshold(float threshold);
 
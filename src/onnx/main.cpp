@@ -2,13 +2,35 @@
     # Authore : OroChippw
     # Last Change : 2023.12.20
 */
+#include <map>
+#include <set>
 #include <chrono>
+#include <climits>
+#include <ctime>
+#include <thread>
+#include <sstream>
 #include <iostream>
 #include <filesystem>
 #include <opencv2/opencv.hpp>
 
 #include "Configuration.h"
 #include "YOLOv8OnnxRunner.h"
+#include "PreprocessKernel.h"
+#include "OutputDecoder.h"
+#include "NMSEngine.h"
+#include "PipelineRunner.h"
+#include "RunnerPool.h"
+#include "VideoStreamRunner.h"
+#include "TiledRunner.h"
+#include "FrameCache.h"
+#include "TrackingRunner.h"
+#include "Trace.h"
+#include "ModelCache.h"
+#include "LatencyRecorder.h"
+#include "AllocationCounter.h"
+#include "ProcessMemory.h"
+#include "ResultStore.h"
+#include "HostProfile.h"
 
 void Print_Usage(int argc, char ** argv, const Configuration & cfg)
 {
@@ -21,14 +43,144 @@ void Print_Usage(int argc, char ** argv, const Configuration & cfg)
     fprintf(stderr, "                        detection confidence threshold (default: %.2f)\n", cfg.confThreshold);
     fprintf(stderr, "  -nms T, --nms-threshold T\n");     
     fprintf(stderr, "                        non maximum suppression threshold (default: %.2f)\n", cfg.iouThreshold);
+    fprintf(stderr, "  --max-det N\n");
+    fprintf(stderr, "                        maximum detections per image , 0 for no cap (default: %d)\n", cfg.maxDet);
+    fprintf(stderr, "  --nms-topk N\n");
+    fprintf(stderr, "                        candidates kept by score before NMS , 0 keeps all (default: %d)\n", cfg.nmsTopK);
+    fprintf(stderr, "  --agnostic-nms\n");
+    fprintf(stderr, "                        let boxes of different classes suppress each other (default: %d)\n", cfg.agnosticNMS);
+    fprintf(stderr, "  --soft-nms\n");
+    fprintf(stderr, "                        gaussian soft-NMS instead of hard suppression (default: %d)\n", cfg.softNMS);
     fprintf(stderr, "  -v , --visual\n");     
     fprintf(stderr, "                        visualiztion prediction result (default: %d)\n", cfg.doVisualize);
     fprintf(stderr, "  --cuda\n");     
     fprintf(stderr, "                        using GPUs for inference (default: %d)\n", cfg.cudaEnable);
+    fprintf(stderr, "  --io-binding\n");
+    fprintf(stderr, "                        reuse preallocated input/output tensors through Ort::IoBinding (default: %d)\n", cfg.ioBinding);
+    fprintf(stderr, "  --rect\n");
+    fprintf(stderr, "                        dynamic-shape models : pad to the next multiple of 32 instead of the full square (default: %d)\n", cfg.rectInput);
+    fprintf(stderr, "  --shape-sessions N\n");
+    fprintf(stderr, "                        with --rect , up to N sessions with the input shape pinned , one per shape (default: %d)\n", cfg.shapeSessions);
+    fprintf(stderr, "  --raw-input\n");
+    fprintf(stderr, "                        add Transpose/Cast/Div in front of the model and feed it the letterboxed uint8 frame (default: %d)\n", cfg.rawInput);
+    fprintf(stderr, "  --model-cache\n");
+    fprintf(stderr, "                        load the optimized graph cached by an earlier run , or optimize once and cache it (default: %d)\n", cfg.modelCache);
+    fprintf(stderr, "  --cache-dir FNAME\n");
+    fprintf(stderr, "                        optimized model cache dir (default: next to the model)\n");
+    fprintf(stderr, "  --warmup N\n");
+    fprintf(stderr, "                        dummy runs before the runner reports ready (default: %d)\n", cfg.warmupRuns);
+    fprintf(stderr, "  --bench-startup\n");
+    fprintf(stderr, "                        compare startup without cache , cold with cache write and cached (default: %d)\n", cfg.benchStartup);
+    fprintf(stderr, "  --mmap-model\n");
+    fprintf(stderr, "                        create sessions from a memory map of the model , one page-cache copy for every process (default: %d)\n", cfg.mmapModel);
+    fprintf(stderr, "  --share-weights\n");
+    fprintf(stderr, "                        with the mapping , sessions of this process share its weights , prepacked weights and one CPU arena (default: %d)\n", cfg.shareWeights);
+    fprintf(stderr, "  --bench-memory\n");
+    fprintf(stderr, "                        resident memory per added session , private copies against --share-weights (default: %d)\n", cfg.benchMemory);
+    fprintf(stderr, "  --dump-calibration FNAME\n");
+    fprintf(stderr, "                        write the preprocessed input of every image as .npy for tools/quantize_int8.py\n");
+    fprintf(stderr, "  --compare-model FNAME\n");
+    fprintf(stderr, "                        compare detections and latency of the model against another one , e.g. its INT8 version\n");
+    fprintf(stderr, "  --tile\n");
+    fprintf(stderr, "                        sliced inference : overlapping input-size tiles at full resolution , merged across seams (default: %d)\n", cfg.tiled);
+    fprintf(stderr, "  --tile-overlap F\n");
+    fprintf(stderr, "                        share of a tile repeated in its neighbour (default: %.2f)\n", cfg.tileOverlap);
+    fprintf(stderr, "  --tile-workers N\n");
+    fprintf(stderr, "                        threads running tiles , 1 runs them as one batch (default: %d)\n", cfg.tileWorkers);
+    fprintf(stderr, "  --tile-merge F\n");
+    fprintf(stderr, "                        intersection over the smaller box above which tile boxes are merged (default: %.2f)\n", cfg.tileMergeThreshold);
+    fprintf(stderr, "  --no-full-pass\n");
+    fprintf(stderr, "                        skip the low resolution pass over the whole image in tiled mode\n");
+    fprintf(stderr, "  --bench-tiles\n");
+    fprintf(stderr, "                        compare throughput and recall of single pass and tiled inference (default: %d)\n", cfg.benchTiles);
+    fprintf(stderr, "  --labels FNAME\n");
+    fprintf(stderr, "                        YOLO-format label dir for --bench-tiles recall , otherwise recall is measured against the single pass\n");
+    fprintf(stderr, "  -b N, --batch-size N\n");
+    fprintf(stderr, "                        images per inference run (default: %d)\n", cfg.batchSize);
+    fprintf(stderr, "  --bench-batch\n");
+    fprintf(stderr, "                        compare throughput of batched and single image inference (default: %d)\n", cfg.benchBatch);
+    fprintf(stderr, "  --check-preprocess\n");
+    fprintf(stderr, "                        compare the fused preprocess kernel against the reference path (default: %d)\n", cfg.checkPreprocess);
+    fprintf(stderr, "  --check-allocations\n");
+    fprintf(stderr, "                        count heap allocations per stage after warm-up on the IoBinding path , fail unless zero (default: %d)\n", cfg.checkAllocations);
+    fprintf(stderr, "  --bench-decode\n");
+    fprintf(stderr, "                        micro-benchmark the output decoder on a synthetic head output , no model needed (default: %d)\n", cfg.benchDecode);
+    fprintf(stderr, "  --bench-nms\n");
+    fprintf(stderr, "                        compare the NMS engine with cv::dnn::NMSBoxes on synthetic crowded scenes and check its class-aware result (default: %d)\n", cfg.benchNMS);
+    fprintf(stderr, "  --pipeline\n");
+    fprintf(stderr, "                        run decode , preprocess , inference , postprocess and output as pipelined stages (default: %d)\n", cfg.pipeline);
+    fprintf(stderr, "  --workers D,P,I,O\n");
+    fprintf(stderr, "                        pipeline workers per stage (default: %d,%d,%d,%d)\n", cfg.decodeWorkers, cfg.preprocessWorkers, cfg.inferenceWorkers, cfg.postprocessWorkers);
+    fprintf(stderr, "  --queue-size N\n");
+    fprintf(stderr, "                        capacity of each pipeline queue (default: %d)\n", cfg.queueCapacity);
+    fprintf(stderr, "  --unordered\n");
+    fprintf(stderr, "                        emit pipeline results as soon as they are ready instead of in input order\n");
+    fprintf(stderr, "  --sessions K\n");
+    fprintf(stderr, "                        sessions in the runner pool used by --bench-threads (default: %d)\n", cfg.numSessions);
+    fprintf(stderr, "  --bench-threads\n");
+    fprintf(stderr, "                        multi-threaded stress test with result check and throughput per thread count (default: %d)\n", cfg.benchThreads);
+    fprintf(stderr, "  --intra-threads N\n");
+    fprintf(stderr, "                        intra-op threads of every session , pooled or not , 0 lets onnxruntime pick (default: %d)\n", cfg.intraThreads);
+    fprintf(stderr, "  --inter-threads N\n");
+    fprintf(stderr, "                        inter-op threads per session , only used with --parallel (default: %d)\n", cfg.num_thread);
+    fprintf(stderr, "  --parallel\n");
+    fprintf(stderr, "                        parallel execution mode , independent graph branches run concurrently\n");
+    fprintf(stderr, "  --no-spin\n");
+    fprintf(stderr, "                        idle session threads sleep instead of spinning , frees cores for other work\n");
+    fprintf(stderr, "  --affinity MODE\n");
+    fprintf(stderr, "                        pin intra-op threads : none , cores (a block of processors per session) or numa (a node per session) (default: %s)\n", ThreadAffinityName(cfg.threadAffinity));
+    fprintf(stderr, "  --profile FNAME\n");
+    fprintf(stderr, "                        host profile written by --auto-tune , applied before the other flags wherever it appears (default: %s)\n", cfg.ProfilePath.c_str());
+    fprintf(stderr, "  --auto-tune\n");
+    fprintf(stderr, "                        measure threading settings on the images of --image-dir (default: assets) , write the best lone runner and runner pool settings to the host profile\n");
+    fprintf(stderr, "  --tune-seconds S\n");
+    fprintf(stderr, "                        measuring time of each --auto-tune trial (default: %.1f)\n", cfg.tuneSeconds);
     fprintf(stderr, "  -img FNAME, --image-dir FNAME\n");
     fprintf(stderr, "                        input file dir \n");
+    fprintf(stderr, "  -vid FNAME, --video FNAME\n");
+    fprintf(stderr, "                        run on a video file or stream , always inferring the newest decoded frame\n");
+    fprintf(stderr, "  --latency-budget MS\n");
+    fprintf(stderr, "                        drop video frames older than MS when inference picks them up , 0 disables (default: %.1f)\n", cfg.latencyBudgetMs);
+    fprintf(stderr, "  --video-ring N\n");
+    fprintf(stderr, "                        decoded video frames kept in the ring buffer (default: %d)\n", cfg.videoRingSize);
+    fprintf(stderr, "  --no-pace\n");
+    fprintf(stderr, "                        decode video files as fast as possible instead of at their frame rate\n");
+    fprintf(stderr, "  --frame-cache\n");
+    fprintf(stderr, "                        return the last detections for frames that did not change , video and single image mode (default: %d)\n", cfg.frameCache);
+    fprintf(stderr, "  --cache-threshold F\n");
+    fprintf(stderr, "                        mean gray level change of a frame block above which inference runs (default: %.1f)\n", cfg.frameCacheThreshold);
+    fprintf(stderr, "  --cache-max-stale N\n");
+    fprintf(stderr, "                        cached results in a row before inference runs anyway , 0 disables (default: %d)\n", cfg.frameCacheMaxStale);
+    fprintf(stderr, "  --cache-max-age MS\n");
+    fprintf(stderr, "                        age of the cached result before inference runs anyway , 0 disables (default: %.1f)\n", cfg.frameCacheMaxAgeMs);
+    fprintf(stderr, "  --check-frame-cache\n");
+    fprintf(stderr, "                        check the frame cache decisions on synthetic static and changing sequences , no model needed (default: %d)\n", cfg.checkFrameCache);
+    fprintf(stderr, "  --track\n");
+    fprintf(stderr, "                        video : detector on keyframes only , boxes and ids carried by a ByteTrack-style tracker in between (default: %d)\n", cfg.tracking);
+    fprintf(stderr, "  --track-interval N\n");
+    fprintf(stderr, "                        longest keyframe interval in frames (default: %d)\n", cfg.trackInterval);
+    fprintf(stderr, "  --fixed-interval\n");
+    fprintf(stderr, "                        run the detector every --track-interval frames instead of adapting to motion and track confidence\n");
+    fprintf(stderr, "  --track-low F\n");
+    fprintf(stderr, "                        lowest detection score the tracker associates , -conf is the high threshold (default: %.2f)\n", cfg.trackLowThreshold);
+    fprintf(stderr, "  --track-max-lost N\n");
+    fprintf(stderr, "                        frames a lost track is kept for re-identification (default: %d)\n", cfg.trackMaxLost);
+    fprintf(stderr, "  --bench-track\n");
+    fprintf(stderr, "                        on -vid : throughput and id switches of keyframe tracking against detection on every frame (default: %d)\n", cfg.benchTrack);
+    fprintf(stderr, "  --log-level LEVEL\n");
+    fprintf(stderr, "                        trace , debug , info , warn , error or off (default: %s)\n", cfg.LogLevel.c_str());
+    fprintf(stderr, "  --trace FNAME\n");
+    fprintf(stderr, "                        record preprocess / inference / postprocess spans of every thread as Chrome trace JSON\n");
     fprintf(stderr, "  -save FNAME, --save-path FNAME\n");
-    fprintf(stderr, "                        output file (default: %s)\n", cfg.SavePath.c_str());
+    fprintf(stderr, "                        write detections to this directory from a background thread (default: %s)\n", cfg.SavePath.c_str());
+    fprintf(stderr, "  --save-jsonl\n");
+    fprintf(stderr, "                        also write detections.jsonl , one JSON line per image (default: %d)\n", cfg.saveJsonl);
+    fprintf(stderr, "  --save-images\n");
+    fprintf(stderr, "                        also write annotated JPEGs , encoded off the inference thread (default: %d)\n", cfg.saveImages);
+    fprintf(stderr, "  --save-encoders N\n");
+    fprintf(stderr, "                        threads encoding annotated images (default: %d)\n", cfg.saveEncoders);
+    fprintf(stderr, "  --read-results FNAME\n");
+    fprintf(stderr, "                        map a result directory written by -save and summarize it , no model needed\n");
     fprintf(stderr, "\n");
 }
 
@@ -44,12 +196,232 @@ bool Params_Parse(int argc , char ** argv , Configuration & cfg , std::filesyste
         } else if (arg == "-nms" || arg == "--nms-threshold")
         {
             cfg.iouThreshold = std::stof(argv[++i]);
+        } else if (arg == "--max-det")
+        {
+            cfg.maxDet = std::stoi(argv[++i]);
+        } else if (arg == "--nms-topk")
+        {
+            cfg.nmsTopK = std::stoi(argv[++i]);
+        } else if (arg == "--agnostic-nms")
+        {
+            cfg.agnosticNMS = true;
+        } else if (arg == "--soft-nms")
+        {
+            cfg.softNMS = true;
+        } else if (arg == "--bench-nms")
+        {
+            cfg.benchNMS = true;
+        } else if (arg == "--io-binding")
+        {
+            cfg.ioBinding = true;
+        } else if (arg == "--rect")
+        {
+            cfg.rectInput = true;
+        } else if (arg == "--shape-sessions")
+        {
+            cfg.shapeSessions = std::max(0 , std::stoi(argv[++i]));
+        } else if (arg == "--raw-input")
+        {
+            cfg.rawInput = true;
+        } else if (arg == "--model-cache")
+        {
+            cfg.modelCache = true;
+        } else if (arg == "--cache-dir")
+        {
+            cfg.CacheDir = argv[++i];
+        } else if (arg == "--warmup")
+        {
+            cfg.warmupRuns = std::max(0 , std::stoi(argv[++i]));
+        } else if (arg == "--bench-startup")
+        {
+            cfg.benchStartup = true;
+        } else if (arg == "--mmap-model")
+        {
+            cfg.mmapModel = true;
+        } else if (arg == "--share-weights")
+        {
+            cfg.shareWeights = true;
+        } else if (arg == "--bench-memory")
+        {
+            cfg.benchMemory = true;
+        } else if (arg == "--dump-calibration")
+        {
+            cfg.CalibrationDir = argv[++i];
+        } else if (arg == "--compare-model")
+        {
+            cfg.CompareModelPath = argv[++i];
+        } else if (arg == "--tile")
+        {
+            cfg.tiled = true;
+        } else if (arg == "--tile-overlap")
+        {
+            cfg.tileOverlap = std::min(std::max(std::stof(argv[++i]) , 0.0f) , 0.9f);
+        } else if (arg == "--tile-workers")
+        {
+            cfg.tileWorkers = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--tile-merge")
+        {
+            cfg.tileMergeThreshold = std::stof(argv[++i]);
+        } else if (arg == "--no-full-pass")
+        {
+            cfg.tileFullPass = false;
+        } else if (arg == "--bench-tiles")
+        {
+            cfg.benchTiles = true;
+        } else if (arg == "--labels")
+        {
+            cfg.LabelDir = argv[++i];
+        } else if (arg == "-b" || arg == "--batch-size")
+        {
+            cfg.batchSize = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--bench-batch")
+        {
+            cfg.benchBatch = true;
+        } else if (arg == "--check-preprocess")
+        {
+            cfg.checkPreprocess = true;
+        } else if (arg == "--check-allocations")
+        {
+            cfg.checkAllocations = true;
+        } else if (arg == "--bench-decode")
+        {
+            cfg.benchDecode = true;
+        } else if (arg == "--pipeline")
+        {
+            cfg.pipeline = true;
+        } else if (arg == "--workers")
+        {
+            int32_t* stageWorkers[4] = { &cfg.decodeWorkers , &cfg.preprocessWorkers , &cfg.inferenceWorkers , &cfg.postprocessWorkers };
+            std::stringstream workers(argv[++i]);
+            std::string count;
+            for (int stage = 0 ; stage < 4 && std::getline(workers , count , ',') ; stage++)
+            {
+                *stageWorkers[stage] = std::max(1 , std::stoi(count));
+            }
+        } else if (arg == "--queue-size")
+        {
+            cfg.queueCapacity = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--unordered")
+        {
+            cfg.orderedOutput = false;
+        } else if (arg == "--sessions")
+        {
+            int sessions = std::max(1 , std::stoi(argv[++i]));
+            // The pool threading of the profile was measured for its own session count
+            cfg.poolIntraThreads = sessions == cfg.numSessions ? cfg.poolIntraThreads : 0;
+            cfg.numSessions = sessions;
+        } else if (arg == "--bench-threads")
+        {
+            cfg.benchThreads = true;
+        } else if (arg == "--intra-threads")
+        {
+            cfg.intraThreads = std::max(0 , std::stoi(argv[++i]));
+            cfg.poolIntraThreads = 0; // Every session , pooled or not
+        } else if (arg == "--inter-threads")
+        {
+            cfg.num_thread = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--parallel")
+        {
+            cfg.parallelExecution = true;
+        } else if (arg == "--no-spin")
+        {
+            cfg.allowSpinning = false;
+        } else if (arg == "--affinity")
+        {
+            std::string mode = argv[++i];
+            if (!ParseThreadAffinity(mode , cfg.threadAffinity))
+            {
+                fprintf(stderr , "[ERROR] : Unknown affinity : %s , use none , cores or numa\n" , mode.c_str());
+                return EXIT_FAILURE;
+            }
+            cfg.poolAffinity = cfg.threadAffinity;
+        } else if (arg == "--profile")
+        {
+            // Loaded by LoadHostProfileArgs before the other flags
+            cfg.ProfilePath = argv[++i];
+        } else if (arg == "--auto-tune")
+        {
+            cfg.autoTune = true;
+        } else if (arg == "--tune-seconds")
+        {
+            cfg.tuneSeconds = std::max(0.5 , std::stod(argv[++i]));
         } else if (arg == "-img" || arg == "--image-dir")
         {
             image_dir = argv[++i];
+        } else if (arg == "-vid" || arg == "--video")
+        {
+            cfg.VideoPath = argv[++i];
+        } else if (arg == "--latency-budget")
+        {
+            cfg.latencyBudgetMs = std::max(0.0 , std::stod(argv[++i]));
+        } else if (arg == "--video-ring")
+        {
+            cfg.videoRingSize = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--no-pace")
+        {
+            cfg.paceVideo = false;
+        } else if (arg == "--frame-cache")
+        {
+            cfg.frameCache = true;
+        } else if (arg == "--cache-threshold")
+        {
+            cfg.frameCacheThreshold = std::max(0.0f , std::stof(argv[++i]));
+        } else if (arg == "--cache-max-stale")
+        {
+            cfg.frameCacheMaxStale = std::max(0 , std::stoi(argv[++i]));
+        } else if (arg == "--cache-max-age")
+        {
+            cfg.frameCacheMaxAgeMs = std::max(0.0 , std::stod(argv[++i]));
+        } else if (arg == "--check-frame-cache")
+        {
+            cfg.checkFrameCache = true;
+        } else if (arg == "--track")
+        {
+            cfg.tracking = true;
+        } else if (arg == "--track-interval")
+        {
+            cfg.trackInterval = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--fixed-interval")
+        {
+            cfg.trackAdaptive = false;
+        } else if (arg == "--track-low")
+        {
+            cfg.trackLowThreshold = std::max(0.0f , std::stof(argv[++i]));
+        } else if (arg == "--track-max-lost")
+        {
+            cfg.trackMaxLost = std::max(0 , std::stoi(argv[++i]));
+        } else if (arg == "--bench-track")
+        {
+            cfg.benchTrack = true;
+        } else if (arg == "--log-level")
+        {
+            cfg.LogLevel = argv[++i];
+            if (Logger::ParseLevel(cfg.LogLevel) < 0)
+            {
+                fprintf(stderr , "[ERROR] : Unknown log level : %s\n" , cfg.LogLevel.c_str());
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--trace")
+        {
+            cfg.TracePath = argv[++i];
         } else if (arg == "-save" || arg == "--save-path")
         {
-            cfg.SavePath = std::stof(argv[++i]);
+            cfg.SavePath = argv[++i];
+            cfg.saveResults = true;
+        } else if (arg == "--save-jsonl")
+        {
+            cfg.saveResults = true;
+            cfg.saveJsonl = true;
+        } else if (arg == "--save-images")
+        {
+            cfg.saveResults = true;
+            cfg.saveImages = true;
+        } else if (arg == "--save-encoders")
+        {
+            cfg.saveEncoders = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--read-results")
+        {
+            cfg.ReadResultsPath = argv[++i];
         } else if (arg == "-v" || arg == "--visual")
         {
             cfg.doVisualize = true;
@@ -71,35 +443,1668 @@ bool Params_Parse(int argc , char ** argv , Configuration & cfg , std::filesyste
 }
 
 
-int main(int argc , char *argv[])
+void Visualize_Result(YOLOv8OnnxRunner& Detector , cv::Mat& srcImage , const std::vector<DETECT_RESULT>& result)
 {
-    std::filesystem::path image_dir;
-    Configuration cfg;
+    // Drawn on a copy , the result writer may still be encoding srcImage
+    cv::Mat visualImage = Detector.VisualizationPredicition(srcImage.clone() , result);
 
-    if (Params_Parse(argc , argv , cfg , image_dir))
+    LOG_INFO("Press any key to exit");
+    cv::imshow("YOLOv8Detect Result" , visualImage);
+    cv::waitKey(0);
+    cv::destroyAllWindows();
+}
+
+void Benchmark_Batch(YOLOv8OnnxRunner& Detector , const std::vector<cv::Mat>& images , int32_t batchSize)
+{
+    if (images.empty())
+    {
+        fprintf(stderr, "[ERROR] : No image found for benchmark\n");
+        return;
+    }
+    // Warm up once so the first session->Run does not land in either measurement
+    Detector.InferenceSingleImage(images.front());
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+    for (auto& image : images)
+    {
+        Detector.InferenceSingleImage(image);
+    }
+    auto time_end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> singleCost = time_end - time_start;
+
+    time_start = std::chrono::high_resolution_clock::now();
+    for (size_t begin = 0 ; begin < images.size() ; begin += batchSize)
+    {
+        size_t end = std::min(images.size() , begin + batchSize);
+        Detector.InferenceBatch(std::vector<cv::Mat>(images.begin() + begin , images.begin() + end));
+    }
+    time_end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> batchCost = time_end - time_start;
+
+    fprintf(stdout, "[BENCH] images : %zu\n", images.size());
+    fprintf(stdout, "[BENCH] single image loop : %.3fs , %.2f images/s\n", singleCost.count(), images.size() / singleCost.count());
+    fprintf(stdout, "[BENCH] batch size %d      : %.3fs , %.2f images/s\n", batchSize, batchCost.count(), images.size() / batchCost.count());
+}
+
+void Benchmark_Decode()
+{
+    // Synthetic [84 , 8400] head : class scores skewed towards 0 like a real sigmoid output
+    const int numClasses = 80 , numChannels = 4 + numClasses , numAnchors = 8400 , iterations = 200;
+    std::vector<float> output((size_t)numChannels * numAnchors);
+    cv::RNG rng(12345);
+    for (int c = 0 ; c < numChannels ; c++)
+    {
+        for (int a = 0 ; a < numAnchors ; a++)
+        {
+            float u = (float)rng.uniform(0.0 , 1.0);
+            output[(size_t)c * numAnchors + a] = c < 4 ? 640.0f * u : std::pow(u , 12.0f);
+        }
+    }
+
+    const float thresholds[] = { 0.01f , 0.1f , 0.25f , 0.5f , 0.75f };
+    fprintf(stdout, "[BENCH] decoder kernel : %s , %d iterations\n", DecoderKernelName(), iterations);
+    for (float threshold : thresholds)
+    {
+        DECODE_CANDIDATES reference , candidates;
+        auto time_start = std::chrono::high_resolution_clock::now();
+        for (int i = 0 ; i < iterations ; i++)
+        {
+            reference.clear();
+            DecodeCandidatesReference(output.data() , numChannels , numAnchors , numClasses , threshold , reference);
+        }
+        auto time_mid = std::chrono::high_resolution_clock::now();
+        for (int i = 0 ; i < iterations ; i++)
+        {
+            candidates.clear();
+            DecodeCandidates(output.data() , numChannels , numAnchors , numClasses , threshold , candidates);
+        }
+        auto time_end = std::chrono::high_resolution_clock::now();
+
+        std::chrono::duration<double , std::milli> referenceCost = time_mid - time_start;
+        std::chrono::duration<double , std::milli> decodeCost = time_end - time_mid;
+        bool match = reference.anchors == candidates.anchors && reference.classIds == candidates.classIds;
+        fprintf(stdout, "[BENCH] conf %.2f : candidates %zu , transpose+minMaxLoc %.3fms , in place %.3fms , speedup %.1fx , match %d\n",
+            threshold, candidates.size(), referenceCost.count() / iterations, decodeCost.count() / iterations,
+            referenceCost.count() / decodeCost.count(), match);
+    }
+}
+
+// Class-aware reference : cv::dnn::NMSBoxes on every class separately , kept indices in ascending order
+std::vector<int> Reference_Class_NMS(const NMS_BOXES& boxes , float iouThreshold)
+{
+    std::map<int , std::vector<int>> members;
+    for (size_t i = 0 ; i < boxes.size() ; i++)
+    {
+        members[boxes.classIds[i]].push_back((int)i);
+    }
+    std::vector<int> keep;
+    for (auto& cls : members)
+    {
+        std::vector<cv::Rect2d> rects;
+        std::vector<float> scores;
+        for (int idx : cls.second)
+        {
+            rects.emplace_back(boxes.x1[idx] , boxes.y1[idx] , boxes.x2[idx] - boxes.x1[idx] , boxes.y2[idx] - boxes.y1[idx]);
+            scores.push_back(boxes.scores[idx]);
+        }
+        std::vector<int> classKeep;
+        cv::dnn::NMSBoxes(rects , scores , 0.0f , iouThreshold , classKeep);
+        for (int k : classKeep)
+        {
+            keep.push_back(cls.second[k]);
+        }
+    }
+    std::sort(keep.begin() , keep.end());
+    return keep;
+}
+
+// Class-aware NMSEngine without caps against the reference , true when both keep the same boxes
+bool Check_Class_NMS(const char* name , const NMS_BOXES& boxes , float iouThreshold)
+{
+    NMSEngine engine;
+    NMS_CONFIG config;
+    config.iouThreshold = iouThreshold;
+    config.topK = 0;
+    config.maxDet = 0;
+    std::vector<int> keep;
+    engine.Run(boxes , config , keep);
+    std::sort(keep.begin() , keep.end());
+    std::vector<int> reference = Reference_Class_NMS(boxes , iouThreshold);
+    bool same = keep == reference;
+    fprintf(stdout, "[CHECK] class-aware %-24s : keep %zu , reference %zu , %s\n", name, keep.size(), reference.size(),
+        same ? "same boxes" : "MISMATCH");
+    return same;
+}
+
+int Benchmark_NMS(const Configuration& cfg)
+{
+    bool passed = true;
+    // Crowded synthetic scenes : candidates clustered around a few hundred objects of 3 classes
+    const int candidateCounts[] = { 1000 , 2000 , 5000 , 10000 };
+    const int iterations = 20;
+    cv::RNG rng(12345);
+
+    for (int count : candidateCounts)
+    {
+        NMS_BOXES boxes;
+        std::vector<cv::Rect> rects;
+        int objects = count / 10;
+        for (int i = 0 ; i < count ; i++)
+        {
+            int object = rng.uniform(0 , objects);
+            float cx = 20.0f + (object * 37) % 1880 + (float)rng.uniform(-6.0 , 6.0);
+            float cy = 20.0f + (object * 53) % 1040 + (float)rng.uniform(-6.0 , 6.0);
+            float w = 40.0f + (object % 7) * 6.0f + (float)rng.uniform(-4.0 , 4.0);
+            float h = 90.0f + (object % 5) * 10.0f + (float)rng.uniform(-8.0 , 8.0);
+            float score = (float)rng.uniform(cfg.confThreshold , 1.0f);
+            boxes.push_back(cx - w / 2 , cy - h / 2 , cx + w / 2 , cy + h / 2 , score , object % 3);
+            rects.emplace_back(int(cx - w / 2) , int(cy - h / 2) , int(w) , int(h));
+        }
+
+        std::vector<int> keep;
+        auto time_start = std::chrono::high_resolution_clock::now();
+        for (int i = 0 ; i < iterations ; i++)
+        {
+            cv::dnn::NMSBoxes(rects , boxes.scores , cfg.confThreshold , cfg.iouThreshold , keep);
+        }
+        auto time_end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double , std::milli> opencvCost = time_end - time_start;
+        size_t opencvKeep = keep.size();
+
+        NMSEngine engine;
+        NMS_CONFIG configs[3];
+        const char* names[3] = { "agnostic" , "class-aware" , "class-aware max_det" };
+        configs[0].classAgnostic = true;
+        configs[0].maxDet = 0;
+        configs[1].maxDet = 0;
+        configs[2].maxDet = cfg.maxDet;
+        fprintf(stdout, "[BENCH] %d candidates : cv::dnn::NMSBoxes %.3fms , keep %zu\n", count, opencvCost.count() / iterations, opencvKeep);
+        for (int c = 0 ; c < 3 ; c++)
+        {
+            configs[c].iouThreshold = cfg.iouThreshold;
+            configs[c].topK = cfg.nmsTopK;
+            time_start = std::chrono::high_resolution_clock::now();
+            for (int i = 0 ; i < iterations ; i++)
+            {
+                engine.Run(boxes , configs[c] , keep);
+            }
+            time_end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double , std::milli> engineCost = time_end - time_start;
+            fprintf(stdout, "[BENCH]   NMSEngine %-20s %.3fms , keep %zu , speedup %.1fx\n", names[c],
+                engineCost.count() / iterations, keep.size(), opencvCost.count() / engineCost.count());
+        }
+        passed &= Check_Class_NMS((std::to_string(count) + " candidates").c_str() , boxes , cfg.iouThreshold);
+    }
+
+    /* Decoded boxes are not clamped , objects cut by the image border have negative corners. Boxes in
+       the bottom right corner of a 640x640 image and boxes of the next class mostly outside the top
+       left one : an offset of max corner + 1 per class would move the latter onto the former. */
+    {
+        NMS_BOXES boxes;
+        for (int i = 0 ; i < 200 ; i++)
+        {
+            float w = (float)rng.uniform(40.0 , 120.0);
+            float cut = w * (float)rng.uniform(0.7 , 0.95);
+            int classId = rng.uniform(0 , 3);
+            boxes.push_back(640.0f - w , 640.0f - w , 640.0f , 640.0f , (float)rng.uniform(cfg.confThreshold , 1.0f) , classId);
+            boxes.push_back(-cut , -cut , w - cut , w - cut , (float)rng.uniform(cfg.confThreshold , 1.0f) , (classId + 1) % 3);
+        }
+        passed &= Check_Class_NMS("boxes across the border" , boxes , cfg.iouThreshold);
+    }
+    fprintf(stdout, "[CHECK] class-aware NMS %s\n", passed ? "passed" : "FAILED");
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+bool Same_Result(const std::vector<DETECT_RESULT>& a , const std::vector<DETECT_RESULT>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0 ; i < a.size() ; i++)
+    {
+        if (a[i].classId != b[i].classId || std::abs(a[i].confidence - b[i].confidence) > 1e-3f || \
+            std::abs(a[i].box.x - b[i].box.x) > 1 || std::abs(a[i].box.y - b[i].box.y) > 1 || \
+            std::abs(a[i].box.width - b[i].box.width) > 1 || std::abs(a[i].box.height - b[i].box.height) > 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int Benchmark_Threads(const Configuration& cfg , const std::vector<cv::Mat>& images)
+{
+    if (images.empty())
     {
+        fprintf(stderr, "[ERROR] : No image found for benchmark\n");
         return EXIT_FAILURE;
     }
-    
-    YOLOv8OnnxRunner Detector(cfg);
+    RunnerPool pool(cfg , cfg.numSessions);
 
-    for (auto& i : std::filesystem::directory_iterator(image_dir))
+    // Single threaded reference , also warms up every session
+    std::vector<std::vector<DETECT_RESULT>> reference;
+    for (auto& image : images)
     {
-        if (i.path().extension() == ".jpg" || i.path().extension() == ".png" || i.path().extension() == ".jpeg")
+        reference.emplace_back(pool.InferenceSingleImage(image));
+    }
+    for (size_t i = 1 ; i < pool.Size() ; i++)
+    {
+        pool.InferenceSingleImage(images[i % images.size()]);
+    }
+
+    int maxThreads = std::max(1 , (int)std::thread::hardware_concurrency());
+    int perThread = std::max(16 , (int)images.size());
+    size_t totalMismatch = 0;
+    for (int threads = 1 ; ; threads = std::min(threads * 2 , maxThreads))
+    {
+        std::atomic<size_t> mismatch(0);
+        std::vector<std::thread> workers;
+        auto time_start = std::chrono::high_resolution_clock::now();
+        for (int t = 0 ; t < threads ; t++)
         {
-            cv::Mat srcImage = cv::imread(i.path().string());
-            auto result = Detector.InferenceSingleImage(srcImage);
-            if (cfg.doVisualize)
+            workers.emplace_back([&, t]()
+            {
+                for (int i = 0 ; i < perThread ; i++)
+                {
+                    size_t idx = (size_t)(t + i) % images.size();
+                    if (!Same_Result(pool.InferenceSingleImage(images[idx]) , reference[idx]))
+                    {
+                        mismatch++;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        auto time_end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> cost = time_end - time_start;
+
+        size_t total = (size_t)threads * perThread;
+        totalMismatch += mismatch;
+        fprintf(stdout, "[BENCH] sessions %zu , threads %2d : %zu images in %.3fs , %.2f images/s , mismatches %zu\n",
+            pool.Size(), threads, total, cost.count(), total / cost.count(), mismatch.load());
+        if (threads == maxThreads)
+        {
+            break;
+        }
+    }
+
+    auto counts = pool.DispatchCounts();
+    for (size_t i = 0 ; i < counts.size() ; i++)
+    {
+        fprintf(stdout, "[BENCH] session %zu handled %llu requests\n", i, (unsigned long long)counts[i]);
+    }
+    return totalMismatch == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// A setting is only kept when it beats the best so far by more than run-to-run noise
+static const double TUNE_MARGIN = 0.03;
+
+typedef struct _TUNE_TRIAL
+{
+    Configuration cfg;
+    double imagesPerSecond = 0.0;
+    double p50Ms = 0.0;
+} TUNE_TRIAL;
+
+// Settings every session of the trial runs with
+std::string Tune_Label(const Configuration& cfg)
+{
+    Configuration sessionCfg = PoolSessionConfig(cfg , cfg.numSessions , 0);
+    char label[160];
+    snprintf(label , sizeof(label) , "sessions %d , intra %2d , inter %d , %-10s , spin %-3s , affinity %s" , \
+        cfg.numSessions , sessionCfg.intraThreads , sessionCfg.num_thread , sessionCfg.parallelExecution ? "parallel" : "sequential" , \
+        sessionCfg.allowSpinning ? "on" : "off" , ThreadAffinityName(sessionCfg.threadAffinity));
+    return label;
+}
+
+// One client thread per session sends images back to back for cfg.tuneSeconds , after two untimed warm-up runs each
+TUNE_TRIAL Tune_Trial(const Configuration& cfg , const std::vector<cv::Mat>& images)
+{
+    TUNE_TRIAL trial;
+    trial.cfg = cfg;
+    RunnerPool pool(cfg , cfg.numSessions);
+    int threads = (int)pool.Size();
+
+    std::atomic<int> ready(0);
+    std::vector<LatencyRecorder> latency(threads);
+    std::vector<double> elapsed(threads , 0.0);
+    std::vector<std::thread> workers;
+    for (int t = 0 ; t < threads ; t++)
+    {
+        workers.emplace_back([& , t]()
+        {
+            for (int i = 0 ; i < 2 ; i++)
+            {
+                pool.InferenceSingleImage(images[(size_t)(t + i) % images.size()]);
+            }
+            // Every client starts measuring together , so no session runs alone on an idle machine
+            ready++;
+            while (ready.load() < threads)
+            {
+                std::this_thread::yield();
+            }
+            auto time_start = std::chrono::high_resolution_clock::now();
+            for (size_t i = t ; elapsed[t] < cfg.tuneSeconds ; i++)
             {
-                cv::Mat visualImage = Detector.VisualizationPredicition(srcImage , result);
-                
-                std::cout << "[OPERATION] Press any key to exit" << std::endl;
-                cv::imshow("YOLOv8Detect Result" , visualImage);
-                cv::waitKey(0);
-                cv::destroyAllWindows();
+                auto run_start = std::chrono::high_resolution_clock::now();
+                pool.InferenceSingleImage(images[i % images.size()]);
+                auto run_end = std::chrono::high_resolution_clock::now();
+                latency[t].Add(std::chrono::duration<double , std::milli>(run_end - run_start).count());
+                elapsed[t] = std::chrono::duration<double>(run_end - time_start).count();
             }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    LatencyRecorder all;
+    for (auto& recorder : latency)
+    {
+        all.Append(recorder);
+    }
+    trial.imagesPerSecond = all.Count() / *std::max_element(elapsed.begin() , elapsed.end());
+    trial.p50Ms = all.Percentile(50);
+    fprintf(stdout, "[TUNE] %s : %.2f images/s , p50 %.2fms\n", Tune_Label(cfg).c_str(), trial.imagesPerSecond, trial.p50Ms);
+    return trial;
+}
+
+/*
+    Staged search instead of the full grid , which would take hours on a large machine : every
+    stage changes one setting of the best configuration so far and keeps a change only when the
+    throughput improves by more than TUNE_MARGIN.
+    A lone runner , what every path but the runner pools uses :
+      1. intra-op threads : 1 , 2 , 4 ... logical processors
+      2. parallel execution with 2 and 4 inter-op threads
+      3. spinning off
+      4. pinning : cores , and numa on a host with several nodes
+    A RunnerPool , starting from the lone runner , one client thread per session :
+      5. 2 , 4 , 8 sessions sharing the processors
+      6. pinning of the pool sessions
+    Both winners are written to the profile , a lone runner never runs with a pool session's share
+    of the processors. The p50 is reported alongside the throughput.
+*/
+int Auto_Tune(const Configuration& cfg , const std::vector<cv::Mat>& images)
+{
+    if (images.empty())
+    {
+        fprintf(stderr, "[ERROR] : No image found for --auto-tune\n");
+        return EXIT_FAILURE;
+    }
+    const HOST_TOPOLOGY& topology = GetHostTopology();
+    int processors = topology.logicalProcessors;
+    fprintf(stdout, "[TUNE] host %s : %d logical processors , %zu NUMA nodes , %.1fs per trial\n",
+        GetHostName().c_str(), processors, topology.nodes.size(), cfg.tuneSeconds);
+
+    // Session creation logs a dozen lines per trial
+    int logLevel = Logger::Level();
+    Logger::SetLevel(std::max(logLevel , LOG_LEVEL_WARN));
+
+    Configuration base = cfg;
+    base.num_thread = 1;
+    base.parallelExecution = false;
+    base.allowSpinning = true;
+    base.threadAffinity = AFFINITY_NONE;
+    base.numSessions = 1;
+    base.poolIntraThreads = 0;
+    base.poolAffinity = AFFINITY_NONE;
+
+    TUNE_TRIAL best;
+    auto consider = [&](const Configuration& candidate)
+    {
+        TUNE_TRIAL trial = Tune_Trial(candidate , images);
+        if (best.imagesPerSecond <= 0.0 || trial.imagesPerSecond > best.imagesPerSecond * (1.0 + TUNE_MARGIN))
+        {
+            best = trial;
+        }
+    };
+    std::vector<THREAD_AFFINITY> affinities = { AFFINITY_CORES };
+    if (topology.nodes.size() > 1)
+    {
+        affinities.push_back(AFFINITY_NUMA);
+    }
+
+    fprintf(stdout, "[TUNE] lone runner\n");
+    std::set<int> intraCounts = { processors / 2 , processors };
+    for (int n = 1 ; n < processors ; n *= 2)
+    {
+        intraCounts.insert(n);
+    }
+    intraCounts.erase(0);
+    for (int n : intraCounts)
+    {
+        Configuration candidate = base;
+        candidate.intraThreads = n;
+        consider(candidate);
+    }
+
+    for (int inter : { 2 , 4 })
+    {
+        if (inter <= processors)
+        {
+            Configuration candidate = best.cfg;
+            candidate.parallelExecution = true;
+            candidate.num_thread = inter;
+            consider(candidate);
+        }
+    }
+
+    {
+        Configuration candidate = best.cfg;
+        candidate.allowSpinning = false;
+        consider(candidate);
+    }
+
+    if (best.cfg.intraThreads > 1)
+    {
+        TUNE_TRIAL unpinned = best;
+        for (THREAD_AFFINITY affinity : affinities)
+        {
+            Configuration candidate = unpinned.cfg;
+            candidate.threadAffinity = affinity;
+            consider(candidate);
+        }
+    }
+    TUNE_TRIAL single = best;
+
+    // The lone runner is the first pool candidate : one session , one client
+    fprintf(stdout, "[TUNE] runner pool\n");
+    for (int sessions : { 2 , 4 , 8 })
+    {
+        if (sessions <= processors)
+        {
+            Configuration candidate = single.cfg;
+            candidate.numSessions = sessions;
+            candidate.poolIntraThreads = std::max(1 , processors / sessions);
+            consider(candidate);
+        }
+    }
+
+    if (best.cfg.numSessions > 1 && best.cfg.poolIntraThreads > 1)
+    {
+        TUNE_TRIAL unpinned = best;
+        for (THREAD_AFFINITY affinity : affinities)
+        {
+            Configuration candidate = unpinned.cfg;
+            candidate.poolAffinity = affinity;
+            consider(candidate);
+        }
+    }
+    Logger::SetLevel(logLevel);
+
+    char comment[512];
+    time_t now = time(nullptr);
+    char date[32];
+    strftime(date , sizeof(date) , "%Y-%m-%d %H:%M" , localtime(&now));
+    snprintf(comment , sizeof(comment) , "Written by --auto-tune on %s , model %s , %.1fs per trial\n" \
+        "lone runner : %s : %.2f images/s , p50 %.2fms\nrunner pool : %s : %.2f images/s , p50 %.2fms" , \
+        date , cfg.ModelPath.c_str() , cfg.tuneSeconds , Tune_Label(single.cfg).c_str() , single.imagesPerSecond , \
+        single.p50Ms , Tune_Label(best.cfg).c_str() , best.imagesPerSecond , best.p50Ms);
+    fprintf(stdout, "[TUNE] best lone runner : %s : %.2f images/s , p50 %.2fms\n", Tune_Label(single.cfg).c_str(),
+        single.imagesPerSecond, single.p50Ms);
+    fprintf(stdout, "[TUNE] best runner pool : %s : %.2f images/s , p50 %.2fms\n", Tune_Label(best.cfg).c_str(),
+        best.imagesPerSecond, best.p50Ms);
+    // best only differs from single in the pool settings
+    if (!SaveHostProfile(cfg.ProfilePath , best.cfg , comment))
+    {
+        fprintf(stderr, "[ERROR] : Failed to write %s\n", cfg.ProfilePath.c_str());
+        return EXIT_FAILURE;
+    }
+    fprintf(stdout, "[TUNE] profile written to %s , loaded at startup by YOLOv8Runner , the server and the benchmark : " \
+        "single runner paths use the lone runner settings , runner pools (--bench-threads , the server , the benchmark " \
+        "thread scenarios) the pool settings unless --sessions asks for another session count\n", cfg.ProfilePath.c_str());
+    return EXIT_SUCCESS;
+}
+
+// float32 .npy (format 1.0) , what numpy.load and the calibration reader expect
+bool Write_Npy(const std::filesystem::path& path , const float* data , const std::vector<int64_t>& shape)
+{
+    std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (";
+    size_t count = 1;
+    for (auto dim : shape)
+    {
+        header += std::to_string(dim) + ", ";
+        count *= (size_t)dim;
+    }
+    header += "), }";
+    // Magic (6) + version (2) + header length (2) + header , padded with spaces to 64 bytes and ended by \n
+    size_t total = 10 + header.size() + 1;
+    header.append((64 - total % 64) % 64 , ' ');
+    header += '\n';
+
+    FILE* file = fopen(path.string().c_str() , "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    const char magic[8] = { '\x93' , 'N' , 'U' , 'M' , 'P' , 'Y' , 1 , 0 };
+    uint16_t headerLength = (uint16_t)header.size();
+    fwrite(magic , 1 , sizeof(magic) , file);
+    fwrite(&headerLength , sizeof(headerLength) , 1 , file);
+    fwrite(header.data() , 1 , header.size() , file);
+    size_t written = fwrite(data , sizeof(float) , count , file);
+    fclose(file);
+    return written == count;
+}
+
+int Dump_Calibration(YOLOv8OnnxRunner& Detector , const std::vector<std::filesystem::path>& image_paths , \
+    const std::filesystem::path& outputDir)
+{
+    std::error_code error;
+    std::filesystem::create_directories(outputDir , error);
+    // Same letterbox / normalize as inference , so the ranges seen by the calibrator match deployment
+    REQUEST_CONTEXT ctx;
+    size_t written = 0;
+    for (auto& path : image_paths)
+    {
+        cv::Mat srcImage = cv::imread(path.string());
+        if (srcImage.empty())
+        {
+            continue;
         }
+        Detector.PreprocessStage(srcImage , ctx);
+        // Rect mode tensors differ per aspect ratio
+        std::vector<int64_t> shape = { 1 , 3 , ctx.inputShape.height , ctx.inputShape.width };
+        std::filesystem::path npyPath = outputDir / (path.stem().string() + ".npy");
+        if (!Write_Npy(npyPath , ctx.input_image.data() , shape))
+        {
+            fprintf(stderr, "[ERROR] : Failed to write %s\n", npyPath.string().c_str());
+            return EXIT_FAILURE;
+        }
+        written++;
+    }
+    cv::Size inputSize = Detector.GetInputSize();
+    fprintf(stdout, "[CALIB] %zu tensors of up to %dx%d written to %s\n", written, inputSize.width, inputSize.height, outputDir.string().c_str());
+    return EXIT_SUCCESS;
+}
+
+float Box_IoU(const cv::Rect& a , const cv::Rect& b)
+{
+    float inter = (float)(a & b).area();
+    float uni = (float)(a.area() + b.area()) - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+int Compare_Models(Configuration cfg , const std::vector<std::filesystem::path>& image_paths)
+{
+    std::vector<cv::Mat> images;
+    for (auto& path : image_paths)
+    {
+        images.emplace_back(cv::imread(path.string()));
+    }
+    if (images.empty())
+    {
+        fprintf(stderr, "[ERROR] : No image found for comparison\n");
+        return EXIT_FAILURE;
+    }
+
+    // Detections of both models on every image , with per-image latency after one warm-up frame
+    const int repeats = 5;
+    std::string modelPaths[2] = { cfg.ModelPath , cfg.CompareModelPath };
+    std::vector<std::vector<DETECT_RESULT>> results[2];
+    LatencyRecorder latency[2];
+    for (int m = 0 ; m < 2 ; m++)
+    {
+        cfg.ModelPath = modelPaths[m];
+        YOLOv8OnnxRunner Detector(cfg);
+        REQUEST_CONTEXT ctx;
+        Detector.InferenceSingleImage(images.front() , ctx);
+        for (auto& image : images)
+        {
+            for (int r = 0 ; r < repeats ; r++)
+            {
+                auto time_start = std::chrono::high_resolution_clock::now();
+                auto result = Detector.InferenceSingleImage(image , ctx);
+                latency[m].Add(std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_start).count());
+                if (r == 0)
+                {
+                    results[m].emplace_back(std::move(result));
+                }
+            }
+        }
+    }
+
+    // Greedy same-class matching at IoU 0.5 , the first model is the reference
+    size_t reference = 0 , candidate = 0 , matched = 0;
+    double iouSum = 0.0 , scoreDiffSum = 0.0;
+    for (size_t i = 0 ; i < images.size() ; i++)
+    {
+        const auto& a = results[0][i];
+        const auto& b = results[1][i];
+        std::vector<bool> used(b.size() , false);
+        reference += a.size();
+        candidate += b.size();
+        for (const auto& det : a)
+        {
+            int best = -1;
+            float bestIoU = 0.5f;
+            for (size_t j = 0 ; j < b.size() ; j++)
+            {
+                float iou = Box_IoU(det.box , b[j].box);
+                if (!used[j] && b[j].classId == det.classId && iou >= bestIoU)
+                {
+                    best = (int)j;
+                    bestIoU = iou;
+                }
+            }
+            if (best >= 0)
+            {
+                used[best] = true;
+                matched++;
+                iouSum += bestIoU;
+                scoreDiffSum += std::abs(det.confidence - b[best].confidence);
+            }
+        }
+    }
+
+    fprintf(stdout, "[COMPARE] images : %zu , reference %s , candidate %s\n", images.size(), modelPaths[0].c_str(), modelPaths[1].c_str());
+    fprintf(stdout, "[COMPARE] detections : reference %zu , candidate %zu , matched %zu\n", reference, candidate, matched);
+    fprintf(stdout, "[COMPARE] recall vs reference %.3f , precision vs reference %.3f , mean IoU %.3f , mean |score diff| %.4f\n",
+        reference > 0 ? (double)matched / reference : 1.0, candidate > 0 ? (double)matched / candidate : 1.0,
+        matched > 0 ? iouSum / matched : 0.0, matched > 0 ? scoreDiffSum / matched : 0.0);
+    for (int m = 0 ; m < 2 ; m++)
+    {
+        fprintf(stdout, "[COMPARE] %-9s latency p50 %.2fms , p90 %.2fms , p99 %.2fms , mean %.2fms\n", m == 0 ? "reference" : "candidate",
+            latency[m].Percentile(50), latency[m].Percentile(90), latency[m].Percentile(99), latency[m].Mean());
+    }
+    fprintf(stdout, "[COMPARE] speedup (p50) : %.2fx\n", latency[1].Percentile(50) > 0 ? latency[0].Percentile(50) / latency[1].Percentile(50) : 0.0);
+    return EXIT_SUCCESS;
+}
+
+void Benchmark_Startup(Configuration cfg)
+{
+    // Same process for all three , so the model file is in the OS cache for every pass
+    std::filesystem::path cachePath = OptimizedModelCachePath(cfg);
+    std::error_code error;
+    std::filesystem::remove(cachePath , error);
+
+    const char* names[3] = { "no cache" , "cold , writes cache" , "cached" };
+    cfg.warmupRuns = std::max(1 , cfg.warmupRuns);
+    for (int pass = 0 ; pass < 3 ; pass++)
+    {
+        cfg.modelCache = pass > 0;
+        STARTUP_TIMES times;
+        std::chrono::duration<double , std::milli> cost;
+        {
+            auto time_start = std::chrono::high_resolution_clock::now();
+            YOLOv8OnnxRunner Detector(cfg);
+            cost = std::chrono::high_resolution_clock::now() - time_start;
+            times = Detector.GetStartupTimes();
+        }
+        fprintf(stdout, "[BENCH] startup %-20s : session %.1fms , first run %.1fms , warm-up (%d runs) %.1fms , ready %.1fms , cache hit %d\n",
+            names[pass], times.sessionMs, times.firstRunMs, cfg.warmupRuns, times.warmupMs, cost.count(), times.cacheHit);
+    }
+    fprintf(stdout, "[BENCH] cache file : %s\n", cachePath.string().c_str());
+}
+
+void Benchmark_Memory(Configuration cfg)
+{
+    // The shared pass goes first : the private pass may reuse heap the shared one freed , which can
+    // only understate the saving
+    const char* names[2] = { "shared weights" , "private" };
+    int sessions = std::max(4 , (int)cfg.numSessions);
+    cfg.warmupRuns = std::max(1 , cfg.warmupRuns);
+    cfg.modelCache = false;
+    for (int pass = 0 ; pass < 2 ; pass++)
+    {
+        cfg.mmapModel = pass == 0;
+        cfg.shareWeights = pass == 0;
+        std::vector<std::unique_ptr<YOLOv8OnnxRunner>> runners;
+        uint64_t startRSS = CurrentRSSBytes();
+        uint64_t startPrivate = CurrentPrivateBytes();
+        uint64_t lastRSS = startRSS , lastPrivate = startPrivate , firstRSS = 0 , firstPrivate = 0;
+        for (int k = 0 ; k < sessions ; k++)
+        {
+            // Warmed up , so the arena has grown to its steady size before it is measured
+            runners.emplace_back(new YOLOv8OnnxRunner(cfg));
+            uint64_t rss = CurrentRSSBytes();
+            uint64_t privateBytes = CurrentPrivateBytes();
+            fprintf(stdout, "[BENCH] memory %-14s : session %d , RSS %+.1fMB , private %+.1fMB\n",
+                names[pass], k + 1, ((double)rss - lastRSS) / (1024.0 * 1024.0), ((double)privateBytes - lastPrivate) / (1024.0 * 1024.0));
+            if (k == 0)
+            {
+                firstRSS = rss;
+                firstPrivate = privateBytes;
+            }
+            lastRSS = rss;
+            lastPrivate = privateBytes;
+        }
+        fprintf(stdout, "[BENCH] memory %-14s : %d sessions RSS %+.1fMB , per added session RSS %+.1fMB , private %+.1fMB\n",
+            names[pass], sessions, ((double)lastRSS - startRSS) / (1024.0 * 1024.0),
+            ((double)lastRSS - firstRSS) / (1024.0 * 1024.0) / (sessions - 1),
+            ((double)lastPrivate - firstPrivate) / (1024.0 * 1024.0) / (sessions - 1));
+    }
+}
+
+int Check_Allocations(Configuration cfg , const std::vector<cv::Mat>& images)
+{
+    if (images.empty())
+    {
+        fprintf(stderr, "[ERROR] : No image found for the allocation check\n");
+        return EXIT_FAILURE;
+    }
+    // Unbound runs create their tensors every frame , only the IoBinding path can be allocation free
+    cfg.ioBinding = true;
+    YOLOv8OnnxRunner Detector(cfg);
+    REQUEST_CONTEXT ctx;
+    std::vector<DETECT_RESULT> result;
+
+    // Warm-up : every buffer grows to the largest frame and candidate count of the set
+    for (int pass = 0 ; pass < 2 ; pass++)
+    {
+        for (auto& image : images)
+        {
+            Detector.InferenceSingleImage(image , ctx , result);
+        }
+    }
+    // OpenCV and onnxruntime allocate outside operator new , a moved buffer catches those
+    std::vector<const void*> buffers = { ctx.input_image.data() , ctx.quant_input.data() , ctx.resizeImage.data , \
+        ctx.colorImage.data , ctx.letterboxImage.data , ctx.workspace.candidates.scores.data() , \
+        ctx.workspace.boxes.x1.data() , ctx.workspace.keep.data() , result.data() };
+
+    /* Every frame goes through the public call , which is what callers use and what is asserted :
+       wrapper work (trace span , clearing the outputs) included. The same frame then goes through the
+       stages one by one for the split. Run allocates the same on every warm frame of a shape , so
+       the staged Run stands in for the Run inside the public call , the only part not asserted. */
+    ALLOCATION_COUNTS publicCall , preprocess , inference , postprocess;
+    int frames = std::max(30 , (int)images.size() * 2);
+    for (int i = 0 ; i < frames ; i++)
+    {
+        const cv::Mat& image = images[i % images.size()];
+        ALLOCATION_COUNTS start = AllocationCounter::Thread();
+        Detector.InferenceSingleImage(image , ctx , result);
+        ALLOCATION_COUNTS called = AllocationCounter::Thread();
+        publicCall = publicCall + (called - start);
+
+        start = AllocationCounter::Thread();
+        Detector.PreprocessStage(image , ctx);
+        ALLOCATION_COUNTS preprocessed = AllocationCounter::Thread();
+        Detector.InferenceStage(ctx);
+        ALLOCATION_COUNTS inferred = AllocationCounter::Thread();
+        result.clear();
+        Detector.PostprocessStage(ctx , result);
+        ALLOCATION_COUNTS end = AllocationCounter::Thread();
+
+        preprocess = preprocess + (preprocessed - start);
+        inference = inference + (inferred - preprocessed);
+        postprocess = postprocess + (end - inferred);
+    }
+    int64_t callerAllocations = (int64_t)publicCall.allocations - (int64_t)inference.allocations;
+
+    std::vector<const void*> after = { ctx.input_image.data() , ctx.quant_input.data() , ctx.resizeImage.data , \
+        ctx.colorImage.data , ctx.letterboxImage.data , ctx.workspace.candidates.scores.data() , \
+        ctx.workspace.boxes.x1.data() , ctx.workspace.keep.data() , result.data() };
+    int moved = 0;
+    for (size_t b = 0 ; b < buffers.size() ; b++)
+    {
+        moved += buffers[b] != after[b] ? 1 : 0;
+    }
+    RUNNER_COUNTERS counters = Detector.GetCounters();
+
+    fprintf(stdout, "[CHECK] %d frames after warm-up , %llu of %llu runs bound , tracing %s\n", frames,
+        (unsigned long long)counters.boundRuns, (unsigned long long)counters.runs, Tracer::IsEnabled() ? "on" : "off");
+    fprintf(stdout, "[CHECK] InferenceSingleImage : %llu allocations , %llu bytes , %lld outside session Run\n",
+        (unsigned long long)publicCall.allocations, (unsigned long long)publicCall.bytes, (long long)callerAllocations);
+    fprintf(stdout, "[CHECK] preprocess  : %llu allocations , %llu bytes\n",
+        (unsigned long long)preprocess.allocations, (unsigned long long)preprocess.bytes);
+    fprintf(stdout, "[CHECK] postprocess : %llu allocations , %llu bytes\n",
+        (unsigned long long)postprocess.allocations, (unsigned long long)postprocess.bytes);
+    // Not asserted : whatever onnxruntime allocates inside Run on this thread , where its new is ours to count
+    fprintf(stdout, "[CHECK] session Run : %llu allocations , %llu bytes (onnxruntime internals)\n",
+        (unsigned long long)inference.allocations, (unsigned long long)inference.bytes);
+    fprintf(stdout, "[CHECK] workspace buffers moved : %d of %zu\n", moved, buffers.size());
+
+    bool clean = callerAllocations <= 0 && preprocess.allocations == 0 && postprocess.allocations == 0 && moved == 0;
+    fprintf(stdout, "[CHECK] steady state %s\n", clean ? "allocation free" : "ALLOCATES");
+    return clean ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+FRAME_CACHE_CONFIG Frame_Cache_Config(const Configuration& cfg)
+{
+    FRAME_CACHE_CONFIG cacheConfig;
+    cacheConfig.threshold = cfg.frameCacheThreshold;
+    cacheConfig.maxStaleFrames = cfg.frameCacheMaxStale;
+    cacheConfig.maxStaleMs = cfg.frameCacheMaxAgeMs;
+    return cacheConfig;
+}
+
+// Textured dark background , gray levels 0..60 in 8x8 cells so the thumbnail is not flat
+cv::Mat Synthetic_Scene(cv::Size size , uint64_t seed)
+{
+    cv::Mat cells(size.height / 8 , size.width / 8 , CV_8UC3);
+    cv::RNG rng(seed);
+    rng.fill(cells , cv::RNG::UNIFORM , 0 , 60);
+    cv::Mat scene;
+    cv::resize(cells , scene , size , 0 , 0 , cv::INTER_NEAREST);
+    return scene;
+}
+
+// Sensor noise , sigma in gray levels
+cv::Mat Add_Noise(const cv::Mat& scene , double sigma , cv::RNG& rng)
+{
+    cv::Mat noise(scene.size() , CV_16SC3);
+    rng.fill(noise , cv::RNG::NORMAL , 0 , sigma);
+    cv::Mat noisy;
+    cv::add(scene , noise , noisy , cv::noArray() , CV_8UC3);
+    return noisy;
+}
+
+int Check_Frame_Cache(const Configuration& cfg)
+{
+    const cv::Size size(1280 , 720);
+    const int frames = 120;
+    const double frameMs = 1000.0 / 30;
+    cv::Mat scene = Synthetic_Scene(size , 1);
+    cv::RNG rng(2);
+    auto start = std::chrono::steady_clock::now();
+    auto at = [&](int frame)
+    {
+        return start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double , std::milli>(frame * frameMs));
+    };
+    bool passed = true;
+    auto report = [&](const char* name , bool ok , const FRAME_CACHE_STATS& stats)
+    {
+        fprintf(stdout, "[CHECK] %-28s : hits %llu / %llu , changed %llu , stale %llu : %s\n", name,
+            (unsigned long long)stats.hits, (unsigned long long)stats.lookups, (unsigned long long)stats.changed,
+            (unsigned long long)stats.stale, ok ? "ok" : "FAILED");
+        passed = passed && ok;
+    };
+    auto count = [](FRAME_CACHE_STATS& stats , FRAME_CACHE_DECISION decision)
+    {
+        stats.lookups++;
+        stats.hits += decision == FRAME_CACHE_HIT ? 1 : 0;
+        stats.changed += decision == FRAME_CACHE_CHANGED ? 1 : 0;
+        stats.stale += decision == FRAME_CACHE_STALE ? 1 : 0;
+    };
+
+    // Static scene with sensor noise : only the staleness limit forces inference
+    {
+        FRAME_CACHE_CONFIG config = Frame_Cache_Config(cfg);
+        config.maxStaleMs = 0.0;
+        config.maxStaleFrames = std::max(1 , config.maxStaleFrames);
+        FrameChangeGate gate(config);
+        FRAME_CACHE_STATS stats;
+        float largest = 0.0f;
+        for (int i = 0 ; i < frames ; i++)
+        {
+            count(stats , gate.Check(Add_Noise(scene , 3.0 , rng) , at(i)));
+            largest = std::max(largest , gate.LastChange());
+        }
+        uint64_t expectedStale = (frames - 1) / (config.maxStaleFrames + 1);
+        report("static , noise sigma 3" , stats.changed == 0 && stats.stale == expectedStale , stats);
+        fprintf(stdout, "[CHECK] %-28s   largest block change %.2f , threshold %.2f\n", "", largest, config.threshold);
+    }
+
+    // Bright square moving 16 px per frame : every frame must run inference
+    {
+        FrameChangeGate gate(Frame_Cache_Config(cfg));
+        FRAME_CACHE_STATS stats;
+        for (int i = 0 ; i < frames ; i++)
+        {
+            cv::Mat frame = Add_Noise(scene , 3.0 , rng);
+            cv::rectangle(frame , cv::Rect((16 * i) % (size.width - 160) , 280 , 160 , 160) , cv::Scalar(255 , 255 , 255) , cv::FILLED);
+            count(stats , gate.Check(frame , at(i)));
+        }
+        report("moving square , 16 px/frame" , stats.hits == 0 , stats);
+    }
+
+    // A 48 px object appears in one corner at frame 10 : a miss by block , below the threshold for the whole frame
+    {
+        FrameChangeGate gate(Frame_Cache_Config(cfg));
+        FRAME_CACHE_STATS stats;
+        bool seen = false;
+        float change = 0.0f;
+        for (int i = 0 ; i < 20 ; i++)
+        {
+            cv::Mat frame = Add_Noise(scene , 3.0 , rng);
+            if (i >= 10)
+            {
+                cv::rectangle(frame , cv::Rect(40 , 40 , 48 , 48) , cv::Scalar(255 , 255 , 255) , cv::FILLED);
+            }
+            FRAME_CACHE_DECISION decision = gate.Check(frame , at(i));
+            count(stats , decision);
+            if (i == 10)
+            {
+                seen = decision == FRAME_CACHE_CHANGED;
+                change = gate.LastChange();
+            }
+        }
+        report("small object appears" , seen && stats.changed == 1 , stats);
+        fprintf(stdout, "[CHECK] %-28s   block change %.2f , whole frame about %.2f\n", "", change,
+            225.0 * 48 * 48 / size.area());
+    }
+
+    // Static scene at 30 fps with only the age limit : no hit may serve a result older than it
+    {
+        FRAME_CACHE_CONFIG config = Frame_Cache_Config(cfg);
+        config.maxStaleFrames = 0;
+        config.maxStaleMs = config.maxStaleMs > 0.0 ? config.maxStaleMs : 500.0;
+        FrameChangeGate gate(config);
+        FRAME_CACHE_STATS stats;
+        double oldest = 0.0;
+        int reference = 0;
+        for (int i = 0 ; i < frames ; i++)
+        {
+            FRAME_CACHE_DECISION decision = gate.Check(Add_Noise(scene , 3.0 , rng) , at(i));
+            count(stats , decision);
+            if (decision == FRAME_CACHE_HIT)
+            {
+                oldest = std::max(oldest , (i - reference) * frameMs);
+            } else
+            {
+                reference = i;
+            }
+        }
+        report("static , age limit" , stats.changed == 0 && oldest <= config.maxStaleMs + 1e-3 && \
+            (frames * frameMs <= config.maxStaleMs || stats.stale > 0) , stats);
+        fprintf(stdout, "[CHECK] %-28s   oldest cached result %.1fms , limit %.1fms\n", "", oldest, config.maxStaleMs);
+    }
+
+    // Signature cost on a full HD frame
+    {
+        FRAME_CACHE_CONFIG config = Frame_Cache_Config(cfg);
+        cv::Mat frame = Synthetic_Scene(cv::Size(1920 , 1080) , 3);
+        cv::Mat signature;
+        LatencyRecorder latency;
+        for (int i = 0 ; i < 200 ; i++)
+        {
+            auto time_start = std::chrono::high_resolution_clock::now();
+            FrameSignature(frame , config.signatureSize , signature);
+            latency.Add(std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_start).count());
+        }
+        fprintf(stdout, "[CHECK] signature 1920x1080 -> %dx%d : p50 %.3fms , p99 %.3fms\n",
+            config.signatureSize.width, config.signatureSize.height, latency.Percentile(50), latency.Percentile(99));
+    }
+
+    fprintf(stdout, "[CHECK] frame cache %s\n", passed ? "passed" : "FAILED");
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+TRACKING_CONFIG Tracking_Config(const Configuration& cfg)
+{
+    TRACKING_CONFIG trackConfig;
+    trackConfig.maxInterval = cfg.trackInterval;
+    trackConfig.adaptive = cfg.trackAdaptive;
+    trackConfig.tracker.highThreshold = cfg.confThreshold;
+    trackConfig.tracker.lowThreshold = std::min(cfg.trackLowThreshold , cfg.confThreshold);
+    trackConfig.tracker.newTrackThreshold = cfg.confThreshold + 0.1f;
+    trackConfig.tracker.maxLostFrames = cfg.trackMaxLost;
+    trackConfig.tracker.classAgnostic = cfg.agnosticNMS;
+    return trackConfig;
+}
+
+// The tracker's second association round needs the low score detections the usual threshold drops
+Configuration Detector_Config(const Configuration& cfg)
+{
+    Configuration detectorCfg = cfg;
+    if (cfg.tracking || cfg.benchTrack)
+    {
+        detectorCfg.confThreshold = std::min(cfg.confThreshold , cfg.trackLowThreshold);
+    }
+    return detectorCfg;
+}
+
+/* Tracks of candidate against the reference tracks , frame by frame : a reference track matched
+   (same class , IoU >= 0.5) by a different candidate id than at its last match is an id switch */
+void Count_Id_Switches(const std::vector<DETECT_RESULT>& reference , const std::vector<DETECT_RESULT>& candidate , \
+    std::map<int , int>& lastMatch , size_t& total , size_t& matched , size_t& switches)
+{
+    std::vector<bool> used(candidate.size() , false);
+    for (const auto& ref : reference)
+    {
+        total++;
+        int best = -1;
+        float bestIoU = 0.5f;
+        for (size_t j = 0 ; j < candidate.size() ; j++)
+        {
+            float iou = Box_IoU(ref.box , candidate[j].box);
+            if (!used[j] && candidate[j].classId == ref.classId && iou >= bestIoU)
+            {
+                best = (int)j;
+                bestIoU = iou;
+            }
+        }
+        if (best < 0)
+        {
+            continue;
+        }
+        used[best] = true;
+        matched++;
+        auto last = lastMatch.find(ref.trackId);
+        if (last != lastMatch.end() && last->second != candidate[best].trackId)
+        {
+            switches++;
+        }
+        lastMatch[ref.trackId] = candidate[best].trackId;
+    }
+}
+
+int Benchmark_Track(const Configuration& cfg)
+{
+    if (cfg.VideoPath.empty())
+    {
+        fprintf(stderr, "[ERROR] : --bench-track needs a video , -vid FNAME\n");
+        return EXIT_FAILURE;
+    }
+    YOLOv8OnnxRunner Detector(Detector_Config(cfg));
+
+    // Every frame is the reference for recall and id switches , then every N frames , then adaptive
+    const char* names[3] = { "every frame" , "fixed interval" , "adaptive" };
+    std::vector<std::vector<DETECT_RESULT>> reference;
+    double referenceFps = 0.0;
+    for (int pass = 0 ; pass < 3 ; pass++)
+    {
+        cv::VideoCapture capture(cfg.VideoPath);
+        if (!capture.isOpened())
+        {
+            LOG_ERROR("Failed to open video " << cfg.VideoPath);
+            return EXIT_FAILURE;
+        }
+        TRACKING_CONFIG trackConfig = Tracking_Config(cfg);
+        trackConfig.adaptive = pass == 2;
+        trackConfig.maxInterval = pass == 0 ? 1 : cfg.trackInterval;
+        TrackingRunner tracker(Detector , trackConfig);
+        REQUEST_CONTEXT ctx;
+
+        // Decode is left out of the timing , it is the same for every pass
+        LatencyRecorder latency;
+        std::map<int , int> lastMatch;
+        size_t total = 0 , matched = 0 , switches = 0;
+        std::set<int> ids;
+        cv::Mat frame;
+        for (size_t idx = 0 ; capture.read(frame) && !frame.empty() ; idx++)
+        {
+            if (pass == 0 && idx == 0)
+            {
+                Detector.InferenceSingleImage(frame , ctx);
+            }
+            auto time_start = std::chrono::high_resolution_clock::now();
+            auto result = tracker.InferenceSingleImage(frame , ctx);
+            latency.Add(std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_start).count());
+            for (const auto& det : result)
+            {
+                ids.insert(det.trackId);
+            }
+            if (pass == 0)
+            {
+                reference.emplace_back(result);
+            } else if (idx < reference.size())
+            {
+                Count_Id_Switches(reference[idx] , result , lastMatch , total , matched , switches);
+            }
+        }
+        if (latency.Count() == 0)
+        {
+            fprintf(stderr, "[ERROR] : No frame decoded from %s\n", cfg.VideoPath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        TRACKING_STATS stats = tracker.GetStats();
+        double fps = 1000.0 / latency.Mean();
+        referenceFps = pass == 0 ? fps : referenceFps;
+        fprintf(stdout, "[BENCH] %-14s : %.2f frames/s (x%.2f) , p50 %.2fms , p99 %.2fms , detector runs %llu / %llu frames , track ids %zu\n",
+            names[pass], fps, fps / referenceFps, latency.Percentile(50), latency.Percentile(99),
+            (unsigned long long)stats.keyframes, (unsigned long long)stats.frames, ids.size());
+        if (pass > 0)
+        {
+            fprintf(stdout, "[BENCH] %-14s   recall %.3f (%zu/%zu) , id switches %zu (%.2f per 100 matched track frames) vs every frame\n",
+                "", total > 0 ? (double)matched / total : 1.0, matched, total, switches,
+                matched > 0 ? 100.0 * switches / matched : 0.0);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int Run_Video(YOLOv8OnnxRunner& Detector , const Configuration& cfg)
+{
+    STREAM_CONFIG streamConfig;
+    streamConfig.ringSize = cfg.videoRingSize;
+    streamConfig.latencyBudgetMs = cfg.latencyBudgetMs;
+    streamConfig.paceToSourceFps = cfg.paceVideo;
+    streamConfig.frameCache = cfg.frameCache;
+    streamConfig.cache = Frame_Cache_Config(cfg);
+    streamConfig.tracking = cfg.tracking;
+    streamConfig.track = Tracking_Config(cfg);
+
+    VideoStreamRunner stream(Detector , streamConfig);
+    bool opened = stream.Run(cfg.VideoPath , [&](const STREAM_FRAME& frame , const std::vector<DETECT_RESULT>& result)
+    {
+        if (!cfg.doVisualize)
+        {
+            return true;
+        }
+        cv::imshow("YOLOv8Detect Result" , Detector.VisualizationPredicition(frame.image , result));
+        // Esc stops the stream
+        return cv::waitKey(1) != 27;
+    });
+    if (cfg.doVisualize)
+    {
+        cv::destroyAllWindows();
+    }
+    if (!opened)
+    {
+        return EXIT_FAILURE;
+    }
+    stream.PrintReport();
+    return EXIT_SUCCESS;
+}
+
+TILE_CONFIG Tile_Config(const Configuration& cfg)
+{
+    TILE_CONFIG tileConfig;
+    tileConfig.overlap = cfg.tileOverlap;
+    tileConfig.fullImagePass = cfg.tileFullPass;
+    tileConfig.workers = cfg.tileWorkers;
+    tileConfig.mergeThreshold = cfg.tileMergeThreshold;
+    tileConfig.classAgnosticMerge = cfg.agnosticNMS;
+    return tileConfig;
+}
+
+// YOLO-format ground truth in pixels , empty when the image has no label file
+std::vector<DETECT_RESULT> Load_Labels(const std::filesystem::path& labelPath , cv::Size imageSize)
+{
+    std::vector<DETECT_RESULT> labels;
+    FILE* file = fopen(labelPath.string().c_str() , "r");
+    if (file == nullptr)
+    {
+        return labels;
+    }
+    int classId;
+    float cx , cy , w , h;
+    while (fscanf(file , "%d %f %f %f %f" , &classId , &cx , &cy , &w , &h) == 5)
+    {
+        DETECT_RESULT label;
+        label.classId = classId;
+        label.confidence = 1.0f;
+        label.box = cv::Rect((int)std::round((cx - 0.5f * w) * imageSize.width) , (int)std::round((cy - 0.5f * h) * imageSize.height) , \
+            (int)std::round(w * imageSize.width) , (int)std::round(h * imageSize.height));
+        labels.emplace_back(label);
+    }
+    fclose(file);
+    return labels;
+}
+
+// Reference boxes (of at most maxArea pixels) matched by a same-class detection at IoU >= 0.5 , greedy
+void Count_Matches(const std::vector<DETECT_RESULT>& reference , const std::vector<DETECT_RESULT>& detections , \
+    int maxArea , size_t& total , size_t& matched)
+{
+    std::vector<bool> used(detections.size() , false);
+    for (const auto& ref : reference)
+    {
+        if (ref.box.area() > maxArea)
+        {
+            continue;
+        }
+        total++;
+        int best = -1;
+        float bestIoU = 0.5f;
+        for (size_t j = 0 ; j < detections.size() ; j++)
+        {
+            float iou = Box_IoU(ref.box , detections[j].box);
+            if (!used[j] && detections[j].classId == ref.classId && iou >= bestIoU)
+            {
+                best = (int)j;
+                bestIoU = iou;
+            }
+        }
+        if (best >= 0)
+        {
+            used[best] = true;
+            matched++;
+        }
+    }
+}
+
+int Benchmark_Tiles(const Configuration& cfg , const std::vector<std::filesystem::path>& image_paths)
+{
+    std::vector<cv::Mat> images;
+    std::vector<std::vector<DETECT_RESULT>> labels;
+    for (auto& path : image_paths)
+    {
+        cv::Mat image = cv::imread(path.string());
+        if (image.empty())
+        {
+            continue;
+        }
+        if (!cfg.LabelDir.empty())
+        {
+            labels.emplace_back(Load_Labels(std::filesystem::path(cfg.LabelDir) / (path.stem().string() + ".txt") , image.size()));
+        }
+        images.emplace_back(image);
+    }
+    if (images.empty())
+    {
+        fprintf(stderr, "[ERROR] : No image found for benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    YOLOv8OnnxRunner Detector(cfg);
+    const int smallArea = 32 * 32;
+
+    // Single pass first , it is the recall reference when there are no labels ; tiled runs with 1 , 2 , 4 .. tileWorkers
+    std::vector<int> tileWorkers = { 0 };
+    for (int workers = 1 ; workers < cfg.tileWorkers ; workers *= 2)
+    {
+        tileWorkers.push_back(workers);
+    }
+    tileWorkers.push_back(cfg.tileWorkers);
+
+    std::vector<std::vector<DETECT_RESULT>> singlePass;
+    for (int workers : tileWorkers)
+    {
+        TILE_CONFIG tileConfig = Tile_Config(cfg);
+        tileConfig.workers = std::max(1 , workers);
+        std::unique_ptr<TiledRunner> tiler(workers > 0 ? new TiledRunner(Detector , tileConfig) : nullptr);
+        REQUEST_CONTEXT ctx;
+        auto run = [&](const cv::Mat& image , TILE_STATS* stats)
+        {
+            return tiler ? tiler->InferenceSingleImage(image , stats) : Detector.InferenceSingleImage(image , ctx);
+        };
+        run(images.front() , nullptr);
+
+        LatencyRecorder latency;
+        TILE_STATS stats;
+        size_t tiles = 0 , detections = 0 , small = 0 , rawDetections = 0;
+        size_t total = 0 , matched = 0 , smallTotal = 0 , smallMatched = 0;
+        for (size_t i = 0 ; i < images.size() ; i++)
+        {
+            auto time_start = std::chrono::high_resolution_clock::now();
+            auto result = run(images[i] , &stats);
+            latency.Add(std::chrono::duration<double , std::milli>(std::chrono::high_resolution_clock::now() - time_start).count());
+            tiles += stats.tiles;
+            rawDetections += stats.rawDetections;
+            detections += result.size();
+            for (const auto& det : result)
+            {
+                small += det.box.area() <= smallArea ? 1 : 0;
+            }
+            if (workers == 0)
+            {
+                singlePass.emplace_back(result);
+            }
+            const auto& reference = labels.empty() ? singlePass[i] : labels[i];
+            Count_Matches(reference , result , INT_MAX , total , matched);
+            Count_Matches(reference , result , smallArea , smallTotal , smallMatched);
+        }
+
+        std::string name = workers == 0 ? "single pass" : "tiled , " + std::to_string(workers) + " worker" + (workers > 1 ? "s" : "");
+        fprintf(stdout, "[BENCH] %-19s : %.2f images/s , p50 %.1fms , p90 %.1fms , detections %zu (small %zu)",
+            name.c_str(), 1000.0 / latency.Mean(), latency.Percentile(50), latency.Percentile(90), detections, small);
+        if (workers > 0)
+        {
+            fprintf(stdout, " , tiles/image %.1f , merged %zu -> %zu", (double)tiles / images.size(), rawDetections, detections);
+        }
+        fprintf(stdout, "\n");
+        fprintf(stdout, "[BENCH] %-19s   recall %.3f (%zu/%zu) , small recall %.3f (%zu/%zu) vs %s\n",
+            "", total > 0 ? (double)matched / total : 1.0, matched, total,
+            smallTotal > 0 ? (double)smallMatched / smallTotal : 1.0, smallMatched, smallTotal,
+            labels.empty() ? "single pass" : "labels");
+    }
+    return EXIT_SUCCESS;
+}
+
+RESULT_WRITER_CONFIG Result_Writer_Config(const Configuration& cfg)
+{
+    RESULT_WRITER_CONFIG writerConfig;
+    writerConfig.directory = cfg.SavePath;
+    writerConfig.jsonl = cfg.saveJsonl;
+    writerConfig.images = cfg.saveImages;
+    writerConfig.encodeWorkers = cfg.saveEncoders;
+    writerConfig.queueCapacity = std::max(64 , cfg.queueCapacity);
+    return writerConfig;
+}
+
+// Drains the writer , so the report covers every image , and prints it
+void Close_Results(std::unique_ptr<ResultWriter>& writer)
+{
+    if (writer)
+    {
+        writer->Close();
+        writer->PrintReport();
+    }
+}
+
+int Read_Results(const Configuration& cfg)
+{
+    auto time_start = std::chrono::high_resolution_clock::now();
+    ResultReader reader;
+    if (!reader.Open(cfg.ReadResultsPath))
+    {
+        fprintf(stderr, "[ERROR] : No result store in %s\n", cfg.ReadResultsPath.c_str());
+        return EXIT_FAILURE;
+    }
+    auto time_open = std::chrono::high_resolution_clock::now();
+
+    // Class id -> detections , confidence sum
+    std::map<int32_t , std::pair<uint64_t , double>> classes;
+    const RESULT_RECORD* records = reader.AllRecords();
+    for (size_t i = 0 ; i < reader.Records() ; i++)
+    {
+        auto& summary = classes[records[i].classId];
+        summary.first++;
+        summary.second += records[i].confidence;
+    }
+    auto time_scan = std::chrono::high_resolution_clock::now();
+
+    uint64_t busiest = 0;
+    size_t busiestCount = 0;
+    for (uint64_t id = 0 ; id < reader.Images() ; id++)
+    {
+        size_t count = 0;
+        reader.ImageRecords(id , count);
+        if (count > busiestCount)
+        {
+            busiest = id;
+            busiestCount = count;
+        }
+    }
+    auto time_lookup = std::chrono::high_resolution_clock::now();
+
+    fprintf(stdout, "[READ] %s : images %zu , detections %zu\n", cfg.ReadResultsPath.c_str(), reader.Images(), reader.Records());
+    for (auto& summary : classes)
+    {
+        fprintf(stdout, "[READ]   class %3d : %llu detections , mean confidence %.3f\n", summary.first,
+            (unsigned long long)summary.second.first, summary.second.second / summary.second.first);
+    }
+    if (busiestCount > 0)
+    {
+        fprintf(stdout, "[READ] most detections : %zu in %s\n", busiestCount, reader.ImageName(busiest).c_str());
+    }
+    fprintf(stdout, "[READ] open %.3fms , full scan %.3fms , lookup of every image %.3fms\n",
+        std::chrono::duration<double , std::milli>(time_open - time_start).count(),
+        std::chrono::duration<double , std::milli>(time_scan - time_open).count(),
+        std::chrono::duration<double , std::milli>(time_lookup - time_scan).count());
+    return EXIT_SUCCESS;
+}
+
+int main(int argc , char *argv[])
+{
+    std::filesystem::path image_dir;
+    Configuration cfg;
+    // Before the flags , so anything given on the command line overrides the tuned settings
+    LoadHostProfileArgs(argc , argv , cfg);
+
+    if (Params_Parse(argc , argv , cfg , image_dir))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Logger::SetLevel(Logger::ParseLevel(cfg.LogLevel));
+    // Written on every return path below
+    TraceSession traceSession(cfg.TracePath);
+    Tracer::SetThreadName("main");
+
+    if (cfg.benchDecode)
+    {
+        Benchmark_Decode();
+        return EXIT_SUCCESS;
+    }
+
+    if (cfg.benchNMS)
+    {
+        return Benchmark_NMS(cfg);
+    }
+
+    if (cfg.benchStartup)
+    {
+        Benchmark_Startup(cfg);
+        return EXIT_SUCCESS;
+    }
+
+    if (cfg.benchMemory)
+    {
+        Benchmark_Memory(cfg);
+        return EXIT_SUCCESS;
+    }
+
+    if (cfg.checkFrameCache)
+    {
+        return Check_Frame_Cache(cfg);
+    }
+
+    if (!cfg.ReadResultsPath.empty())
+    {
+        return Read_Results(cfg);
+    }
+
+    if (cfg.benchTrack)
+    {
+        return Benchmark_Track(cfg);
+    }
+
+    if (!cfg.VideoPath.empty())
+    {
+        YOLOv8OnnxRunner Detector(Detector_Config(cfg));
+        return Run_Video(Detector , cfg);
+    }
+    
+    if (cfg.autoTune && image_dir.empty())
+    {
+        image_dir = "assets";
+    }
+    std::vector<std::filesystem::path> image_paths;
+    for (auto& i : std::filesystem::directory_iterator(image_dir))
+    {
+        if (i.path().extension() == ".jpg" || i.path().extension() == ".png" || i.path().extension() == ".jpeg")
+        {
+            image_paths.emplace_back(i.path());
+        }
+    }
+
+    if (!cfg.CompareModelPath.empty())
+    {
+        return Compare_Models(cfg , image_paths);
+    }
+
+    if (cfg.benchTiles)
+    {
+        return Benchmark_Tiles(cfg , image_paths);
+    }
+
+    if (cfg.checkAllocations)
+    {
+        std::vector<cv::Mat> images;
+        for (auto& path : image_paths)
+        {
+            images.emplace_back(cv::imread(path.string()));
+        }
+        return Check_Allocations(cfg , images);
+    }
+
+    if (cfg.autoTune)
+    {
+        std::vector<cv::Mat> images;
+        for (auto& path : image_paths)
+        {
+            images.emplace_back(cv::imread(path.string()));
+        }
+        return Auto_Tune(cfg , images);
+    }
+
+    if (cfg.benchThreads)
+    {
+        std::vector<cv::Mat> images;
+        for (auto& path : image_paths)
+        {
+            images.emplace_back(cv::imread(path.string()));
+        }
+        return Benchmark_Threads(cfg , images);
+    }
+
+    YOLOv8OnnxRunner Detector(cfg);
+
+    if (!cfg.CalibrationDir.empty())
+    {
+        if (cfg.rawInput)
+        {
+            // The calibrator needs the float tensor , which only exists inside the graph in that mode
+            fprintf(stderr, "[ERROR] : --dump-calibration does not work with --raw-input\n");
+            return EXIT_FAILURE;
+        }
+        return Dump_Calibration(Detector , image_paths , cfg.CalibrationDir);
+    }
+
+    if (cfg.checkPreprocess)
+    {
+        float maxDiff = 0.0f;
+        for (auto& path : image_paths)
+        {
+            float diff = Detector.CompareFusedPreprocess(cv::imread(path.string()));
+            fprintf(stdout, "[CHECK] %s : max abs diff %g\n", path.filename().string().c_str(), diff);
+            maxDiff = std::max(maxDiff , diff);
+        }
+        fprintf(stdout, "[CHECK] preprocess kernel %s , max abs diff %g\n", PreprocessKernelName(), maxDiff);
+        return maxDiff <= 1e-6f ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (cfg.benchBatch)
+    {
+        std::vector<cv::Mat> images;
+        for (auto& path : image_paths)
+        {
+            images.emplace_back(cv::imread(path.string()));
+        }
+        Benchmark_Batch(Detector , images , cfg.batchSize);
+        return EXIT_SUCCESS;
+    }
+
+    std::unique_ptr<ResultWriter> writer;
+    if (cfg.saveResults)
+    {
+        writer.reset(new ResultWriter(Detector , Result_Writer_Config(cfg)));
+        if (!writer->IsOpen())
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cfg.pipeline)
+    {
+        PIPELINE_CONFIG pipelineConfig;
+        pipelineConfig.decodeWorkers = cfg.decodeWorkers;
+        pipelineConfig.preprocessWorkers = cfg.preprocessWorkers;
+        pipelineConfig.inferenceWorkers = cfg.inferenceWorkers;
+        pipelineConfig.postprocessWorkers = cfg.postprocessWorkers;
+        pipelineConfig.queueCapacity = cfg.queueCapacity;
+        pipelineConfig.ordered = cfg.orderedOutput;
+
+        PipelineRunner pipeline(Detector , pipelineConfig);
+        pipeline.Run(image_paths , [&](PIPELINE_ITEM& item)
+        {
+            if (item.image.empty())
+            {
+                fprintf(stderr, "[ERROR] : Failed to read %s\n", item.path.string().c_str());
+                return;
+            }
+            if (writer)
+            {
+                writer->Write(item.path.string() , item.result , item.image);
+            }
+            if (cfg.doVisualize)
+            {
+                Visualize_Result(Detector , item.image , item.result);
+            }
+        });
+        pipeline.PrintReport();
+        Close_Results(writer);
+        return EXIT_SUCCESS;
+    }
+
+    if (cfg.tiled)
+    {
+        TiledRunner tiler(Detector , Tile_Config(cfg));
+        for (auto& path : image_paths)
+        {
+            cv::Mat srcImage = cv::imread(path.string());
+            TILE_STATS stats;
+            auto result = tiler.InferenceSingleImage(srcImage , &stats);
+            LOG_INFO(path.filename().string() << " : " << stats.tiles << " tiles , " << stats.rawDetections \
+                << " tile detections merged into " << result.size() << " , inference " << stats.inferenceMs << "ms , merge " \
+                << stats.mergeMs << "ms");
+            if (writer)
+            {
+                writer->Write(path.string() , result , srcImage);
+            }
+            if (cfg.doVisualize)
+            {
+                Visualize_Result(Detector , srcImage , result);
+            }
+        }
+        Close_Results(writer);
+        return EXIT_SUCCESS;
+    }
+
+    if (cfg.batchSize > 1)
+    {
+        for (size_t begin = 0 ; begin < image_paths.size() ; begin += cfg.batchSize)
+        {
+            size_t end = std::min(image_paths.size() , begin + (size_t)cfg.batchSize);
+            std::vector<cv::Mat> images;
+            for (size_t idx = begin ; idx < end ; idx++)
+            {
+                images.emplace_back(cv::imread(image_paths[idx].string()));
+            }
+            auto results = Detector.InferenceBatch(images);
+            for (size_t idx = 0 ; writer && idx < images.size() ; idx++)
+            {
+                writer->Write(image_paths[begin + idx].string() , results[idx] , images[idx]);
+            }
+            if (cfg.doVisualize)
+            {
+                for (size_t idx = 0 ; idx < images.size() ; idx++)
+                {
+                    Visualize_Result(Detector , images[idx] , results[idx]);
+                }
+            }
+        }
+        Close_Results(writer);
+        return EXIT_SUCCESS;
+    }
+
+    // Directory mode with the cache treats the sorted images as one sequence , e.g. frames dumped by a camera
+    std::unique_ptr<CachedRunner> cache;
+    REQUEST_CONTEXT ctx;
+    if (cfg.frameCache)
+    {
+        std::sort(image_paths.begin() , image_paths.end());
+        cache.reset(new CachedRunner(Detector , Frame_Cache_Config(cfg)));
+    }
+
+    RUNNER_COUNTERS warmCounters;
+    for (size_t idx = 0 ; idx < image_paths.size() ; idx++)
+    {
+        cv::Mat srcImage = cv::imread(image_paths[idx].string());
+        auto result = cache ? cache->InferenceSingleImage(srcImage , ctx) : Detector.InferenceSingleImage(srcImage);
+        if (idx == 0)
+        {
+            warmCounters = Detector.GetCounters();
+        }
+        if (writer)
+        {
+            writer->Write(image_paths[idx].string() , result , srcImage);
+        }
+        if (cfg.doVisualize)
+        {
+            Visualize_Result(Detector , srcImage , result);
+        }
+    }
+
+    // Steady state = everything after the first frame
+    RUNNER_COUNTERS counters = Detector.GetCounters();
+    fprintf(stdout, "[INFO] session runs : %llu , bound runs : %llu , tensor allocations : %llu , after warm-up : %llu\n",
+        (unsigned long long)counters.runs, (unsigned long long)counters.boundRuns,
+        (unsigned long long)counters.tensorAllocations,
+        (unsigned long long)(counters.tensorAllocations - warmCounters.tensorAllocations));
+    if (cache)
+    {
+        cache->PrintReport();
     }
+    Close_Results(writer);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
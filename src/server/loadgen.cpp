@@ -0,0 +1,337 @@
+/*
+    Load generator for the local inference server. Open loop : requests go out on a Poisson
+    schedule at the offered rate whether or not earlier ones were answered , and latency is
+    measured from the scheduled send time , so a server falling behind shows up in the tail
+    instead of silently slowing the client down. Steps through a list of offered rates and
+    reports latency percentiles , achieved throughput and the batch sizes the server formed.
+*/
+#include <map>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <opencv2/opencv.hpp>
+
+#include "LatencyRecorder.h"
+#include "ServerProtocol.h"
+
+typedef struct _LOAD_CONFIG
+{
+    std::string socketPath = DEFAULT_SOCKET_PATH;
+    std::vector<double> rates = { 10 , 20 , 50 , 100 }; // Offered requests per second , one step each
+    double durationSeconds = 10.0; // Per step
+    int connections = 4; // The offered rate is split evenly over them
+    bool raw = false; // Send decoded BGR frames instead of the encoded files
+    double drainSeconds = 5.0; // Wait for late responses after a step , then count them as timed out
+} LOAD_CONFIG;
+
+typedef struct _FRAME_PAYLOAD
+{
+    WIRE_REQUEST header;
+    std::vector<char> bytes;
+} FRAME_PAYLOAD;
+
+typedef struct _LOAD_CONNECTION
+{
+    LOCAL_SOCKET socket = INVALID_LOCAL_SOCKET;
+    std::mutex mutex;
+    std::map<uint64_t , std::chrono::steady_clock::time_point> pending; // Request id -> scheduled send time
+    uint64_t sent = 0;
+    uint64_t ok = 0;
+    uint64_t rejected = 0;
+    uint64_t failed = 0;
+    uint64_t batchSum = 0;
+    LatencyRecorder latency;
+    LatencyRecorder serverQueue;
+} LOAD_CONNECTION;
+
+void Print_Usage(int argc, char ** argv, const LOAD_CONFIG & load)
+{
+    fprintf(stderr, "Usage: %s [options]\n", argv[0]);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -h, --help            show this help message and exit\n");
+    fprintf(stderr, "  -img FNAME, --image FNAME\n");
+    fprintf(stderr, "                        image file or dir sent round robin (default: assets)\n");
+    fprintf(stderr, "  --socket FNAME\n");
+    fprintf(stderr, "                        server socket (default: %s)\n", load.socketPath.c_str());
+    fprintf(stderr, "  --rates R,R,...\n");
+    fprintf(stderr, "                        offered requests per second , one step each (default: 10,20,50,100)\n");
+    fprintf(stderr, "  --duration S\n");
+    fprintf(stderr, "                        seconds per step (default: %.1f)\n", load.durationSeconds);
+    fprintf(stderr, "  --connections N\n");
+    fprintf(stderr, "                        client connections sharing the offered rate (default: %d)\n", load.connections);
+    fprintf(stderr, "  --raw\n");
+    fprintf(stderr, "                        send decoded BGR frames instead of the encoded files (default: %d)\n", load.raw);
+    fprintf(stderr, "\n");
+}
+
+std::vector<double> Parse_List(const std::string& text)
+{
+    std::vector<double> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream , item , ','))
+    {
+        if (!item.empty())
+        {
+            values.push_back(std::stod(item));
+        }
+    }
+    return values;
+}
+
+bool Params_Parse(int argc , char ** argv , LOAD_CONFIG & load , std::filesystem::path & image_path)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-img" || arg == "--image") {
+            image_path = argv[++i];
+        } else if (arg == "--socket")
+        {
+            load.socketPath = argv[++i];
+        } else if (arg == "--rates")
+        {
+            load.rates = Parse_List(argv[++i]);
+        } else if (arg == "--duration")
+        {
+            load.durationSeconds = std::max(0.1 , std::stod(argv[++i]));
+        } else if (arg == "--connections")
+        {
+            load.connections = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--raw")
+        {
+            load.raw = true;
+        } else if (arg == "-h" || arg == "--help")
+        {
+            Print_Usage(argc , argv , load);
+            return EXIT_FAILURE;
+        } else
+        {
+            fprintf(stderr , "[ERROR] : Unknown argument : %s\n" , arg.c_str());
+            Print_Usage(argc , argv , load);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+std::vector<FRAME_PAYLOAD> Load_Payloads(const std::filesystem::path& image_path , bool raw)
+{
+    std::vector<std::filesystem::path> paths;
+    if (std::filesystem::is_directory(image_path))
+    {
+        for (auto& i : std::filesystem::directory_iterator(image_path))
+        {
+            if (i.path().extension() == ".jpg" || i.path().extension() == ".png" || i.path().extension() == ".jpeg")
+            {
+                paths.emplace_back(i.path());
+            }
+        }
+    } else
+    {
+        paths.emplace_back(image_path);
+    }
+
+    std::vector<FRAME_PAYLOAD> payloads;
+    for (auto& path : paths)
+    {
+        FRAME_PAYLOAD payload;
+        if (raw)
+        {
+            cv::Mat image = cv::imread(path.string());
+            if (image.empty())
+            {
+                continue;
+            }
+            image = image.isContinuous() ? image : image.clone();
+            payload.header.kind = FRAME_RAW_BGR;
+            payload.header.width = (uint32_t)image.cols;
+            payload.header.height = (uint32_t)image.rows;
+            payload.bytes.assign((const char*)image.data , (const char*)image.data + image.total() * image.elemSize());
+        } else
+        {
+            std::ifstream file(path.string() , std::ios::binary);
+            payload.header.kind = FRAME_ENCODED;
+            payload.bytes.assign(std::istreambuf_iterator<char>(file) , std::istreambuf_iterator<char>());
+            if (payload.bytes.empty())
+            {
+                continue;
+            }
+        }
+        payload.header.payloadBytes = (uint32_t)payload.bytes.size();
+        payloads.emplace_back(payload);
+    }
+    return payloads;
+}
+
+void Receive_Loop(LOAD_CONNECTION& connection)
+{
+    WIRE_RESPONSE response;
+    std::vector<WIRE_DETECTION> detections;
+    while (RecvAll(connection.socket , &response , sizeof(response)))
+    {
+        detections.resize(response.count);
+        if (response.magic != SERVER_MAGIC || \
+            (response.count > 0 && !RecvAll(connection.socket , detections.data() , detections.size() * sizeof(WIRE_DETECTION))))
+        {
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        auto it = connection.pending.find(response.requestId);
+        if (it == connection.pending.end())
+        {
+            continue;
+        }
+        if (response.status == STATUS_OK)
+        {
+            connection.ok++;
+            connection.batchSum += response.batchSize;
+            connection.latency.Add(std::chrono::duration<double , std::milli>(now - it->second).count());
+            connection.serverQueue.Add(response.queueMs);
+        } else if (response.status == STATUS_OVERLOADED)
+        {
+            connection.rejected++;
+        } else
+        {
+            connection.failed++;
+        }
+        connection.pending.erase(it);
+    }
+}
+
+void Send_Loop(LOAD_CONNECTION& connection , const std::vector<FRAME_PAYLOAD>& payloads , double rate , \
+    double durationSeconds , unsigned seed)
+{
+    std::mt19937 generator(seed);
+    std::exponential_distribution<double> interval(rate);
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(durationSeconds));
+    auto scheduled = start;
+    for (uint64_t id = 1 ; ; id++)
+    {
+        scheduled += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval(generator)));
+        if (scheduled >= end)
+        {
+            break;
+        }
+        std::this_thread::sleep_until(scheduled);
+
+        const FRAME_PAYLOAD& payload = payloads[id % payloads.size()];
+        WIRE_REQUEST header = payload.header;
+        header.requestId = id;
+        {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.pending[id] = scheduled;
+            connection.sent++;
+        }
+        if (!SendAll(connection.socket , &header , sizeof(header)) || \
+            !SendAll(connection.socket , payload.bytes.data() , payload.bytes.size()))
+        {
+            fprintf(stderr, "[ERROR] : Connection closed by the server\n");
+            break;
+        }
+    }
+}
+
+int main(int argc , char *argv[])
+{
+    LOAD_CONFIG load;
+    std::filesystem::path image_path = "assets";
+    if (Params_Parse(argc , argv , load , image_path))
+    {
+        return EXIT_FAILURE;
+    }
+    std::vector<FRAME_PAYLOAD> payloads = Load_Payloads(image_path , load.raw);
+    if (payloads.empty())
+    {
+        fprintf(stderr, "[ERROR] : No image found in %s\n", image_path.string().c_str());
+        return EXIT_FAILURE;
+    }
+    if (!SocketStartup())
+    {
+        fprintf(stderr, "[ERROR] : Socket startup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    for (double rate : load.rates)
+    {
+        if (rate <= 0.0)
+        {
+            continue;
+        }
+        std::vector<std::unique_ptr<LOAD_CONNECTION>> connections;
+        for (int c = 0 ; c < load.connections ; c++)
+        {
+            connections.emplace_back(new LOAD_CONNECTION());
+            connections.back()->socket = ConnectLocal(load.socketPath);
+            if (connections.back()->socket == INVALID_LOCAL_SOCKET)
+            {
+                fprintf(stderr, "[ERROR] : Cannot connect to %s\n", load.socketPath.c_str());
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::vector<std::thread> receivers , senders;
+        for (int c = 0 ; c < load.connections ; c++)
+        {
+            receivers.emplace_back(Receive_Loop , std::ref(*connections[c]));
+            senders.emplace_back(Send_Loop , std::ref(*connections[c]) , std::cref(payloads) , rate / load.connections , \
+                load.durationSeconds , (unsigned)(c + 1));
+        }
+        for (auto& sender : senders)
+        {
+            sender.join();
+        }
+
+        // Late responses still count , up to the drain timeout
+        auto drainEnd = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>( \
+            std::chrono::duration<double>(load.drainSeconds));
+        for (auto& connection : connections)
+        {
+            while (std::chrono::steady_clock::now() < drainEnd)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(connection->mutex);
+                    if (connection->pending.empty())
+                    {
+                        break;
+                    }
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            ShutdownLocal(connection->socket);
+        }
+        for (auto& receiver : receivers)
+        {
+            receiver.join();
+        }
+
+        LatencyRecorder latency , serverQueue;
+        uint64_t sent = 0 , ok = 0 , rejected = 0 , failed = 0 , timedOut = 0 , batchSum = 0;
+        for (auto& connection : connections)
+        {
+            CloseLocal(connection->socket);
+            latency.Append(connection->latency);
+            serverQueue.Append(connection->serverQueue);
+            sent += connection->sent;
+            ok += connection->ok;
+            rejected += connection->rejected;
+            failed += connection->failed;
+            timedOut += connection->pending.size();
+            batchSum += connection->batchSum;
+        }
+        fprintf(stdout, "[LOAD] offered %.1f req/s : achieved %.1f , sent %llu , ok %llu , rejected %llu , failed %llu , timed out %llu\n",
+            rate, ok / load.durationSeconds, (unsigned long long)sent, (unsigned long long)ok,
+            (unsigned long long)rejected, (unsigned long long)failed, (unsigned long long)timedOut);
+        fprintf(stdout, "[LOAD]   latency ms p50 %.2f , p90 %.2f , p99 %.2f , max %.2f ; mean batch %.2f , server queue p50 %.2fms\n",
+            latency.Percentile(50), latency.Percentile(90), latency.Percentile(99), latency.Max(),
+            ok > 0 ? (double)batchSum / ok : 0.0, serverQueue.Percentile(50));
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+/*
+    Local inference server : owns the sessions for every process on the host and serves
+    frames over a Unix domain socket with dynamic batching. See InferenceServer.h for the
+    scheduler and ServerProtocol.h for the wire format ; loadgen drives it.
+*/
+#include <csignal>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "Configuration.h"
+#include "HostProfile.h"
+#include "InferenceServer.h"
+#include "Trace.h"
+
+static InferenceServer* g_server = nullptr;
+
+static void Handle_Signal(int)
+{
+    if (g_server != nullptr)
+    {
+        g_server->Stop();
+    }
+}
+
+void Print_Usage(int argc, char ** argv, const Configuration & cfg, const SERVER_CONFIG & server)
+{
+    fprintf(stderr, "Usage: %s [options]\n", argv[0]);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -h, --help            show this help message and exit\n");
+    fprintf(stderr, "  -m FNAME, --model-path FNAME\n");
+    fprintf(stderr, "                        model path (default: %s)\n", cfg.ModelPath.c_str());
+    fprintf(stderr, "  --socket FNAME\n");
+    fprintf(stderr, "                        Unix domain socket to listen on (default: %s)\n", server.socketPath.c_str());
+    fprintf(stderr, "  --max-batch N\n");
+    fprintf(stderr, "                        requests per batch (default: %d)\n", server.maxBatch);
+    fprintf(stderr, "  --max-delay MS\n");
+    fprintf(stderr, "                        longest the oldest request waits for its batch to fill (default: %.1f)\n", server.maxDelayMs);
+    fprintf(stderr, "  --max-queue N\n");
+    fprintf(stderr, "                        queued requests beyond this are rejected as overloaded (default: %d)\n", server.maxQueue);
+    fprintf(stderr, "  --sessions K\n");
+    fprintf(stderr, "                        sessions , i.e. batches running at once (default: %d)\n", server.sessions);
+    fprintf(stderr, "  -conf FLOAT, --conf-threshold FLOAT\n");
+    fprintf(stderr, "                        confidence threshold (default: %.2f)\n", cfg.confThreshold);
+    fprintf(stderr, "  -nms FLOAT, --nms-threshold FLOAT\n");
+    fprintf(stderr, "                        IoU threshold of the NMS (default: %.2f)\n", cfg.iouThreshold);
+    fprintf(stderr, "  --io-binding\n");
+    fprintf(stderr, "                        reuse preallocated input/output tensors through Ort::IoBinding (default: %d)\n", cfg.ioBinding);
+    fprintf(stderr, "  --raw-input\n");
+    fprintf(stderr, "                        in-graph preprocessing , the model takes the letterboxed uint8 frame (default: %d)\n", cfg.rawInput);
+    fprintf(stderr, "  --model-cache\n");
+    fprintf(stderr, "                        load the optimized graph cached by an earlier run (default: %d)\n", cfg.modelCache);
+    fprintf(stderr, "  --mmap-model\n");
+    fprintf(stderr, "                        create sessions from a memory map of the model (default: %d)\n", cfg.mmapModel);
+    fprintf(stderr, "  --share-weights\n");
+    fprintf(stderr, "                        sessions share the mapped weights , prepacked weights and one CPU arena (default: %d)\n", cfg.shareWeights);
+    fprintf(stderr, "  --warmup N\n");
+    fprintf(stderr, "                        dummy runs per session before accepting clients (default: %d)\n", cfg.warmupRuns);
+    fprintf(stderr, "  --cuda\n");
+    fprintf(stderr, "                        using GPUs for inference (default: %d)\n", cfg.cudaEnable);
+    fprintf(stderr, "  --profile FNAME\n");
+    fprintf(stderr, "                        host profile written by YOLOv8Runner --auto-tune , applied before the other flags (default: %s)\n", cfg.ProfilePath.c_str());
+    fprintf(stderr, "  --log-level LEVEL\n");
+    fprintf(stderr, "                        trace , debug , info , warn , error or off (default: %s)\n", cfg.LogLevel.c_str());
+    fprintf(stderr, "  --trace FNAME\n");
+    fprintf(stderr, "                        record connection / scheduler spans as Chrome trace JSON\n");
+    fprintf(stderr, "\n");
+}
+
+bool Params_Parse(int argc , char ** argv , Configuration & cfg , SERVER_CONFIG & server)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-m" || arg == "--model-path") {
+            cfg.ModelPath = argv[++i];
+        } else if (arg == "--socket")
+        {
+            server.socketPath = argv[++i];
+        } else if (arg == "--max-batch")
+        {
+            server.maxBatch = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--max-delay")
+        {
+            server.maxDelayMs = std::max(0.0 , std::stod(argv[++i]));
+        } else if (arg == "--max-queue")
+        {
+            server.maxQueue = std::max(1 , std::stoi(argv[++i]));
+        } else if (arg == "--sessions")
+        {
+            server.sessions = std::max(1 , std::stoi(argv[++i]));
+            // The pool threading of the profile was measured for its own session count
+            cfg.poolIntraThreads = server.sessions == cfg.numSessions ? cfg.poolIntraThreads : 0;
+        } else if (arg == "-conf" || arg == "--conf-threshold")
+        {
+            cfg.confThreshold = std::stof(argv[++i]);
+        } else if (arg == "-nms" || arg == "--nms-threshold")
+        {
+            cfg.iouThreshold = std::stof(argv[++i]);
+        } else if (arg == "--io-binding")
+        {
+            cfg.ioBinding = true;
+        } else if (arg == "--raw-input")
+        {
+            cfg.rawInput = true;
+        } else if (arg == "--model-cache")
+        {
+            cfg.modelCache = true;
+        } else if (arg == "--mmap-model")
+        {
+            cfg.mmapModel = true;
+        } else if (arg == "--share-weights")
+        {
+            cfg.shareWeights = true;
+        } else if (arg == "--warmup")
+        {
+            cfg.warmupRuns = std::max(0 , std::stoi(argv[++i]));
+        } else if (arg == "--cuda")
+        {
+            cfg.cudaEnable = true;
+        } else if (arg == "--profile")
+        {
+            // Loaded by LoadHostProfileArgs before the other flags
+            cfg.ProfilePath = argv[++i];
+        } else if (arg == "--log-level")
+        {
+            cfg.LogLevel = argv[++i];
+            if (Logger::ParseLevel(cfg.LogLevel) < 0)
+            {
+                fprintf(stderr , "[ERROR] : Unknown log level : %s\n" , cfg.LogLevel.c_str());
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--trace")
+        {
+            cfg.TracePath = argv[++i];
+        } else if (arg == "-h" || arg == "--help")
+        {
+            Print_Usage(argc , argv , cfg , server);
+            return EXIT_FAILURE;
+        } else
+        {
+            fprintf(stderr , "[ERROR] : Unknown argument : %s\n" , arg.c_str());
+            Print_Usage(argc , argv , cfg , server);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc , char *argv[])
+{
+    Configuration cfg;
+    SERVER_CONFIG server;
+    // Before the flags , so anything given on the command line overrides the tuned settings
+    if (LoadHostProfileArgs(argc , argv , cfg))
+    {
+        server.sessions = cfg.numSessions;
+    }
+    if (Params_Parse(argc , argv , cfg , server))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Logger::SetLevel(Logger::ParseLevel(cfg.LogLevel));
+    TraceSession traceSession(cfg.TracePath);
+    Tracer::SetThreadName("accept");
+
+    InferenceServer Server(cfg , server);
+    g_server = &Server;
+    std::signal(SIGINT , Handle_Signal);
+    std::signal(SIGTERM , Handle_Signal);
+
+    // Ctrl+C stops accepting , answers what is queued and prints the report
+    bool served = Server.Run();
+    g_server = nullptr;
+    Server.PrintReport();
+    return served ? EXIT_SUCCESS : EXIT_FAILURE;
+}
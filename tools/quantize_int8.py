@@ -0,0 +1,126 @@
+"""
+    Static INT8 (QDQ) quantization of a YOLOv8 detect model.
+
+    Calibration tensors come from the runner itself , so activation ranges are collected on
+    exactly the letterboxed / normalized input the C++ side feeds at inference time :
+
+        main.exe -m yolov8n.onnx -img calib_images --dump-calibration calib_npy
+        python tools/quantize_int8.py -m yolov8n.onnx -c calib_npy -o yolov8n-int8.onnx
+        main.exe -m yolov8n.onnx -img val_images --compare-model yolov8n-int8.onnx
+
+    The detect head after the cv2 / cv3 convolutions (DFL , sigmoid , box decode and the final
+    concat of pixel coordinates with 0..1 scores) stays in float : a single scale for that
+    concat would wipe out the class scores.
+"""
+import argparse
+import glob
+import os
+
+import numpy as np
+import onnx
+from onnx import helper
+from onnxruntime.quantization import (CalibrationDataReader , CalibrationMethod , QuantFormat ,
+                                      QuantType , quantize_static)
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+
+class NpyCalibrationReader(CalibrationDataReader):
+    def __init__(self , calib_dir , input_name , limit):
+        self.paths = sorted(glob.glob(os.path.join(calib_dir , "*.npy")))[:limit or None]
+        if not self.paths:
+            raise RuntimeError("no .npy calibration tensors in " + calib_dir)
+        self.input_name = input_name
+        self.index = 0
+
+    def get_next(self):
+        if self.index >= len(self.paths):
+            return None
+        tensor = np.load(self.paths[self.index]).astype(np.float32)
+        self.index += 1
+        return { self.input_name : tensor }
+
+    def rewind(self):
+        self.index = 0
+
+
+def head_nodes_to_exclude(model):
+    """ Nodes of the detect module that produces output0 , except its cv* convolution branches """
+    producers = { out : node for node in model.graph.node for out in node.output }
+    output_node = producers.get(model.graph.output[0].name)
+    if output_node is None or not output_node.name.startswith("/"):
+        return []
+    # "/model.22/Concat_5" -> "/model.22/"
+    prefix = output_node.name[:output_node.name.index("/" , 1) + 1]
+    return [node.name for node in model.graph.node
+            if node.name.startswith(prefix) and not node.name[len(prefix):].startswith("cv")]
+
+
+def fold_input_quantize(model_path):
+    """ Make the graph input uint8 / int8 by removing its QuantizeLinear , store scale and zero point as metadata """
+    model = onnx.load(model_path)
+    graph = model.graph
+    input_name = graph.input[0].name
+    consumers = [node for node in graph.node if input_name in node.input]
+    if len(consumers) != 1 or consumers[0].op_type != "QuantizeLinear":
+        print("[WARN] input is not consumed by a single QuantizeLinear , keeping the float input")
+        return
+    quantize = consumers[0]
+    initializers = { init.name : init for init in graph.initializer }
+    scale = onnx.numpy_helper.to_array(initializers[quantize.input[1]]).item()
+    zero_point_array = onnx.numpy_helper.to_array(initializers[quantize.input[2]])
+    zero_point = zero_point_array.item()
+    elem_type = helper.np_dtype_to_tensor_dtype(zero_point_array.dtype)
+
+    for node in graph.node:
+        for i , name in enumerate(node.input):
+            if name == quantize.output[0]:
+                node.input[i] = input_name
+    graph.node.remove(quantize)
+    graph.input[0].type.tensor_type.elem_type = elem_type
+
+    for key , value in (("input_scale" , repr(float(scale))) , ("input_zero_point" , str(int(zero_point)))):
+        entry = model.metadata_props.add()
+        entry.key , entry.value = key , value
+    onnx.save(model , model_path)
+    print("[INFO] input folded to %s , scale %g , zero point %d" %
+          (onnx.TensorProto.DataType.Name(elem_type) , scale , zero_point))
+
+
+def main():
+    parser = argparse.ArgumentParser(description = "Static INT8 QDQ quantization of a YOLOv8 ONNX model")
+    parser.add_argument("-m" , "--model" , required = True , help = "fp32 model")
+    parser.add_argument("-c" , "--calib-dir" , required = True , help = ".npy tensors written by main --dump-calibration")
+    parser.add_argument("-o" , "--output" , required = True , help = "quantized model")
+    parser.add_argument("--method" , default = "minmax" , choices = ["minmax" , "entropy" , "percentile"])
+    parser.add_argument("--limit" , type = int , default = 0 , help = "calibration tensors to use , 0 for all")
+    parser.add_argument("--per-channel" , action = "store_true" , help = "per-channel weight scales")
+    parser.add_argument("--quantize-head" , action = "store_true" , help = "quantize the detect head post-processing too")
+    parser.add_argument("--uint8-input" , action = "store_true" ,
+                        help = "fold the input QuantizeLinear , the runner then quantizes the blob itself")
+    args = parser.parse_args()
+
+    prepared = args.output + ".prep.onnx"
+    quant_pre_process(args.model , prepared , skip_symbolic_shape = True)
+    model = onnx.load(prepared)
+    excluded = [] if args.quantize_head else head_nodes_to_exclude(model)
+    print("[INFO] nodes kept in float : %d" % len(excluded))
+
+    methods = { "minmax" : CalibrationMethod.MinMax , "entropy" : CalibrationMethod.Entropy ,
+                "percentile" : CalibrationMethod.Percentile }
+    reader = NpyCalibrationReader(args.calib_dir , model.graph.input[0].name , args.limit)
+    quantize_static(prepared , args.output , reader ,
+                    quant_format = QuantFormat.QDQ ,
+                    activation_type = QuantType.QUInt8 ,
+                    weight_type = QuantType.QInt8 ,
+                    per_channel = args.per_channel ,
+                    calibrate_method = methods[args.method] ,
+                    nodes_to_exclude = excluded)
+    os.remove(prepared)
+
+    if args.uint8_input:
+        fold_input_quantize(args.output)
+    print("[INFO] quantized model written to " + args.output)
+
+
+if __name__ == "__main__":
+    main()